@@ -0,0 +1,1064 @@
+#include "GLBenchmark.h"
+#include "GLPacked12.h"
+#include "GLBrickedVolume.h"
+#include "GLNormalize.h"
+#include "GLVolumePyramid.h"
+#include "GLStackLoader.h"
+#include "GLWorkerPool.h"
+#include "GLCutEngine.h"
+#include "GLSummedVolume.h"
+#include "GLVolumeFilter.h"
+#include "GLSliceCorrection.h"
+#include "GLSparseVolume.h"
+#include "GLRaycaster.h"
+#include <iostream>
+#include <iomanip>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <math.h>
+
+#define BENCHMARK_RUNS 5
+#define GL_PI 3.141592654f
+
+
+static GLdouble seconds(std::chrono::steady_clock::time_point _start)
+{
+	return std::chrono::duration<GLdouble>(std::chrono::steady_clock::now() - _start).count();
+}
+
+static GLvoid printRate(const GLchar* _label, GLdouble _bytes, GLdouble _time, GLdouble _reference)
+{
+	std::cout << "  " << std::left << std::setw(10) << _label << std::right << std::fixed << std::setprecision(2)
+			  << std::setw(8) << _bytes / _time / 1e9 << " GB/s";
+	if(_reference > 0)
+		std::cout << std::setw(8) << 100.0 * _reference / _time << " % of memcpy";
+	std::cout << std::endl;
+}
+
+/**
+ * 12Bit unpack throughput (16Bit output bytes per second) of every kernel,
+ * against a memcpy of the same 16Bit volume as the memory bandwidth reference
+ */
+static GLint benchmarkUnpack12()
+{
+	const size_t count = (size_t) 64 * 1024 * 1024;
+
+	GLushort* volume = new GLushort[count];
+	GLushort* unpacked = new GLushort[count];
+	GLubyte* packed = new GLubyte[packedSize12(count)];
+
+	srand(1);
+	for(size_t i=0; i<count; i++)
+		volume[i] = (GLushort) (rand() & 0x0fff);
+	pack12(volume, packed, count);
+	memset(unpacked, 0, count * sizeof(GLushort));
+
+	std::cout << "unpack12: " << count / (1024 * 1024) << "M voxels, " << packedSize12(count) / (1024 * 1024)
+			  << " MB packed -> " << count * sizeof(GLushort) / (1024 * 1024) << " MB, best of " << BENCHMARK_RUNS << std::endl;
+
+	GLdouble memcpy_time = 1e30;
+	for(GLint run=0; run<BENCHMARK_RUNS; run++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		memcpy(unpacked, volume, count * sizeof(GLushort));
+		GLdouble time = seconds(start);
+		memcpy_time = time < memcpy_time ? time : memcpy_time;
+	}
+	printRate("memcpy", count * sizeof(GLushort), memcpy_time, 0);
+
+	const GLchar* kernels[] = {"scalar", "sse4.1", "avx2"};
+	for(GLint k=0; k<3; k++)
+	{
+		GLUnpack12Kernel kernel = unpack12Kernel(kernels[k]);
+		if(!kernel)
+		{
+			std::cout << "  " << std::left << std::setw(10) << kernels[k] << "not supported" << std::endl;
+			continue;
+		}
+
+		GLdouble best_time = 1e30;
+		for(GLint run=0; run<BENCHMARK_RUNS; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			kernel(packed, unpacked, count);
+			GLdouble time = seconds(start);
+			best_time = time < best_time ? time : best_time;
+		}
+
+		if(memcmp(unpacked, volume, count * sizeof(GLushort)) != 0)
+		{
+			std::cout << "error: " << kernels[k] << " unpacked wrong values" << std::endl;
+			return EXIT_FAILURE;
+		}
+		printRate(kernels[k], count * sizeof(GLushort), best_time, memcpy_time);
+	}
+
+	delete[] volume;
+	delete[] unpacked;
+	delete[] packed;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * extracts every XY, EY and EX cut and a fan of oblique cuts through the center,
+ * returns the mean time per cut in microseconds
+ */
+template <typename Volume, typename T>
+static GLvoid timeCuts(Volume* _volume, GLint _width, GLint _height, GLint _depth, GLdouble* _time)
+{
+	GLint out_size = _width > _height ? _width : _height;
+	out_size = out_size > _depth ? out_size : _depth;
+	T* out = new T[(size_t) out_size * out_size];
+	const GLint no_oblique = 64;
+
+	for(GLint cut=0; cut<4; cut++)
+		_time[cut] = 1e30;
+
+	for(GLint run=0; run<BENCHMARK_RUNS; run++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(GLint z=0; z<_depth; z++)
+			_volume->extractXY(z, out);
+		GLdouble time = seconds(start) * 1e6 / _depth;
+		_time[0] = time < _time[0] ? time : _time[0];
+
+		start = std::chrono::steady_clock::now();
+		for(GLint x=0; x<_width; x++)
+			_volume->extractEY(x, out);
+		time = seconds(start) * 1e6 / _width;
+		_time[1] = time < _time[1] ? time : _time[1];
+
+		start = std::chrono::steady_clock::now();
+		for(GLint y=0; y<_height; y++)
+			_volume->extractEX(y, out);
+		time = seconds(start) * 1e6 / _height;
+		_time[2] = time < _time[2] ? time : _time[2];
+
+		// planes containing the energy axis, rotated around it
+		start = std::chrono::steady_clock::now();
+		for(GLint n=0; n<no_oblique; n++)
+		{
+			GLfloat phi = n * GL_PI / no_oblique;
+			GLfloat u[3] = {cosf(phi), sinf(phi), 0};
+			GLfloat v[3] = {0, 0, 1};
+			GLfloat origin[3] = {_width / 2.0f - u[0] * _width / 2.0f, _height / 2.0f - u[1] * _height / 2.0f, 0};
+			_volume->extractOblique(origin, u, v, _width, _depth, out);
+		}
+		time = seconds(start) * 1e6 / no_oblique;
+		_time[3] = time < _time[3] ? time : _time[3];
+	}
+
+	delete[] out;
+}
+
+template <typename T>
+static GLvoid benchmarkCutsOf(GLint _width, GLint _height, GLint _depth)
+{
+	size_t count = (size_t) _width * _height * _depth;
+	T* linear_data = new T[count];
+	srand(1);
+	for(size_t i=0; i<count; i++)
+		linear_data[i] = (T) rand();
+
+	GLLinearVolume<T> linear(linear_data, _width, _height, _depth);
+	GLBrickedVolume<T> bricked(_width, _height, _depth, 16);
+	for(GLint z=0; z<_depth; z++)
+		bricked.setSlice(z, linear_data + (size_t) z * _width * _height);
+
+	GLdouble linear_time[4];
+	GLdouble bricked_time[4];
+	timeCuts<GLLinearVolume<T>, T>(&linear, _width, _height, _depth, linear_time);
+	timeCuts<GLBrickedVolume<T>, T>(&bricked, _width, _height, _depth, bricked_time);
+
+	std::cout << "cuts: " << _width << "x" << _height << "x" << _depth << ", " << sizeof(T) * 8 << "Bit, 16^3 bricks, us per cut, best of "
+			  << BENCHMARK_RUNS << std::endl;
+	std::cout << "  cut         linear   bricked   speedup" << std::endl;
+	const GLchar* cuts[] = {"XY", "EY", "EX", "oblique"};
+	for(GLint cut=0; cut<4; cut++)
+	{
+		std::cout << "  " << std::left << std::setw(8) << cuts[cut] << std::right << std::fixed << std::setprecision(1)
+				  << std::setw(10) << linear_time[cut] << std::setw(10) << bricked_time[cut]
+				  << std::setprecision(2) << std::setw(9) << linear_time[cut] / bricked_time[cut] << "x" << std::endl;
+	}
+
+	delete[] linear_data;
+}
+
+static GLint benchmarkCuts()
+{
+	// data_DLD and data_DLD_raw of the bundled stack
+	benchmarkCutsOf<GLubyte>(128, 128, 101);
+	benchmarkCutsOf<GLushort>(512, 512, 101);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * max reduction (16Bit input bytes per second) and 8Bit rescale (32Bit input bytes per second)
+ * of every kernel, the results must match the scalar kernels bit by bit
+ */
+static GLint benchmarkNormalize()
+{
+	const size_t count = (size_t) 64 * 1024 * 1024;
+
+	GLushort* counts = new GLushort[count];
+	GLuint* sums = new GLuint[count];
+	GLubyte* reference = new GLubyte[count];
+	GLubyte* rescaled = new GLubyte[count];
+
+	srand(1);
+	for(size_t i=0; i<count; i++)
+	{
+		counts[i] = (GLushort) (rand() & 0x0fff);
+		sums[i] = (GLuint) rand() & 0x3fffff;
+	}
+	counts[count / 3] = 4321;
+	GLfloat factor = rescaleFactor8(0x3fffff);
+	rescale32to8Kernel("scalar")(sums, reference, count, factor);
+
+	std::cout << "normalize: " << count / (1024 * 1024) << "M voxels, best of " << BENCHMARK_RUNS << std::endl;
+
+	GLint failed = 0;
+	const GLchar* kernels[] = {"scalar", "sse4.1", "avx2"};
+	for(GLint k=0; k<3; k++)
+	{
+		GLMaxCount16Kernel max_kernel = maxCount16Kernel(kernels[k]);
+		GLRescale32to8Kernel rescale_kernel = rescale32to8Kernel(kernels[k]);
+		if(!max_kernel || !rescale_kernel)
+		{
+			std::cout << "  " << std::left << std::setw(10) << kernels[k] << "not supported" << std::endl;
+			continue;
+		}
+
+		GLdouble max_time = 1e30;
+		GLdouble rescale_time = 1e30;
+		GLushort max_count_rate = 0;
+		for(GLint run=0; run<BENCHMARK_RUNS; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			max_count_rate = max_kernel(counts, count);
+			GLdouble time = seconds(start);
+			max_time = time < max_time ? time : max_time;
+
+			start = std::chrono::steady_clock::now();
+			rescale_kernel(sums, rescaled, count, factor);
+			time = seconds(start);
+			rescale_time = time < rescale_time ? time : rescale_time;
+		}
+
+		if(max_count_rate != 4321 || memcmp(rescaled, reference, count) != 0)
+		{
+			std::cout << "  " << kernels[k] << ": wrong result" << std::endl;
+			failed = 1;
+			continue;
+		}
+
+		std::cout << "  " << kernels[k] << std::endl;
+		printRate("max", count * sizeof(GLushort), max_time, 0);
+		printRate("rescale", count * sizeof(GLuint), rescale_time, 0);
+	}
+
+	delete[] counts;
+	delete[] sums;
+	delete[] reference;
+	delete[] rescaled;
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * reduces _no_slices slices into a pyramid with 1, 2, 4 ... cores: slices in parallel,
+ * the row blocks of one slice after the other in parallel, and the 8Bit conversion of level 2
+ * in parallel. Raw slices (_no_raw of them) and pyramid slices are reused cyclically.
+ */
+static GLvoid benchmarkReduceOf(const GLchar* _label, GLushort** _raw, GLint _no_raw, GLint _width, GLint _height,
+								GLint _no_slices, GLint _capacity)
+{
+	GLVolumePyramid pyramid(_width, _height);
+	pyramid.reserve(_capacity);
+	GLint level = pyramid.getNoLevels() > 2 ? 2 : 1;
+
+	GLint max_threads = (GLint) std::thread::hardware_concurrency();
+	max_threads = max_threads > 0 ? max_threads : 1;
+
+	std::cout << "reduce: " << _label << ", " << _width << "x" << _height << "x" << _no_slices << ", "
+			  << pyramid.getNoLevels() - 1 << " levels, ms, best of " << BENCHMARK_RUNS << std::endl;
+	std::cout << "  cores    slices  speedup    blocks  speedup    8Bit  speedup" << std::endl;
+
+	GLdouble reference[3] = {0, 0, 0};
+	// 1, 2, 4 ... and all cores
+	for(GLint threads=1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads)
+	{
+		GLWorkerPool pool(threads);
+		GLdouble best[3] = {1e30, 1e30, 1e30};
+
+		for(GLint run=0; run<BENCHMARK_RUNS; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			pool.parallelFor(0, _no_slices, [&](GLint _t)
+			{
+				pyramid.reduceSlice(_raw[_t % _no_raw], _t % _capacity);
+			});
+			GLdouble time = seconds(start) * 1e3;
+			best[0] = time < best[0] ? time : best[0];
+
+			start = std::chrono::steady_clock::now();
+			for(GLint t=0; t<_no_slices; t++)
+				pyramid.reduceSlice(_raw[t % _no_raw], t % _capacity, &pool);
+			time = seconds(start) * 1e3;
+			best[1] = time < best[1] ? time : best[1];
+
+			start = std::chrono::steady_clock::now();
+			pool.parallelFor(0, _no_slices, [&](GLint _t)
+			{
+				pyramid.normalizeSlice(level, _t % _capacity, pyramid.getMax(level));
+			});
+			time = seconds(start) * 1e3;
+			best[2] = time < best[2] ? time : best[2];
+		}
+
+		if(threads == 1)
+		{
+			for(GLint i=0; i<3; i++)
+				reference[i] = best[i];
+		}
+
+		std::cout << std::right << std::fixed << std::setw(7) << threads;
+		for(GLint i=0; i<3; i++)
+			std::cout << std::setprecision(1) << std::setw(10) << best[i] << std::setprecision(2) << std::setw(8) << reference[i] / best[i] << "x";
+		std::cout << std::endl;
+
+		if(threads == max_threads)
+			break;
+	}
+}
+
+static GLint benchmarkReduce()
+{
+	// the bundled stack, loaded up front, only the reduction is timed
+	GLStackLoader loader("data/", "DLD");
+	GLint no_slices = loader.probe();
+	if(no_slices > 0)
+	{
+		for(GLint t=0; t<no_slices; t++)
+			loader.loadSlice(t);
+		benchmarkReduceOf("data/DLD", loader.getSlices(), no_slices, loader.getWidth(), loader.getHeight(), no_slices, no_slices);
+	}
+	else
+		std::cout << "reduce: no stack in data/, skipped" << std::endl;
+
+	// synthetic 1024^2 x 1000, 16 raw slices (32 MB) and 64 pyramid slices (~360 MB) are reused
+	// to stay within memory, both are far beyond the last level cache
+	const GLint no_raw = 16;
+	GLushort** raw = new GLushort*[no_raw];
+	srand(1);
+	for(GLint t=0; t<no_raw; t++)
+	{
+		raw[t] = new GLushort[1024 * 1024];
+		for(GLint i=0; i<1024 * 1024; i++)
+			raw[t][i] = (GLushort) (rand() & 0x0fff);
+	}
+	benchmarkReduceOf("synthetic", raw, no_raw, 1024, 1024, 1000, 64);
+
+	for(GLint t=0; t<no_raw; t++)
+		delete[] raw[t];
+	delete[] raw;
+	return EXIT_SUCCESS;
+}
+
+// plane through the center of a _width x _height x _depth volume, facing a viewer rotated by _angle about (1, 1, 0)
+static GLCutPlane obliquePlane(GLint _width, GLint _height, GLint _depth, GLfloat _angle)
+{
+	GLfloat c = cosf(_angle);
+	GLfloat s = sinf(_angle);
+	GLfloat r = sqrtf(0.5f);
+	GLfloat u[3] = {0.5f * (1 + c), 0.5f * (1 - c), -r * s};
+	GLfloat v[3] = {0.5f * (1 - c), 0.5f * (1 + c), r * s};
+	GLfloat center[3] = {_width / 2.0f, _height / 2.0f, _depth / 2.0f};
+	GLint size = (GLint) ceilf(sqrtf((GLfloat) _width * _width + _height * _height + _depth * _depth)) + 1;
+
+	GLCutPlane plane;
+	plane.width = size;
+	plane.height = size;
+	for(GLint a=0; a<3; a++)
+	{
+		plane.origin[a] = center[a] - (size - 1) / 2.0f * (u[a] + v[a]);
+		plane.u[a] = u[a];
+		plane.v[a] = v[a];
+	}
+	return plane;
+}
+
+/**
+ * trilinear cuts of the raw 16Bit volume, ms per cut: the axis aligned XY, EY and EX planes
+ * and an oblique plane rotated to a new orientation for every cut (no cache hits),
+ * for every kernel on 1, 2, 4 ... cores. The kernels are checked against each other first.
+ */
+static GLint benchmarkResample()
+{
+	const GLint no_orientations = 60;
+
+	// the bundled stack if there is one, the engine works on a contiguous volume like the cache mapping
+	GLStackLoader loader("data/", "DLD");
+	GLint depth = loader.probe();
+	GLint width = depth > 0 ? loader.getWidth() : 512;
+	GLint height = depth > 0 ? loader.getHeight() : 512;
+	depth = depth > 0 ? depth : 101;
+	size_t slice_size = (size_t) width * height;
+
+	GLushort* volume = new GLushort[slice_size * depth];
+	srand(1);
+	for(GLint t=0; t<depth; t++)
+	{
+		if(loader.getNoSlices() > 0 && loader.loadSlice(t))
+			memcpy(volume + t * slice_size, loader.getSlices()[t], slice_size * sizeof(GLushort));
+		else
+		{
+			for(size_t i=0; i<slice_size; i++)
+				volume[t * slice_size + i] = (GLushort) (rand() % 8 == 0 ? rand() & 0x0fff : 0);
+		}
+	}
+	GLfloat factor = rescaleFactor8(maxCount16(volume, slice_size * depth));
+
+	GLCutPlane planes[3] = {{{0, 0, depth / 2.0f}, {1, 0, 0}, {0, 1, 0}, width, height},
+							{{width / 2.0f, 0, 0}, {0, 1, 0}, {0, 0, 1}, height, depth},
+							{{0, height / 2.0f, 0}, {1, 0, 0}, {0, 0, 1}, width, depth}};
+	const GLchar* kernels[] = {"scalar", "avx2"};
+
+	GLWorkerPool check_pool(1);
+	GLCutEngine reference(&check_pool);
+	GLCutEngine check(&check_pool);
+	reference.setKernel("scalar");
+	for(GLint k=1; k<2; k++)
+	{
+		if(!check.setKernel(kernels[k]))
+			continue;
+		for(GLint o=0; o<no_orientations; o+=7)
+		{
+			GLCutPlane plane = obliquePlane(width, height, depth, o * 2 * GL_PI / no_orientations);
+			reference.cut(volume, width, height, depth, plane, factor, 0);
+			check.cut(volume, width, height, depth, plane, factor, 0);
+			for(GLint j=0; j<plane.height; j++)
+			{
+				size_t row = (size_t) j * plane.width;
+				if(memcmp(reference.getCut() + row + reference.getRowBegin(j), check.getCut() + row + check.getRowBegin(j),
+						  reference.getRowEnd(j) - reference.getRowBegin(j)) != 0)
+				{
+					std::cout << "error: resample kernel " << kernels[k] << " differs from scalar" << std::endl;
+					delete[] volume;
+					return EXIT_FAILURE;
+				}
+			}
+		}
+	}
+
+	GLint max_threads = (GLint) std::thread::hardware_concurrency();
+	max_threads = max_threads > 0 ? max_threads : 1;
+
+	std::cout << "resample: " << width << "x" << height << "x" << depth << " 16Bit, trilinear, ms per cut, best of "
+			  << BENCHMARK_RUNS << std::endl;
+	std::cout << "  kernel  cores      XY      EY      EX  oblique     fps" << std::endl;
+	for(GLint k=0; k<2; k++)
+	{
+		for(GLint threads=1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads)
+		{
+			GLWorkerPool pool(threads);
+			GLCutEngine engine(&pool);
+			if(!engine.setKernel(kernels[k]))
+				break;
+
+			GLdouble best[4] = {1e30, 1e30, 1e30, 1e30};
+			for(GLint run=0; run<BENCHMARK_RUNS; run++)
+			{
+				for(GLint p=0; p<3; p++)
+				{
+					engine.invalidate();
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					engine.cut(volume, width, height, depth, planes[p], factor, 0);
+					GLdouble time = seconds(start) * 1e3;
+					best[p] = time < best[p] ? time : best[p];
+				}
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				for(GLint o=0; o<no_orientations; o++)
+					engine.cut(volume, width, height, depth, obliquePlane(width, height, depth, o * 2 * GL_PI / no_orientations), factor, 0);
+				GLdouble time = seconds(start) * 1e3 / no_orientations;
+				best[3] = time < best[3] ? time : best[3];
+			}
+
+			std::cout << "  " << std::left << std::setw(8) << kernels[k] << std::right << std::fixed << std::setprecision(2)
+					  << std::setw(5) << threads;
+			for(GLint i=0; i<4; i++)
+				std::cout << std::setw(i < 3 ? 8 : 9) << best[i];
+			std::cout << std::setprecision(0) << std::setw(8) << 1e3 / best[3] << std::endl;
+
+			if(threads == max_threads)
+				break;
+		}
+	}
+
+	delete[] volume;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * summed volume table of a synthetic 512x512x101 stack: build time on 1, 2, 4 ... cores, then
+ * EDCs of growing x, y boxes over all energies, rescanned from the raw slices and from the table
+ */
+static GLint benchmarkSummed()
+{
+	const GLint width = 512;
+	const GLint height = 512;
+	const GLint depth = 101;
+	size_t slice_size = (size_t) width * height;
+
+	GLushort* volume = new GLushort[slice_size * depth];
+	srand(1);
+	for(size_t i=0; i<slice_size * depth; i++)
+		volume[i] = (GLushort) (rand() % 8 == 0 ? rand() & 0x0fff : 0);
+
+	GLSummedVolume table(width, height);
+	table.reserve(depth);
+
+	GLint max_threads = (GLint) std::thread::hardware_concurrency();
+	max_threads = max_threads > 0 ? max_threads : 1;
+
+	std::cout << "summed: " << width << "x" << height << "x" << depth << ", "
+			  << GLSummedVolume::getSize(width, height, depth) / (1024 * 1024) << " MB table, ms, best of " << BENCHMARK_RUNS << std::endl;
+	std::cout << "  cores    areas  integrate" << std::endl;
+	for(GLint threads=1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads)
+	{
+		GLWorkerPool pool(threads);
+		GLdouble best[2] = {1e30, 1e30};
+		for(GLint run=0; run<BENCHMARK_RUNS; run++)
+		{
+			GLSummedVolume build(width, height);
+			build.reserve(depth);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			pool.parallelFor(0, depth, [&](GLint _t)
+			{
+				build.addSlice(_t, volume + _t * slice_size);
+			});
+			GLdouble time = seconds(start) * 1e3;
+			best[0] = time < best[0] ? time : best[0];
+
+			start = std::chrono::steady_clock::now();
+			build.integrate(depth, &pool);
+			time = seconds(start) * 1e3;
+			best[1] = time < best[1] ? time : best[1];
+		}
+		std::cout << std::right << std::fixed << std::setprecision(1) << std::setw(7) << threads
+				  << std::setw(9) << best[0] << std::setw(11) << best[1] << std::endl;
+
+		if(threads == max_threads)
+			break;
+	}
+
+	for(GLint t=0; t<depth; t++)
+		table.addSlice(t, volume + t * slice_size);
+	GLWorkerPool pool(1);
+	table.integrate(depth, &pool);
+
+	std::cout << "  EDC box      rescan     table  speedup" << std::endl;
+	uint64_t* edc = new uint64_t[depth];
+	for(GLint box=8; box<=width; box*=4)
+	{
+		GLint x0 = (width - box) / 2;
+		GLint y0 = (height - box) / 2;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(GLint t=0; t<depth; t++)
+		{
+			uint64_t sum = 0;
+			for(GLint y=y0; y<y0 + box; y++)
+				for(GLint x=x0; x<x0 + box; x++)
+					sum += volume[t * slice_size + (size_t) y * width + x];
+			edc[t] = sum;
+		}
+		GLdouble rescan = seconds(start) * 1e3;
+
+		start = std::chrono::steady_clock::now();
+		for(GLint run=0; run<1000; run++)
+			table.edc(x0, x0 + box - 1, y0, y0 + box - 1, 0, depth - 1, edc);
+		GLdouble lookup = seconds(start);
+
+		if(edc[depth / 2] != table.boxSum(x0, x0 + box - 1, y0, y0 + box - 1, depth / 2, depth / 2))
+		{
+			std::cout << "error: summed volume table differs from the rescan" << std::endl;
+			delete[] edc;
+			delete[] volume;
+			return EXIT_FAILURE;
+		}
+		std::cout << std::right << std::fixed << std::setprecision(3) << std::setw(7) << box << "^2"
+				  << std::setw(10) << rescan << std::setw(10) << lookup << std::setprecision(0) << std::setw(8)
+				  << rescan / lookup << "x" << std::endl;
+	}
+
+	delete[] edc;
+	delete[] volume;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * separable smoothing of a synthetic 512x512x100 stack: x, y passes (planes) and t pass (depth)
+ * of every kernel on 1, 2, 4 ... cores for growing Gaussian radii, checked against the scalar
+ * kernel (bit identical) and a direct 3D convolution at a few voxels
+ */
+static GLint benchmarkSmooth()
+{
+	const GLint width = 512;
+	const GLint height = 512;
+	const GLint depth = 100;
+	size_t slice_size = (size_t) width * height;
+
+	GLushort* volume = new GLushort[slice_size * depth];
+	srand(1);
+	for(size_t i=0; i<slice_size * depth; i++)
+		volume[i] = (GLushort) (rand() % 8 == 0 ? rand() & 0x0fff : 0);
+
+	const GLchar* kernels[] = {"scalar", "avx2"};
+	GLWorkerPool check_pool(1);
+	GLVolumeFilter reference(width, height);
+	GLVolumeFilter check(width, height);
+	if(!reference.reserve(depth) || !check.reserve(depth))
+	{
+		std::cout << "error: no memory for the smoothing filters" << std::endl;
+		delete[] volume;
+		return EXIT_FAILURE;
+	}
+
+	// direct 3D convolution with the same clamped edges, in double
+	const GLint radius = 2;
+	std::vector<GLdouble> weights(2 * radius + 1);
+	GLdouble total = 0;
+	for(GLint k=-radius; k<=radius; k++)
+		total += weights[k + radius] = exp(-0.5 * k * k / (radius / 2.0 * radius / 2.0));
+	reference.setKernel("scalar");
+	reference.setFilter(FILTER_GAUSSIAN, radius);
+	for(GLint t=0; t<depth; t++)
+		reference.filterPlane(t, volume + t * slice_size);
+	reference.filterDepth(0, depth, depth, &check_pool);
+	for(GLint sample=0; sample<64; sample++)
+	{
+		GLint x = sample == 0 ? 0 : rand() % width;
+		GLint y = sample == 0 ? 0 : rand() % height;
+		GLint t = sample == 0 ? 0 : rand() % depth;
+		GLdouble sum = 0;
+		for(GLint dt=-radius; dt<=radius; dt++)
+			for(GLint dy=-radius; dy<=radius; dy++)
+				for(GLint dx=-radius; dx<=radius; dx++)
+				{
+					GLint xs = x + dx < 0 ? 0 : x + dx < width ? x + dx : width - 1;
+					GLint ys = y + dy < 0 ? 0 : y + dy < height ? y + dy : height - 1;
+					GLint ts = t + dt < 0 ? 0 : t + dt < depth ? t + dt : depth - 1;
+					sum += weights[dx + radius] * weights[dy + radius] * weights[dt + radius] / (total * total * total)
+						   * volume[ts * slice_size + (size_t) ys * width + xs];
+				}
+		if(fabs(reference.getSlice(t)[(size_t) y * width + x] - sum) > 1.0)
+		{
+			std::cout << "error: smoothing differs from the 3D convolution at " << x << ", " << y << ", " << t << std::endl;
+			delete[] volume;
+			return EXIT_FAILURE;
+		}
+	}
+	if(check.setKernel("avx2"))
+	{
+		check.setFilter(FILTER_GAUSSIAN, radius);
+		for(GLint t=0; t<depth; t++)
+			check.filterPlane(t, volume + t * slice_size);
+		check.filterDepth(0, depth, depth, &check_pool);
+		if(memcmp(reference.getSlice(0), check.getSlice(0), slice_size * depth * sizeof(GLushort)) != 0)
+		{
+			std::cout << "error: smoothing kernel avx2 differs from scalar" << std::endl;
+			delete[] volume;
+			return EXIT_FAILURE;
+		}
+	}
+
+	GLint max_threads = (GLint) std::thread::hardware_concurrency();
+	max_threads = max_threads > 0 ? max_threads : 1;
+
+	std::cout << "smooth: " << width << "x" << height << "x" << depth << " 16Bit, gaussian, ms, best of "
+			  << BENCHMARK_RUNS << std::endl;
+	std::cout << "  kernel  cores  radius   planes    depth    total" << std::endl;
+	for(GLint k=0; k<2; k++)
+	{
+		for(GLint threads=1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads)
+		{
+			GLWorkerPool pool(threads);
+			if(!check.setKernel(kernels[k]))
+				break;
+
+			for(GLint r=1; r<=4; r*=2)
+			{
+				check.setFilter(FILTER_GAUSSIAN, r);
+				GLdouble best[2] = {1e30, 1e30};
+				for(GLint run=0; run<BENCHMARK_RUNS; run++)
+				{
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					pool.parallelFor(0, depth, [&](GLint _t)
+					{
+						check.filterPlane(_t, volume + _t * slice_size);
+					});
+					GLdouble time = seconds(start) * 1e3;
+					best[0] = time < best[0] ? time : best[0];
+
+					start = std::chrono::steady_clock::now();
+					check.filterDepth(0, depth, depth, &pool);
+					time = seconds(start) * 1e3;
+					best[1] = time < best[1] ? time : best[1];
+				}
+				std::cout << "  " << std::left << std::setw(8) << kernels[k] << std::right << std::fixed << std::setprecision(1)
+						  << std::setw(5) << threads << std::setw(8) << r << std::setw(9) << best[0] << std::setw(9) << best[1]
+						  << std::setw(9) << best[0] + best[1] << std::endl;
+			}
+
+			if(threads == max_threads)
+				break;
+		}
+	}
+
+	delete[] volume;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * flat field and dark correction of a synthetic 512x512x100 stack out of one buffer into
+ * another (as from a mapped slice), every kernel against a memcpy of the same slices
+ */
+static GLint benchmarkCorrect()
+{
+	const GLint width = 512;
+	const GLint height = 512;
+	const GLint depth = 100;
+	size_t slice_size = (size_t) width * height;
+	size_t count = slice_size * depth;
+
+	GLushort* volume = new GLushort[count];
+	GLushort* corrected = new GLushort[count];
+	GLushort* reference = new GLushort[count];
+	GLushort* flat = new GLushort[slice_size];
+	GLushort* dark = new GLushort[slice_size];
+
+	srand(1);
+	for(size_t i=0; i<count; i++)
+		volume[i] = (GLushort) (rand() & 0x0fff);
+	for(size_t i=0; i<slice_size; i++)
+	{
+		flat[i] = (GLushort) (rand() % 64 == 0 ? 0 : 800 + rand() % 400);
+		dark[i] = (GLushort) (rand() % 16);
+	}
+
+	GLSliceCorrection correction(width, height);
+	correction.setFlat(flat);
+	correction.setDark(dark);
+	correction.setKernel("scalar");
+	for(GLint t=0; t<depth; t++)
+		correction.apply(volume + t * slice_size, reference + t * slice_size);
+
+	std::cout << "correct: " << width << "x" << height << "x" << depth << ", " << count * sizeof(GLushort) / (1024 * 1024)
+			  << " MB, flat field and dark, best of " << BENCHMARK_RUNS << std::endl;
+
+	GLdouble memcpy_time = 1e30;
+	for(GLint run=0; run<BENCHMARK_RUNS; run++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		memcpy(corrected, volume, count * sizeof(GLushort));
+		GLdouble time = seconds(start);
+		memcpy_time = time < memcpy_time ? time : memcpy_time;
+	}
+	printRate("memcpy", count * sizeof(GLushort), memcpy_time, 0);
+
+	const GLchar* kernels[] = {"scalar", "avx2"};
+	for(GLint k=0; k<2; k++)
+	{
+		if(!correction.setKernel(kernels[k]))
+		{
+			std::cout << "  " << std::left << std::setw(10) << kernels[k] << "not supported" << std::endl;
+			continue;
+		}
+
+		GLdouble best_time = 1e30;
+		for(GLint run=0; run<BENCHMARK_RUNS; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for(GLint t=0; t<depth; t++)
+				correction.apply(volume + t * slice_size, corrected + t * slice_size);
+			GLdouble time = seconds(start);
+			best_time = time < best_time ? time : best_time;
+		}
+
+		if(memcmp(corrected, reference, count * sizeof(GLushort)) != 0)
+		{
+			std::cout << "error: correction kernel " << kernels[k] << " differs from scalar" << std::endl;
+			return EXIT_FAILURE;
+		}
+		printRate(kernels[k], count * sizeof(GLushort), best_time, memcpy_time);
+	}
+
+	delete[] volume;
+	delete[] corrected;
+	delete[] reference;
+	delete[] flat;
+	delete[] dark;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * sorted voxel list and octree build of a synthetic 256x256x400 8Bit level (5 % of the voxels
+ * lit) on 1..N cores, then per threshold the point positions from a dense scan of the volume
+ * (the old RENDER_ALL loop) against the walk over the list prefix, and pick() along axis aligned
+ * rays from far outside, on voxel boundaries, against a scan along the same column or row
+ */
+static GLint benchmarkSparse()
+{
+	const GLint width = 256;
+	const GLint height = 256;
+	const GLint depth = 400;
+	size_t slice_size = (size_t) width * height;
+	size_t count = slice_size * depth;
+
+	GLubyte* volume = new GLubyte[count];
+	std::vector<GLubyte> luts((size_t) depth * 256);
+	std::vector<GLboolean> slices(depth, true);
+	srand(1);
+	for(size_t i=0; i<count; i++)
+		volume[i] = (GLubyte) (rand() % 20 == 0 ? rand() & 0xff : 0);
+	for(GLint t=0; t<depth; t++)
+		for(GLint v=0; v<256; v++)
+			luts[t * 256 + v] = (GLubyte) v;
+
+	GLint max_threads = (GLint) std::thread::hardware_concurrency();
+	max_threads = max_threads > 0 ? max_threads : 1;
+
+	GLSparseVolume sparse;
+	std::cout << "sparse: " << width << "x" << height << "x" << depth << " 8Bit, ms, best of " << BENCHMARK_RUNS << std::endl;
+	std::cout << "  cores    build" << std::endl;
+	for(GLint threads=1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads)
+	{
+		GLWorkerPool pool(threads);
+		GLdouble best_time = 1e30;
+		for(GLint run=0; run<BENCHMARK_RUNS; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			sparse.build(volume, width, height, depth, luts.data(), slices.data(), &pool);
+			GLdouble time = seconds(start) * 1e3;
+			best_time = time < best_time ? time : best_time;
+		}
+		std::cout << std::fixed << std::setprecision(1) << std::setw(7) << threads << std::setw(9) << best_time << std::endl;
+
+		if(threads == max_threads)
+			break;
+	}
+
+	std::vector<GLfloat> positions(count * 3);
+	std::cout << "  threshold    points    dense   sorted" << std::endl;
+	const GLint thresholds[] = {-1, 0, 20, 50, 100};
+	for(GLint i=0; i<5; i++)
+	{
+		GLdouble best[2] = {1e30, 1e30};
+		size_t points[2] = {0, 0};
+		for(GLint run=0; run<BENCHMARK_RUNS; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			points[0] = 0;
+			for(size_t v=0; v<count; v++)
+			{
+				if(volume[v] <= thresholds[i])
+					continue;
+				positions[points[0] * 3] = (GLfloat) (v % width);
+				positions[points[0] * 3 + 1] = (GLfloat) (v % slice_size / width);
+				positions[points[0] * 3 + 2] = (GLfloat) (v / slice_size);
+				points[0]++;
+			}
+			GLdouble time = seconds(start) * 1e3;
+			best[0] = time < best[0] ? time : best[0];
+
+			start = std::chrono::steady_clock::now();
+			const GLuint* voxels = sparse.getVoxels();
+			points[1] = sparse.getCount(thresholds[i]);
+			for(size_t p=0; p<points[1]; p++)
+			{
+				positions[p * 3] = (GLfloat) (voxels[p] % width);
+				positions[p * 3 + 1] = (GLfloat) (voxels[p] % slice_size / width);
+				positions[p * 3 + 2] = (GLfloat) (voxels[p] / slice_size);
+			}
+			time = seconds(start) * 1e3;
+			best[1] = time < best[1] ? time : best[1];
+		}
+
+		if(points[0] != points[1])
+		{
+			std::cout << "error: the sorted list has " << points[1] << " voxels above " << thresholds[i] << ", the volume " << points[0] << std::endl;
+			delete[] volume;
+			return EXIT_FAILURE;
+		}
+		std::cout << std::setw(11) << thresholds[i] << std::setw(10) << points[0] << std::setw(9) << best[0] << std::setw(9) << best[1] << std::endl;
+	}
+
+	// down the energy axis at (x, y) and along x at (y, t), the first voxel above 100 or none
+	const GLint pick_threshold = 100;
+	const GLfloat far = 1e5f;
+	GLint no_picks = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(GLint i=0; i<64; i++)
+	{
+		GLint x = i * 4;
+		GLint y = i * 3;
+		GLint t = i * 6;
+		GLint expected[2] = {-1, -1};
+		for(GLint z=depth-1; z>=0 && expected[0] < 0; z--)
+			expected[0] = volume[z * slice_size + (size_t) y * width + x] > pick_threshold ? z : -1;
+		for(GLint v=0; v<width && expected[1] < 0; v++)
+			expected[1] = volume[t * slice_size + (size_t) y * width + v] > pick_threshold ? v : -1;
+
+		const GLfloat origins[2][3] = {{(GLfloat) x, (GLfloat) y, far}, {-far, (GLfloat) y, (GLfloat) t}};
+		const GLfloat directions[2][3] = {{0, 0, -1}, {1, 0, 0}};
+		for(GLint r=0; r<2; r++)
+		{
+			GLint voxel[3] = {-1, -1, -1};
+			GLboolean hit = sparse.pick(origins[r], directions[r], pick_threshold, voxel);
+			GLint found = !hit ? -1 : r == 0 ? voxel[2] : voxel[0];
+			if(found != expected[r])
+			{
+				std::cout << "error: pick along " << (r == 0 ? "t" : "x") << " from (" << origins[r][0] << ", " << origins[r][1] << ", " << origins[r][2]
+						  << ") found " << found << ", the scan " << expected[r] << std::endl;
+				delete[] volume;
+				return EXIT_FAILURE;
+			}
+			no_picks++;
+		}
+	}
+	std::cout << "  pick: " << no_picks << " axis aligned rays from " << far << " voxels away match the scan, "
+			  << std::setprecision(2) << seconds(start) * 1e6 / no_picks << " us per pick (scan included)" << std::endl;
+
+	delete[] volume;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * CPU raycasting of a synthetic 256x256x400 8Bit level (a noisy ball) into 512x512 pixels,
+ * side view turned by 30 degrees: MIP and compositing, scalar/AVX2 kernels on 1..N cores.
+ * The AVX2 images have to be the scalar ones bit for bit.
+ */
+static GLint benchmarkRaycast()
+{
+	const GLint width = 256;
+	const GLint height = 256;
+	const GLint depth = 400;
+	const GLint image_size = 512;
+
+	std::vector<GLubyte> volume((size_t) width * height * depth);
+	srand(1);
+	for(GLint t=0; t<depth; t++)
+		for(GLint y=0; y<height; y++)
+			for(GLint x=0; x<width; x++)
+			{
+				GLfloat dx = (x + 0.5f) / width - 0.5f;
+				GLfloat dy = (y + 0.5f) / height - 0.5f;
+				GLfloat dt = (t + 0.5f) / depth - 0.5f;
+				GLfloat r = sqrtf(dx * dx + dy * dy + dt * dt) / 0.45f;
+				volume[((size_t) t * height + y) * width + x] = (GLubyte) (r < 1 ? (1 - r) * (128 + rand() % 128) : 0);
+			}
+
+	GLubyte palette[3 * 256];
+	for(GLint i=0; i<256; i++)
+	{
+		palette[i * 3] = (GLubyte) i;
+		palette[i * 3 + 1] = (GLubyte) (255 - i);
+		palette[i * 3 + 2] = (GLubyte) (i / 2);
+	}
+
+	// rotation about y by 90 + 30 degrees, column major
+	GLfloat angle = 2 * GL_PI / 3;
+	GLfloat rotation[16] = {cosf(angle), 0, -sinf(angle), 0, 0, 1, 0, 0, sinf(angle), 0, cosf(angle), 0, 0, 0, 0, 1};
+
+	const GLchar* kernels[] = {"scalar", "avx2"};
+	const GLchar* mode_names[] = {"mip", "composite"};
+	GLWorkerPool check_pool(1);
+	GLRaycaster reference(&check_pool);
+	GLRaycaster check(&check_pool);
+	reference.setKernel("scalar");
+	reference.setVolume(volume.data(), width, height, depth);
+	reference.setTransfer(palette, 128);
+	check.setVolume(volume.data(), width, height, depth);
+	check.setTransfer(palette, 128);
+	if(check.setKernel("avx2"))
+	{
+		for(GLint m=0; m<2; m++)
+		{
+			reference.render(rotation, 1, image_size, image_size, (GLRaycastMode) m);
+			check.render(rotation, 1, image_size, image_size, (GLRaycastMode) m);
+			if(memcmp(reference.getImage(), check.getImage(), (size_t) image_size * image_size * 3) != 0)
+			{
+				std::cout << "error: raycast kernel avx2 differs from scalar (" << mode_names[m] << ")" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	GLint max_threads = (GLint) std::thread::hardware_concurrency();
+	max_threads = max_threads > 0 ? max_threads : 1;
+
+	std::cout << "raycast: " << width << "x" << height << "x" << depth << " 8Bit into " << image_size << "x" << image_size
+			  << ", ms, best of " << BENCHMARK_RUNS << std::endl;
+	std::cout << "  kernel  cores        mip  composite" << std::endl;
+	for(GLint k=0; k<2; k++)
+	{
+		for(GLint threads=1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads)
+		{
+			GLWorkerPool pool(threads);
+			GLRaycaster raycaster(&pool);
+			if(!raycaster.setKernel(kernels[k]))
+				break;
+			raycaster.setVolume(volume.data(), width, height, depth);
+			raycaster.setTransfer(palette, 128);
+
+			GLdouble best[2] = {1e30, 1e30};
+			for(GLint m=0; m<2; m++)
+			{
+				for(GLint run=0; run<BENCHMARK_RUNS; run++)
+				{
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					raycaster.render(rotation, 1, image_size, image_size, (GLRaycastMode) m);
+					GLdouble time = seconds(start) * 1e3;
+					best[m] = time < best[m] ? time : best[m];
+				}
+			}
+			std::cout << "  " << std::left << std::setw(8) << kernels[k] << std::right << std::fixed << std::setprecision(1)
+					  << std::setw(5) << threads << std::setw(11) << best[0] << std::setw(11) << best[1] << std::endl;
+
+			if(threads == max_threads)
+				break;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+GLint runBenchmark(const GLchar* _name)
+{
+	if(strcmp(_name, "unpack12") == 0)
+		return benchmarkUnpack12();
+	if(strcmp(_name, "cuts") == 0)
+		return benchmarkCuts();
+	if(strcmp(_name, "normalize") == 0)
+		return benchmarkNormalize();
+	if(strcmp(_name, "reduce") == 0)
+		return benchmarkReduce();
+	if(strcmp(_name, "resample") == 0)
+		return benchmarkResample();
+	if(strcmp(_name, "summed") == 0)
+		return benchmarkSummed();
+	if(strcmp(_name, "smooth") == 0)
+		return benchmarkSmooth();
+	if(strcmp(_name, "correct") == 0)
+		return benchmarkCorrect();
+	if(strcmp(_name, "sparse") == 0)
+		return benchmarkSparse();
+	if(strcmp(_name, "raycast") == 0)
+		return benchmarkRaycast();
+
+	std::cout << "error: unknown benchmark " << _name << ", available: unpack12, cuts, normalize, reduce, resample, summed, smooth, correct, sparse, raycast" << std::endl;
+	return EXIT_FAILURE;
+}
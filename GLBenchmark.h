@@ -0,0 +1,12 @@
+#ifndef GLBENCHMARK_H
+#define GLBENCHMARK_H
+
+#include <GL/gl.h>
+
+/**
+ * Micro benchmarks of the data processing kernels, run with
+ * ./trackball --benchmark <name> (no window is opened)
+ */
+GLint runBenchmark(const GLchar* _name);
+
+#endif
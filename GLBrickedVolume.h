@@ -0,0 +1,251 @@
+#ifndef GLBRICKEDVOLUME_H
+#define GLBRICKEDVOLUME_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * Volume storage layouts with a common cut interface, x is the fastest axis
+ * of every extracted cut:
+ *
+ *   extractXY(z, out)  out[y * width + x]
+ *   extractEY(x, out)  out[z * height + y]
+ *   extractEX(y, out)  out[z * width + x]
+ *   extractOblique(origin, u, v, out_width, out_height, out)
+ *                      out[j * out_width + i] = voxel(origin + i * u + j * v), nearest neighbour, 0 outside
+ */
+
+/**
+ * x-fastest, then y, then z (like data_DLD), the volume is not owned
+ */
+template <typename T>
+class GLLinearVolume
+{
+	public:
+		GLLinearVolume(T* _data, GLint _width, GLint _height, GLint _depth)
+		{
+			data = _data;
+			width = _width;
+			height = _height;
+			depth = _depth;
+		}
+
+		T get(GLint _x, GLint _y, GLint _z)
+		{
+			return data[((size_t) _z * height + _y) * width + _x];
+		}
+
+		GLvoid extractXY(GLint _z, T* _out)
+		{
+			memcpy(_out, data + (size_t) _z * width * height, (size_t) width * height * sizeof(T));
+		}
+
+		GLvoid extractEY(GLint _x, T* _out)
+		{
+			for(GLint z=0; z<depth; z++)
+				for(GLint y=0; y<height; y++)
+					_out[z * height + y] = data[((size_t) z * height + y) * width + _x];
+		}
+
+		GLvoid extractEX(GLint _y, T* _out)
+		{
+			for(GLint z=0; z<depth; z++)
+				memcpy(_out + z * width, data + ((size_t) z * height + _y) * width, width * sizeof(T));
+		}
+
+		GLvoid extractOblique(const GLfloat* _origin, const GLfloat* _u, const GLfloat* _v, GLint _out_width, GLint _out_height, T* _out)
+		{
+			for(GLint j=0; j<_out_height; j++)
+			{
+				for(GLint i=0; i<_out_width; i++)
+				{
+					GLint x = (GLint) floorf(_origin[0] + i * _u[0] + j * _v[0] + 0.5f);
+					GLint y = (GLint) floorf(_origin[1] + i * _u[1] + j * _v[1] + 0.5f);
+					GLint z = (GLint) floorf(_origin[2] + i * _u[2] + j * _v[2] + 0.5f);
+					GLboolean inside = x >= 0 && x < width && y >= 0 && y < height && z >= 0 && z < depth;
+					_out[j * _out_width + i] = inside ? get(x, y, z) : 0;
+				}
+			}
+		}
+
+	private:
+		T* data;
+		GLint width;
+		GLint height;
+		GLint depth;
+};
+
+
+/**
+ * The volume is split into cubic bricks of brick_size^3 voxels (a power of two),
+ * each brick is contiguous (x-fastest inside), brick_index maps a brick position
+ * to its offset. Every cut orientation touches whole bricks of a few KB instead
+ * of one cache line per voxel.
+ */
+template <typename T>
+class GLBrickedVolume
+{
+	public:
+		GLBrickedVolume(GLint _width, GLint _height, GLint _depth, GLint _brick_size = 16)
+		{
+			width = _width;
+			height = _height;
+			depth = _depth;
+
+			brick_shift = 0;
+			while((1 << brick_shift) < _brick_size)
+				brick_shift++;
+			brick_size = 1 << brick_shift;
+			brick_mask = brick_size - 1;
+			brick_voxels = (size_t) brick_size * brick_size * brick_size;
+
+			bricks_x = (width + brick_mask) >> brick_shift;
+			bricks_y = (height + brick_mask) >> brick_shift;
+			bricks_z = (depth + brick_mask) >> brick_shift;
+
+			GLint no_bricks = bricks_x * bricks_y * bricks_z;
+			brick_index = new size_t[no_bricks];
+			for(GLint b=0; b<no_bricks; b++)
+				brick_index[b] = b * brick_voxels;
+
+			data = new T[no_bricks * brick_voxels];
+			memset(data, 0, no_bricks * brick_voxels * sizeof(T));
+		}
+
+		~GLBrickedVolume()
+		{
+			delete[] data;
+			delete[] brick_index;
+		}
+
+		GLint getWidth() { return width; }
+		GLint getHeight() { return height; }
+		GLint getDepth() { return depth; }
+		GLint getBrickSize() { return brick_size; }
+
+		T* brick(GLint _bx, GLint _by, GLint _bz)
+		{
+			return data + brick_index[(_bz * bricks_y + _by) * bricks_x + _bx];
+		}
+
+		T get(GLint _x, GLint _y, GLint _z)
+		{
+			return brick(_x >> brick_shift, _y >> brick_shift, _z >> brick_shift)
+					[(((_z & brick_mask) << brick_shift | (_y & brick_mask)) << brick_shift) | (_x & brick_mask)];
+		}
+
+		// scatters a x-fastest slice into the bricks
+		GLvoid setSlice(GLint _z, const T* _slice)
+		{
+			GLint bz = _z >> brick_shift;
+			size_t z_offset = (size_t) (_z & brick_mask) << (2 * brick_shift);
+
+			for(GLint y=0; y<height; y++)
+			{
+				size_t yz_offset = z_offset | (size_t) (y & brick_mask) << brick_shift;
+				for(GLint bx=0; bx<bricks_x; bx++)
+				{
+					GLint run = width - (bx << brick_shift) < brick_size ? width - (bx << brick_shift) : brick_size;
+					memcpy(brick(bx, y >> brick_shift, bz) + yz_offset, _slice + y * width + (bx << brick_shift), run * sizeof(T));
+				}
+			}
+		}
+
+		GLvoid extractXY(GLint _z, T* _out)
+		{
+			GLint bz = _z >> brick_shift;
+			size_t z_offset = (size_t) (_z & brick_mask) << (2 * brick_shift);
+
+			for(GLint by=0; by<bricks_y; by++)
+			{
+				for(GLint bx=0; bx<bricks_x; bx++)
+				{
+					const T* b = brick(bx, by, bz) + z_offset;
+					GLint x0 = bx << brick_shift;
+					GLint run = width - x0 < brick_size ? width - x0 : brick_size;
+					for(GLint y = by << brick_shift; y < height && y < (by + 1) << brick_shift; y++)
+						memcpy(_out + y * width + x0, b + ((y & brick_mask) << brick_shift), run * sizeof(T));
+				}
+			}
+		}
+
+		GLvoid extractEY(GLint _x, T* _out)
+		{
+			GLint bx = _x >> brick_shift;
+			GLint x_offset = _x & brick_mask;
+
+			for(GLint bz=0; bz<bricks_z; bz++)
+			{
+				for(GLint by=0; by<bricks_y; by++)
+				{
+					const T* b = brick(bx, by, bz);
+					for(GLint z = bz << brick_shift; z < depth && z < (bz + 1) << brick_shift; z++)
+					{
+						const T* plane = b + ((size_t) (z & brick_mask) << (2 * brick_shift)) + x_offset;
+						for(GLint y = by << brick_shift; y < height && y < (by + 1) << brick_shift; y++)
+							_out[z * height + y] = plane[(y & brick_mask) << brick_shift];
+					}
+				}
+			}
+		}
+
+		GLvoid extractEX(GLint _y, T* _out)
+		{
+			GLint by = _y >> brick_shift;
+			size_t y_offset = (size_t) (_y & brick_mask) << brick_shift;
+
+			for(GLint bz=0; bz<bricks_z; bz++)
+			{
+				for(GLint bx=0; bx<bricks_x; bx++)
+				{
+					const T* b = brick(bx, by, bz) + y_offset;
+					GLint x0 = bx << brick_shift;
+					GLint run = width - x0 < brick_size ? width - x0 : brick_size;
+					for(GLint z = bz << brick_shift; z < depth && z < (bz + 1) << brick_shift; z++)
+						memcpy(_out + z * width + x0, b + ((size_t) (z & brick_mask) << (2 * brick_shift)), run * sizeof(T));
+				}
+			}
+		}
+
+		// walks the output in brick_size tiles, neighbouring samples of a tile share their bricks
+		GLvoid extractOblique(const GLfloat* _origin, const GLfloat* _u, const GLfloat* _v, GLint _out_width, GLint _out_height, T* _out)
+		{
+			for(GLint tj=0; tj<_out_height; tj+=brick_size)
+			{
+				for(GLint ti=0; ti<_out_width; ti+=brick_size)
+				{
+					for(GLint j=tj; j<_out_height && j<tj+brick_size; j++)
+					{
+						for(GLint i=ti; i<_out_width && i<ti+brick_size; i++)
+						{
+							GLint x = (GLint) floorf(_origin[0] + i * _u[0] + j * _v[0] + 0.5f);
+							GLint y = (GLint) floorf(_origin[1] + i * _u[1] + j * _v[1] + 0.5f);
+							GLint z = (GLint) floorf(_origin[2] + i * _u[2] + j * _v[2] + 0.5f);
+							GLboolean inside = x >= 0 && x < width && y >= 0 && y < height && z >= 0 && z < depth;
+							_out[j * _out_width + i] = inside ? get(x, y, z) : 0;
+						}
+					}
+				}
+			}
+		}
+
+	private:
+		GLint width;
+		GLint height;
+		GLint depth;
+
+		GLint brick_shift;
+		GLint brick_size;
+		GLint brick_mask;
+		size_t brick_voxels;
+		GLint bricks_x;
+		GLint bricks_y;
+		GLint bricks_z;
+
+		size_t* brick_index;
+		T* data;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "GLColorLUT.h"
+#include <string.h>
+#include <algorithm>
+
+// clips kept at once, e.g. every slice with its own percentile
+#define COLOR_LUT_MAX_TABLES 256
+
+
+GLColorLUT::GLColorLUT()
+{
+	palette = NULL;
+	alpha = 0;
+	setColors(NULL, 255);
+}
+
+GLvoid GLColorLUT::setColors(const GLubyte* _palette, GLubyte _alpha)
+{
+	if(_palette == palette && _alpha == alpha && !tables.empty())
+		return;
+
+	palette = _palette;
+	alpha = _alpha;
+	for(GLint i=0; i<256; i++)
+	{
+		GLubyte rgba[4] = {(GLubyte) i, (GLubyte) i, (GLubyte) i, alpha};
+		if(palette)
+		{
+			rgba[0] = palette[3 * i];
+			rgba[1] = palette[3 * i + 1];
+			rgba[2] = palette[3 * i + 2];
+		}
+		memcpy(&colors[i], rgba, 4);
+	}
+	dropTables();
+}
+
+GLvoid GLColorLUT::dropTables()
+{
+	for(std::map<GLushort, std::vector<GLuint> >::iterator table=tables.begin(); table!=tables.end(); ++table)
+	{
+		spares.push_back(std::vector<GLuint>());
+		spares.back().swap(table->second);
+	}
+	tables.clear();
+}
+
+const GLuint* GLColorLUT::getTable(GLushort _clip)
+{
+	_clip = _clip > 0 ? _clip : 1;
+
+	std::map<GLushort, std::vector<GLuint> >::iterator table = tables.find(_clip);
+	if(table != tables.end())
+		return table->second.data();
+
+	if(tables.size() >= COLOR_LUT_MAX_TABLES)
+		dropTables();
+
+	std::vector<GLuint>& entries = tables[_clip];
+	if(!spares.empty())
+	{
+		entries.swap(spares.back());
+		spares.pop_back();
+	}
+	entries.resize(65536);
+	buildTable(_clip, entries.data());
+	return entries.data();
+}
+
+GLint GLColorLUT::getNoTables()
+{
+	return (GLint) tables.size();
+}
+
+// count * 255 / clip == i for count in [ceil(i * clip / 255), ceil((i + 1) * clip / 255)), below clip
+GLvoid GLColorLUT::buildTable(GLushort _clip, GLuint* _table)
+{
+	GLuint begin = 0;
+	for(GLuint i=0; i<255 && begin<_clip; i++)
+	{
+		GLuint end = ((i + 1) * _clip + 254) / 255;
+		end = end < _clip ? end : _clip;
+		std::fill(_table + begin, _table + end, colors[i]);
+		begin = end;
+	}
+	std::fill(_table + _clip, _table + 65536, colors[255]);
+}
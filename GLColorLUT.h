@@ -0,0 +1,43 @@
+#ifndef GLCOLORLUT_H
+#define GLCOLORLUT_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+/**
+ * Packed RGBA8 lookup tables from raw 16Bit counts straight to the color of a voxel, for
+ * HIGH_RES: table[count] = color(count < clip ? count * 255 / clip : 255) with the palette
+ * (or grey) and the alpha folded in, so drawing a voxel is one load and glColor4ubv().
+ *
+ * One table of 65536 entries per clip count rate in use (one per slice in the slice contrast
+ * mode), built on first use in runs of equal colors. A new palette or alpha drops all tables,
+ * a new clip only builds the table for it, both cost microseconds instead of a volume pass.
+ * Dropped tables are kept as spare memory for the next ones.
+ * The bytes of an entry are r, g, b, a in memory order.
+ */
+class GLColorLUT
+{
+	public:
+		GLColorLUT();
+
+		// 256 RGB entries, NULL for grey, only drops the tables if anything changed
+		GLvoid setColors(const GLubyte* _palette, GLubyte _alpha);
+		const GLuint* getTable(GLushort _clip);		// _clip >= 1
+
+		GLint getNoTables();
+
+	private:
+		const GLubyte* palette;
+		GLubyte alpha;
+		GLuint colors[256];
+		std::map<GLushort, std::vector<GLuint> > tables;
+		std::vector<std::vector<GLuint> > spares;
+
+		GLvoid dropTables();
+
+		GLvoid buildTable(GLushort _clip, GLuint* _table);
+};
+
+#endif
@@ -0,0 +1,359 @@
+#include "GLCutEngine.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CUT_X86
+#endif
+
+// rows resampled per parallelFor index
+#define CUT_BLOCK_ROWS 8
+
+
+/*
+ * every axis: c0 = min(floor(c), max(dim - 2, 0)), c1 = min(c0 + 1, dim - 1), f = c - c0,
+ * so the last voxel is reached with f = 1 and the x pair c0, c0 + 1 is always inside the row
+ */
+
+template <typename T>
+static GLvoid cutRowScalar(const T* _volume, const GLint* _dims, const GLfloat* _p, const GLfloat* _u,
+						   GLint _first, GLint _end, GLfloat _factor, GLubyte* _out)
+{
+	GLfloat last[3];
+	GLint last_c0[3];
+	for(GLint a=0; a<3; a++)
+	{
+		last[a] = (GLfloat) (_dims[a] - 1);
+		last_c0[a] = _dims[a] >= 2 ? _dims[a] - 2 : 0;
+	}
+	size_t slice_size = (size_t) _dims[0] * _dims[1];
+
+	for(GLint k=_first; k<_end; k++)
+	{
+		GLint c0[3];
+		GLint c1[3];
+		GLfloat f[3];
+		for(GLint a=0; a<3; a++)
+		{
+			GLfloat c = _p[a] + (GLfloat) k * _u[a];
+			c = c < 0.0f ? 0.0f : c;
+			c = c > last[a] ? last[a] : c;
+			c0[a] = (GLint) c;
+			c0[a] = c0[a] < last_c0[a] ? c0[a] : last_c0[a];
+			c1[a] = c0[a] + 1 < _dims[a] ? c0[a] + 1 : _dims[a] - 1;
+			f[a] = c - (GLfloat) c0[a];
+		}
+
+		const T* base = _volume + (c0[2] * slice_size + (size_t) c0[1] * _dims[0] + c0[0]);
+		size_t dx = c1[0] - c0[0];
+		size_t dy = (size_t) (c1[1] - c0[1]) * _dims[0];
+		size_t dz = (c1[2] - c0[2]) * slice_size;
+
+		GLfloat c000 = (GLfloat) base[0];
+		GLfloat c100 = (GLfloat) base[dx];
+		GLfloat c010 = (GLfloat) base[dy];
+		GLfloat c110 = (GLfloat) base[dy + dx];
+		GLfloat c001 = (GLfloat) base[dz];
+		GLfloat c101 = (GLfloat) base[dz + dx];
+		GLfloat c011 = (GLfloat) base[dz + dy];
+		GLfloat c111 = (GLfloat) base[dz + dy + dx];
+
+		GLfloat c00 = c000 + (c100 - c000) * f[0];
+		GLfloat c10 = c010 + (c110 - c010) * f[0];
+		GLfloat c01 = c001 + (c101 - c001) * f[0];
+		GLfloat c11 = c011 + (c111 - c011) * f[0];
+		GLfloat c0_ = c00 + (c10 - c00) * f[1];
+		GLfloat c1_ = c01 + (c11 - c01) * f[1];
+		GLfloat value = (c0_ + (c1_ - c0_) * f[2]) * _factor;
+
+		_out[k] = value < 255.0f ? (GLubyte) value : 255;
+	}
+}
+
+#ifdef CUT_X86
+
+/*
+ * 8 samples per iteration: coordinates, clamping and weights in float lanes,
+ * the corners are gathered (32Bit volumes: 8 gathers, 16Bit volumes: 4 gathers of an x pair each)
+ */
+
+struct CutLanes
+{
+	__m256i index;
+	__m256i dx;
+	__m256i dy;
+	__m256i dz;
+	__m256 f[3];
+};
+
+__attribute__((target("avx2")))
+static inline CutLanes cutLanes(const GLint* _dims, const GLfloat* _p, const GLfloat* _u, GLint _k)
+{
+	const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	__m256 k = _mm256_add_ps(_mm256_set1_ps((GLfloat) _k), lane);
+
+	CutLanes lanes;
+	__m256i c0[3];
+	__m256i c1[3];
+	for(GLint a=0; a<3; a++)
+	{
+		__m256 c = _mm256_add_ps(_mm256_set1_ps(_p[a]), _mm256_mul_ps(k, _mm256_set1_ps(_u[a])));
+		c = _mm256_min_ps(_mm256_max_ps(c, _mm256_setzero_ps()), _mm256_set1_ps((GLfloat) (_dims[a] - 1)));
+		c0[a] = _mm256_min_epi32(_mm256_cvttps_epi32(c), _mm256_set1_epi32(_dims[a] >= 2 ? _dims[a] - 2 : 0));
+		c1[a] = _mm256_min_epi32(_mm256_add_epi32(c0[a], _mm256_set1_epi32(1)), _mm256_set1_epi32(_dims[a] - 1));
+		lanes.f[a] = _mm256_sub_ps(c, _mm256_cvtepi32_ps(c0[a]));
+	}
+
+	const __m256i width = _mm256_set1_epi32(_dims[0]);
+	const __m256i slice_size = _mm256_set1_epi32(_dims[0] * _dims[1]);
+	lanes.index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(c0[2], _mm256_set1_epi32(_dims[1])), c0[1]), width), c0[0]);
+	lanes.dx = _mm256_sub_epi32(c1[0], c0[0]);
+	lanes.dy = _mm256_mullo_epi32(_mm256_sub_epi32(c1[1], c0[1]), width);
+	lanes.dz = _mm256_mullo_epi32(_mm256_sub_epi32(c1[2], c0[2]), slice_size);
+	return lanes;
+}
+
+__attribute__((target("avx2")))
+static inline __m256 lerp(__m256 _a, __m256 _b, __m256 _f)
+{
+	return _mm256_add_ps(_a, _mm256_mul_ps(_mm256_sub_ps(_b, _a), _f));
+}
+
+__attribute__((target("avx2")))
+static inline GLvoid storeCut(__m256 _c0, __m256 _c1, const CutLanes& _lanes, GLfloat _factor, GLubyte* _out)
+{
+	__m256 value = _mm256_mul_ps(lerp(_c0, _c1, _lanes.f[2]), _mm256_set1_ps(_factor));
+	__m256i bytes = _mm256_cvttps_epi32(_mm256_min_ps(value, _mm256_set1_ps(255.0f)));
+	bytes = _mm256_packus_epi32(bytes, bytes);
+	bytes = _mm256_packus_epi16(bytes, bytes);
+	GLint low = _mm_cvtsi128_si32(_mm256_castsi256_si128(bytes));
+	GLint high = _mm_cvtsi128_si32(_mm256_extracti128_si256(bytes, 1));
+	memcpy(_out, &low, 4);
+	memcpy(_out + 4, &high, 4);
+}
+
+__attribute__((target("avx2")))
+static GLvoid cutRow32AVX2(const GLuint* _volume, const GLint* _dims, const GLfloat* _p, const GLfloat* _u,
+						   GLint _first, GLint _end, GLfloat _factor, GLubyte* _out)
+{
+	const GLint* volume = (const GLint*) _volume;
+
+	GLint k = _first;
+	for(; k + 8 <= _end; k+=8)
+	{
+		CutLanes lanes = cutLanes(_dims, _p, _u, k);
+		__m256i i000 = lanes.index;
+		__m256i i010 = _mm256_add_epi32(i000, lanes.dy);
+		__m256i i001 = _mm256_add_epi32(i000, lanes.dz);
+		__m256i i011 = _mm256_add_epi32(i001, lanes.dy);
+
+		__m256 c000 = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(volume, i000, 4));
+		__m256 c100 = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(volume, _mm256_add_epi32(i000, lanes.dx), 4));
+		__m256 c010 = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(volume, i010, 4));
+		__m256 c110 = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(volume, _mm256_add_epi32(i010, lanes.dx), 4));
+		__m256 c001 = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(volume, i001, 4));
+		__m256 c101 = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(volume, _mm256_add_epi32(i001, lanes.dx), 4));
+		__m256 c011 = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(volume, i011, 4));
+		__m256 c111 = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(volume, _mm256_add_epi32(i011, lanes.dx), 4));
+
+		__m256 c0 = lerp(lerp(c000, c100, lanes.f[0]), lerp(c010, c110, lanes.f[0]), lanes.f[1]);
+		__m256 c1 = lerp(lerp(c001, c101, lanes.f[0]), lerp(c011, c111, lanes.f[0]), lanes.f[1]);
+		storeCut(c0, c1, lanes, _factor, _out + k);
+	}
+	cutRowScalar(_volume, _dims, _p, _u, k, _end, _factor, _out);
+}
+
+// needs a volume width >= 2, the x pair of a corner is one 32Bit gather
+__attribute__((target("avx2")))
+static GLvoid cutRow16AVX2(const GLushort* _volume, const GLint* _dims, const GLfloat* _p, const GLfloat* _u,
+						   GLint _first, GLint _end, GLfloat _factor, GLubyte* _out)
+{
+	const GLint* volume = (const GLint*) _volume;
+	const __m256i low_mask = _mm256_set1_epi32(0xFFFF);
+
+	GLint k = _first;
+	for(; k + 8 <= _end; k+=8)
+	{
+		CutLanes lanes = cutLanes(_dims, _p, _u, k);
+		__m256i i000 = lanes.index;
+		__m256i i001 = _mm256_add_epi32(i000, lanes.dz);
+
+		__m256i p00 = _mm256_i32gather_epi32(volume, i000, 2);
+		__m256i p10 = _mm256_i32gather_epi32(volume, _mm256_add_epi32(i000, lanes.dy), 2);
+		__m256i p01 = _mm256_i32gather_epi32(volume, i001, 2);
+		__m256i p11 = _mm256_i32gather_epi32(volume, _mm256_add_epi32(i001, lanes.dy), 2);
+
+		__m256 c00 = lerp(_mm256_cvtepi32_ps(_mm256_and_si256(p00, low_mask)), _mm256_cvtepi32_ps(_mm256_srli_epi32(p00, 16)), lanes.f[0]);
+		__m256 c10 = lerp(_mm256_cvtepi32_ps(_mm256_and_si256(p10, low_mask)), _mm256_cvtepi32_ps(_mm256_srli_epi32(p10, 16)), lanes.f[0]);
+		__m256 c01 = lerp(_mm256_cvtepi32_ps(_mm256_and_si256(p01, low_mask)), _mm256_cvtepi32_ps(_mm256_srli_epi32(p01, 16)), lanes.f[0]);
+		__m256 c11 = lerp(_mm256_cvtepi32_ps(_mm256_and_si256(p11, low_mask)), _mm256_cvtepi32_ps(_mm256_srli_epi32(p11, 16)), lanes.f[0]);
+
+		storeCut(lerp(c00, c10, lanes.f[1]), lerp(c01, c11, lanes.f[1]), lanes, _factor, _out + k);
+	}
+	cutRowScalar(_volume, _dims, _p, _u, k, _end, _factor, _out);
+}
+
+#endif
+
+template <typename T>
+static GLvoid cutRow(GLint _kernel, const T* _volume, const GLint* _dims, const GLfloat* _p, const GLfloat* _u,
+					 GLint _first, GLint _end, GLfloat _factor, GLubyte* _out);
+
+template <>
+GLvoid cutRow<GLuint>(GLint _kernel, const GLuint* _volume, const GLint* _dims, const GLfloat* _p, const GLfloat* _u,
+					  GLint _first, GLint _end, GLfloat _factor, GLubyte* _out)
+{
+#ifdef CUT_X86
+	if(_kernel == KERNEL_AVX2)
+		return cutRow32AVX2(_volume, _dims, _p, _u, _first, _end, _factor, _out);
+#endif
+	cutRowScalar(_volume, _dims, _p, _u, _first, _end, _factor, _out);
+}
+
+template <>
+GLvoid cutRow<GLushort>(GLint _kernel, const GLushort* _volume, const GLint* _dims, const GLfloat* _p, const GLfloat* _u,
+						GLint _first, GLint _end, GLfloat _factor, GLubyte* _out)
+{
+#ifdef CUT_X86
+	if(_kernel == KERNEL_AVX2 && _dims[0] >= 2)
+		return cutRow16AVX2(_volume, _dims, _p, _u, _first, _end, _factor, _out);
+#endif
+	cutRowScalar(_volume, _dims, _p, _u, _first, _end, _factor, _out);
+}
+
+
+GLCutEngine::GLCutEngine(GLWorkerPool* _pool)
+{
+	pool = _pool;
+	volume = NULL;
+	valid = false;
+	setKernel(NULL);
+}
+
+GLboolean GLCutEngine::setKernel(const GLchar* _name)
+{
+	if(!selectKernel(_name, &kernel))
+		return false;
+
+	valid = false;
+	return true;
+}
+
+GLboolean GLCutEngine::cut(const GLuint* _volume, GLint _width, GLint _height, GLint _depth, const GLCutPlane& _plane,
+						   GLfloat _factor, uint64_t _stamp)
+{
+	if(isCached(_volume, _width, _height, _depth, _plane, _factor, _stamp))
+		return false;
+
+	prepare(_volume, _width, _height, _depth, _plane, _factor, _stamp);
+	resample(_volume);
+	return true;
+}
+
+GLboolean GLCutEngine::cut(const GLushort* _volume, GLint _width, GLint _height, GLint _depth, const GLCutPlane& _plane,
+						   GLfloat _factor, uint64_t _stamp)
+{
+	if(isCached(_volume, _width, _height, _depth, _plane, _factor, _stamp))
+		return false;
+
+	prepare(_volume, _width, _height, _depth, _plane, _factor, _stamp);
+	resample(_volume);
+	return true;
+}
+
+GLvoid GLCutEngine::invalidate()
+{
+	valid = false;
+}
+
+GLboolean GLCutEngine::isCached(const GLvoid* _volume, GLint _width, GLint _height, GLint _depth, const GLCutPlane& _plane,
+								GLfloat _factor, uint64_t _stamp)
+{
+	return valid && volume == _volume && dims[0] == _width && dims[1] == _height && dims[2] == _depth
+			&& factor == _factor && stamp == _stamp && memcmp(&plane, &_plane, sizeof(GLCutPlane)) == 0;
+}
+
+// clips every row of the plane against the volume box, samples outside are never touched
+GLvoid GLCutEngine::prepare(const GLvoid* _volume, GLint _width, GLint _height, GLint _depth, const GLCutPlane& _plane,
+							GLfloat _factor, uint64_t _stamp)
+{
+	volume = _volume;
+	dims[0] = _width;
+	dims[1] = _height;
+	dims[2] = _depth;
+	plane = _plane;
+	factor = _factor;
+	stamp = _stamp;
+	valid = true;
+
+	samples.resize((size_t) plane.width * plane.height);
+	row_begin.resize(plane.height);
+	row_end.resize(plane.height);
+
+	for(GLint j=0; j<plane.height; j++)
+	{
+		GLdouble begin = 0;
+		GLdouble end = plane.width - 1;
+		for(GLint a=0; a<3; a++)
+		{
+			GLdouble p = plane.origin[a] + (GLdouble) j * plane.v[a];
+			GLdouble last = dims[a] - 1;
+			if(fabs(plane.u[a]) < 1e-9)
+			{
+				if(p < 0 || p > last)
+					end = -1;
+				continue;
+			}
+			GLdouble t0 = -p / plane.u[a];
+			GLdouble t1 = (last - p) / plane.u[a];
+			begin = fmax(begin, fmin(t0, t1));
+			end = fmin(end, fmax(t0, t1));
+		}
+		row_begin[j] = (GLint) ceil(begin);
+		row_end[j] = end < begin ? row_begin[j] : (GLint) floor(end) + 1;
+	}
+}
+
+template <typename T>
+GLvoid GLCutEngine::resample(const T* _volume)
+{
+	GLint no_blocks = (plane.height + CUT_BLOCK_ROWS - 1) / CUT_BLOCK_ROWS;
+	pool->parallelFor(0, no_blocks, [&](GLint _block)
+	{
+		GLint end_row = (_block + 1) * CUT_BLOCK_ROWS < plane.height ? (_block + 1) * CUT_BLOCK_ROWS : plane.height;
+		for(GLint j=_block * CUT_BLOCK_ROWS; j<end_row; j++)
+		{
+			if(row_begin[j] >= row_end[j])
+				continue;
+
+			// the samples of a row are counted from its first one inside the volume
+			GLfloat p[3];
+			for(GLint a=0; a<3; a++)
+				p[a] = plane.origin[a] + (GLfloat) j * plane.v[a] + (GLfloat) row_begin[j] * plane.u[a];
+
+			GLubyte* out = &samples[(size_t) j * plane.width + row_begin[j]];
+			cutRow(kernel, _volume, dims, p, plane.u, 0, row_end[j] - row_begin[j], factor, out);
+		}
+	});
+}
+
+const GLubyte* GLCutEngine::getCut()
+{
+	return samples.data();
+}
+
+const GLCutPlane& GLCutEngine::getPlane()
+{
+	return plane;
+}
+
+GLint GLCutEngine::getRowBegin(GLint _row)
+{
+	return row_begin[_row];
+}
+
+GLint GLCutEngine::getRowEnd(GLint _row)
+{
+	return row_end[_row];
+}
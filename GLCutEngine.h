@@ -0,0 +1,80 @@
+#ifndef GLCUTENGINE_H
+#define GLCUTENGINE_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "GLWorkerPool.h"
+#include "GLKernel.h"
+
+/**
+ * A cut through the volume in voxel coordinates (x, y, t):
+ * sample (i, j) lies at origin + i * u + j * v, 0 <= i < width, 0 <= j < height.
+ * XY, EY and EX are the axis aligned special cases, e.g. EX at y:
+ * origin (0, y, 0), u (1, 0, 0), v (0, 0, 1), width x height = volume width x depth.
+ */
+struct GLCutPlane
+{
+	GLfloat origin[3];
+	GLfloat u[3];
+	GLfloat v[3];
+	GLint width;
+	GLint height;
+};
+
+/**
+ * Resamples a volume (x-fastest, then y, then t, like data_DLD and the pyramid sums)
+ * on a GLCutPlane with trilinear interpolation, the rows are spread over the worker pool.
+ *
+ * out[j * width + i] = min(255, (GLubyte) (trilinear(origin + i * u + j * v) * _factor)),
+ * so _factor = rescaleFactor8(max) gives the normalization of GLNormalize.h.
+ * Only the samples inside the volume are written, row j is valid in [getRowBegin(j), getRowEnd(j)).
+ *
+ * The last cut is kept until the plane, the volume, the factor or _stamp (bumped by the
+ * caller whenever the voxels change) differ, so redrawing an unchanged cut costs nothing.
+ */
+class GLCutEngine
+{
+	public:
+		GLCutEngine(GLWorkerPool* _pool);
+
+		// selectKernel(), the AVX2 kernel gathers the corners of 8 samples at a time
+		GLboolean setKernel(const GLchar* _name);
+
+		// both return true if the cut was resampled, false if the cached one is still valid
+		GLboolean cut(const GLuint* _volume, GLint _width, GLint _height, GLint _depth, const GLCutPlane& _plane,
+					  GLfloat _factor, uint64_t _stamp);
+		GLboolean cut(const GLushort* _volume, GLint _width, GLint _height, GLint _depth, const GLCutPlane& _plane,
+					  GLfloat _factor, uint64_t _stamp);
+		GLvoid invalidate();
+
+		const GLubyte* getCut();
+		const GLCutPlane& getPlane();
+		GLint getRowBegin(GLint _row);
+		GLint getRowEnd(GLint _row);
+
+	private:
+		GLWorkerPool* pool;
+		GLint kernel;		// GLKernel
+
+		GLCutPlane plane;
+		const GLvoid* volume;
+		GLint dims[3];
+		GLfloat factor;
+		uint64_t stamp;
+		GLboolean valid;
+
+		std::vector<GLubyte> samples;
+		std::vector<GLint> row_begin;
+		std::vector<GLint> row_end;
+
+		GLboolean isCached(const GLvoid* _volume, GLint _width, GLint _height, GLint _depth, const GLCutPlane& _plane,
+						   GLfloat _factor, uint64_t _stamp);
+		GLvoid prepare(const GLvoid* _volume, GLint _width, GLint _height, GLint _depth, const GLCutPlane& _plane,
+					   GLfloat _factor, uint64_t _stamp);
+		template <typename T>
+		GLvoid resample(const T* _volume);
+};
+
+#endif
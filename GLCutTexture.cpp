@@ -0,0 +1,89 @@
+#include "GLCutTexture.h"
+#include <string.h>
+
+
+GLCutTexture::GLCutTexture()
+{
+	memset(&plane, 0, sizeof(plane));
+	size[0] = 0;
+	size[1] = 0;
+	texture = 0;
+}
+
+GLCutTexture::~GLCutTexture()
+{
+	if(texture)
+		glDeleteTextures(1, &texture);
+}
+
+GLboolean GLCutTexture::isOutdated(const GLuint* _key, GLint _size)
+{
+	return key.isOutdated(_key, _size);
+}
+
+GLubyte* GLCutTexture::getTexels(GLint _width, GLint _height)
+{
+	texels.assign((size_t) _width * _height * 4, 0);
+	return texels.data();
+}
+
+static GLint powerOfTwo(GLint _size)
+{
+	GLint power = 1;
+	while(power < _size)
+		power *= 2;
+	return power;
+}
+
+GLvoid GLCutTexture::upload(const GLCutPlane& _plane)
+{
+	plane = _plane;
+	if(plane.width <= 0 || plane.height <= 0)
+		return;
+
+	if(!texture)
+		glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	// the texture only grows, a smaller cut uses its lower left corner
+	if(plane.width > size[0] || plane.height > size[1])
+	{
+		size[0] = powerOfTwo(plane.width > size[0] ? plane.width : size[0]);
+		size[1] = powerOfTwo(plane.height > size[1] ? plane.height : size[1]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size[0], size[1], 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GLvoid GLCutTexture::draw()
+{
+	if(!texture || plane.width <= 0 || plane.height <= 0)
+		return;
+
+	// the quad reaches half a sample beyond the outer samples, so every texel covers its sample
+	GLfloat s = plane.width / (GLfloat) size[0];
+	GLfloat t = plane.height / (GLfloat) size[1];
+	GLfloat corners[4][2] = {{-0.5f, -0.5f}, {plane.width - 0.5f, -0.5f}, {plane.width - 0.5f, plane.height - 0.5f}, {-0.5f, plane.height - 0.5f}};
+	GLfloat coords[4][2] = {{0, 0}, {s, 0}, {s, t}, {0, t}};
+
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glBegin(GL_QUADS);
+	for(GLint c=0; c<4; c++)
+	{
+		glTexCoord2f(coords[c][0], coords[c][1]);
+		glVertex3f(plane.origin[0] + corners[c][0] * plane.u[0] + corners[c][1] * plane.v[0],
+				   plane.origin[1] + corners[c][0] * plane.u[1] + corners[c][1] * plane.v[1],
+				   plane.origin[2] + corners[c][0] * plane.u[2] + corners[c][1] * plane.v[2]);
+	}
+	glEnd();
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+}
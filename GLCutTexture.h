@@ -0,0 +1,41 @@
+#ifndef GLCUTTEXTURE_H
+#define GLCUTTEXTURE_H
+
+#include <GL/gl.h>
+#include <vector>
+#include "GLCutEngine.h"
+#include "GLRetainedKey.h"
+
+/**
+ * Retained image of a cut: one RGBA texel per sample of a GLCutPlane, built on the CPU only
+ * when the key or the samples change, uploaded into a 2D texture and drawn as a single quad
+ * spanning the plane in whatever modelview matrix is current, so a redraw costs one quad
+ * instead of one point per sample. Texels that are not drawn keep an alpha of 0.
+ *
+ * The texture is allocated at the next power of two sizes and the image goes into its lower
+ * left corner, so GL 1.1 without non power of two textures is enough. It is created on the
+ * first upload(), which needs the GL context.
+ */
+class GLCutTexture
+{
+	public:
+		GLCutTexture();
+		~GLCutTexture();
+
+		GLboolean isOutdated(const GLuint* _key, GLint _size);	// GLRetainedKey
+
+		// _width x _height RGBA texels cleared to 0 to build into, row j at j * _width * 4
+		GLubyte* getTexels(GLint _width, GLint _height);
+		// texel (i, j) is centered on sample (i, j) of _plane
+		GLvoid upload(const GLCutPlane& _plane);
+		GLvoid draw();
+
+	private:
+		GLRetainedKey key;
+		std::vector<GLubyte> texels;
+		GLCutPlane plane;
+		GLint size[2];			// of the texture, 0 until the first upload
+		GLuint texture;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "GLHeadless.h"
+#include <EGL/eglext.h>
+#include <iostream>
+
+
+GLHeadlessContext::GLHeadlessContext()
+{
+	display = EGL_NO_DISPLAY;
+	surface = EGL_NO_SURFACE;
+	context = EGL_NO_CONTEXT;
+}
+
+GLHeadlessContext::~GLHeadlessContext()
+{
+	if(display == EGL_NO_DISPLAY)
+		return;
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if(context != EGL_NO_CONTEXT)
+		eglDestroyContext(display, context);
+	if(surface != EGL_NO_SURFACE)
+		eglDestroySurface(display, surface);
+	eglTerminate(display);
+}
+
+GLboolean GLHeadlessContext::create(GLint _width, GLint _height)
+{
+	// the surfaceless platform needs neither X nor a render node
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if(getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if(display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cout << "error: no EGL display for headless rendering" << std::endl;
+		display = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	const EGLint config_attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+										EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_NONE};
+	const EGLint surface_attributes[] = {EGL_WIDTH, _width, EGL_HEIGHT, _height, EGL_NONE};
+	EGLConfig config;
+	EGLint no_configs = 0;
+	if(!eglChooseConfig(display, config_attributes, &config, 1, &no_configs) || no_configs == 0 || !eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "error: EGL " << major << "." << minor << " has no OpenGL pbuffer config" << std::endl;
+		return false;
+	}
+
+	surface = eglCreatePbufferSurface(display, config, surface_attributes);
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+	if(surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+	{
+		std::cout << "error: cannot create a " << _width << "x" << _height << " EGL pbuffer context (0x" << std::hex << eglGetError()
+				  << std::dec << ")" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+const GLchar* GLHeadlessContext::getRenderer()
+{
+	return (const GLchar*) glGetString(GL_RENDERER);
+}
@@ -0,0 +1,30 @@
+#ifndef GLHEADLESS_H
+#define GLHEADLESS_H
+
+#include <GL/gl.h>
+#include <EGL/egl.h>
+
+/**
+ * OpenGL context without a window or display server: an EGL pbuffer on Mesa's surfaceless
+ * platform (EGL_MESA_platform_surfaceless, llvmpipe if there is no GPU), falling back to
+ * the default EGL display. The context has the compatibility profile, so the fixed function
+ * code of render() runs unchanged. After create() it is current on the calling thread.
+ */
+class GLHeadlessContext
+{
+	public:
+		GLHeadlessContext();
+		~GLHeadlessContext();
+
+		// false (with a message) if there is no EGL OpenGL context of that size
+		GLboolean create(GLint _width, GLint _height);
+
+		const GLchar* getRenderer();
+
+	private:
+		EGLDisplay display;
+		EGLSurface surface;
+		EGLContext context;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "GLHistogram.h"
+#include <string.h>
+
+// bins merged per parallelFor index
+#define MERGE_BLOCK 256
+
+
+GLSliceHistograms::GLSliceHistograms()
+{
+	capacity = 0;
+	histograms = NULL;
+	merged = new uint64_t[HISTOGRAM_BINS];
+	memset(merged, 0, HISTOGRAM_BINS * sizeof(uint64_t));
+}
+
+GLSliceHistograms::~GLSliceHistograms()
+{
+	delete[] histograms;
+	delete[] merged;
+}
+
+GLvoid GLSliceHistograms::reserve(GLint _capacity)
+{
+	if(_capacity <= capacity)
+		return;
+
+	GLuint* new_histograms = new GLuint[(size_t) HISTOGRAM_BINS * _capacity];
+	memset(new_histograms, 0, (size_t) HISTOGRAM_BINS * _capacity * sizeof(GLuint));
+	if(capacity > 0)
+		memcpy(new_histograms, histograms, (size_t) HISTOGRAM_BINS * capacity * sizeof(GLuint));
+
+	delete[] histograms;
+	histograms = new_histograms;
+	capacity = _capacity;
+}
+
+GLvoid GLSliceHistograms::addSlice(GLint _time_slice, const GLushort* _slice, size_t _count)
+{
+	// four partial histograms, runs of equal counts (mostly 0) do not wait on one another
+	GLuint* partial = new GLuint[4 * HISTOGRAM_BINS];
+	memset(partial, 0, 4 * HISTOGRAM_BINS * sizeof(GLuint));
+
+	size_t i = 0;
+	for(; i + 4 <= _count; i+=4)
+	{
+		partial[_slice[i] < HISTOGRAM_BINS ? _slice[i] : HISTOGRAM_BINS - 1]++;
+		partial[HISTOGRAM_BINS + (_slice[i + 1] < HISTOGRAM_BINS ? _slice[i + 1] : HISTOGRAM_BINS - 1)]++;
+		partial[2 * HISTOGRAM_BINS + (_slice[i + 2] < HISTOGRAM_BINS ? _slice[i + 2] : HISTOGRAM_BINS - 1)]++;
+		partial[3 * HISTOGRAM_BINS + (_slice[i + 3] < HISTOGRAM_BINS ? _slice[i + 3] : HISTOGRAM_BINS - 1)]++;
+	}
+	for(; i<_count; i++)
+		partial[_slice[i] < HISTOGRAM_BINS ? _slice[i] : HISTOGRAM_BINS - 1]++;
+
+	GLuint* histogram = histograms + (size_t) _time_slice * HISTOGRAM_BINS;
+	for(GLint b=0; b<HISTOGRAM_BINS; b++)
+		histogram[b] = partial[b] + partial[HISTOGRAM_BINS + b] + partial[2 * HISTOGRAM_BINS + b] + partial[3 * HISTOGRAM_BINS + b];
+
+	delete[] partial;
+}
+
+GLvoid GLSliceHistograms::loadSlices(const GLuint* _histograms, GLint _no_slices)
+{
+	memcpy(histograms, _histograms, (size_t) HISTOGRAM_BINS * _no_slices * sizeof(GLuint));
+}
+
+GLvoid GLSliceHistograms::merge(GLint _no_slices, GLWorkerPool* _pool)
+{
+	_pool->parallelFor(0, HISTOGRAM_BINS / MERGE_BLOCK, [&](GLint _block)
+	{
+		for(GLint b=_block * MERGE_BLOCK; b<(_block + 1) * MERGE_BLOCK; b++)
+			merged[b] = 0;
+		for(GLint t=0; t<_no_slices; t++)
+		{
+			const GLuint* histogram = histograms + (size_t) t * HISTOGRAM_BINS;
+			for(GLint b=_block * MERGE_BLOCK; b<(_block + 1) * MERGE_BLOCK; b++)
+				merged[b] += histogram[b];
+		}
+	});
+}
+
+GLushort GLSliceHistograms::percentile(GLint _time_slice, GLfloat _percent)
+{
+	uint64_t total = 0;
+	for(GLint b=0; b<HISTOGRAM_BINS; b++)
+		total += _time_slice < 0 ? merged[b] : histograms[(size_t) _time_slice * HISTOGRAM_BINS + b];
+
+	uint64_t limit = (uint64_t) (total * (_percent / 100.0));
+	uint64_t sum = 0;
+	for(GLint b=0; b<HISTOGRAM_BINS; b++)
+	{
+		sum += _time_slice < 0 ? merged[b] : histograms[(size_t) _time_slice * HISTOGRAM_BINS + b];
+		if(sum >= limit && sum > 0)
+			return (GLushort) (b > 1 ? b : 1);
+	}
+	return HISTOGRAM_BINS - 1;
+}
+
+const GLuint* GLSliceHistograms::getSlice(GLint _time_slice)
+{
+	return histograms + (size_t) _time_slice * HISTOGRAM_BINS;
+}
+
+const uint64_t* GLSliceHistograms::getMerged()
+{
+	return merged;
+}
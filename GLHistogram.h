@@ -0,0 +1,46 @@
+#ifndef GLHISTOGRAM_H
+#define GLHISTOGRAM_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "GLWorkerPool.h"
+
+#define HISTOGRAM_BINS 4096		// one bin per 12Bit count rate, higher counts end up in the last bin
+
+/**
+ * Count rate histogram of every raw slice plus the merged histogram of the stack,
+ * the base of percentile clipping: the contrast is changed without touching a voxel.
+ *
+ * addSlice() may run concurrently for different slices, reserve() and merge()
+ * must not run concurrently with anything else.
+ */
+class GLSliceHistograms
+{
+	public:
+		GLSliceHistograms();
+		~GLSliceHistograms();
+
+		// grows to _capacity slices, new histograms are empty
+		GLvoid reserve(GLint _capacity);
+
+		GLvoid addSlice(GLint _time_slice, const GLushort* _slice, size_t _count);
+		// copies _no_slices histograms, e.g. from a GLVolumeCache
+		GLvoid loadSlices(const GLuint* _histograms, GLint _no_slices);
+		// sums the first _no_slices histograms up, the bins are spread over _pool
+		GLvoid merge(GLint _no_slices, GLWorkerPool* _pool);
+
+		// smallest count rate (>= 1) with at least _percent % of the voxels at or below it,
+		// of one slice or of the merged histogram (_time_slice < 0)
+		GLushort percentile(GLint _time_slice, GLfloat _percent);
+
+		const GLuint* getSlice(GLint _time_slice);	// HISTOGRAM_BINS each, slice after slice
+		const uint64_t* getMerged();
+
+	private:
+		GLint capacity;
+		GLuint* histograms;
+		uint64_t* merged;
+};
+
+#endif
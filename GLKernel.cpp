@@ -0,0 +1,34 @@
+#include "GLKernel.h"
+#include <string.h>
+
+
+GLboolean cpuHasAVX2()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+GLboolean cpuHasSSE41()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_cpu_supports("sse4.1") != 0;
+#else
+	return false;
+#endif
+}
+
+GLboolean selectKernel(const GLchar* _name, GLint* _kernel)
+{
+	if(_name == NULL)
+		*_kernel = cpuHasAVX2() ? KERNEL_AVX2 : KERNEL_SCALAR;
+	else if(strcmp(_name, "scalar") == 0)
+		*_kernel = KERNEL_SCALAR;
+	else if(strcmp(_name, "avx2") == 0 && cpuHasAVX2())
+		*_kernel = KERNEL_AVX2;
+	else
+		return false;
+	return true;
+}
@@ -0,0 +1,24 @@
+#ifndef GLKERNEL_H
+#define GLKERNEL_H
+
+#include <GL/gl.h>
+
+/**
+ * Runtime choice of the SIMD kernels. Every module with a setKernel() has a scalar kernel
+ * and, on x86, an AVX2 one with bit identical results; by default the fastest one this CPU
+ * runs is taken, the benchmarks pick them by name. The CPU checks are shared by all modules.
+ */
+enum GLKernel
+{
+	KERNEL_SCALAR,
+	KERNEL_AVX2
+};
+
+// false on other architectures than x86
+GLboolean cpuHasAVX2();
+GLboolean cpuHasSSE41();
+
+// "scalar", "avx2" or NULL for the fastest one of this CPU, false (and _kernel unchanged) if unavailable
+GLboolean selectKernel(const GLchar* _name, GLint* _kernel);
+
+#endif
@@ -0,0 +1,180 @@
+#include "GLNormalize.h"
+#include "GLKernel.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NORMALIZE_X86
+#endif
+
+
+GLfloat rescaleFactor8(GLuint _max_count_rate)
+{
+	// rounded up, max * factor must not end up at 254.99998
+	return nextafterf(255.0f / (_max_count_rate > 0 ? _max_count_rate : 1), INFINITY);
+}
+
+static GLushort maxCount16Scalar(const GLushort* _src, size_t _count)
+{
+	GLushort max_count_rate = 0;
+	for(size_t i=0; i<_count; i++)
+		max_count_rate = _src[i] > max_count_rate ? _src[i] : max_count_rate;
+	return max_count_rate;
+}
+
+static GLvoid rescale32to8Scalar(const GLuint* _src, GLubyte* _dst, size_t _count, GLfloat _factor)
+{
+	for(size_t i=0; i<_count; i++)
+	{
+		GLfloat value = (GLfloat) (GLint) _src[i] * _factor;
+		_dst[i] = value < 255.0f ? (GLubyte) value : 255;
+	}
+}
+
+#ifdef NORMALIZE_X86
+
+/*
+ * max: four independent accumulators, the horizontal max is phminposuw on the inverted lanes
+ * rescale: cvtdq2ps, mul, cvttps2dq, the saturating packs clamp to 255
+ */
+
+__attribute__((target("sse4.1")))
+static GLushort horizontalMax16(__m128i _v)
+{
+	const __m128i ones = _mm_set1_epi16(-1);
+	return (GLushort) ~_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(_v, ones)));
+}
+
+__attribute__((target("sse4.1")))
+static GLushort maxCount16SSE41(const GLushort* _src, size_t _count)
+{
+	__m128i max0 = _mm_setzero_si128();
+	__m128i max1 = _mm_setzero_si128();
+	__m128i max2 = _mm_setzero_si128();
+	__m128i max3 = _mm_setzero_si128();
+
+	size_t i = 0;
+	for(; i + 32 <= _count; i+=32)
+	{
+		max0 = _mm_max_epu16(max0, _mm_loadu_si128((const __m128i*) (_src + i)));
+		max1 = _mm_max_epu16(max1, _mm_loadu_si128((const __m128i*) (_src + i + 8)));
+		max2 = _mm_max_epu16(max2, _mm_loadu_si128((const __m128i*) (_src + i + 16)));
+		max3 = _mm_max_epu16(max3, _mm_loadu_si128((const __m128i*) (_src + i + 24)));
+	}
+	GLushort vector_max = horizontalMax16(_mm_max_epu16(_mm_max_epu16(max0, max1), _mm_max_epu16(max2, max3)));
+	GLushort tail_max = maxCount16Scalar(_src + i, _count - i);
+	return vector_max > tail_max ? vector_max : tail_max;
+}
+
+__attribute__((target("sse4.1")))
+static GLvoid rescale32to8SSE41(const GLuint* _src, GLubyte* _dst, size_t _count, GLfloat _factor)
+{
+	const __m128 factor = _mm_set1_ps(_factor);
+
+	size_t i = 0;
+	for(; i + 16 <= _count; i+=16)
+	{
+		__m128i a = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (_src + i))), factor));
+		__m128i b = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (_src + i + 4))), factor));
+		__m128i c = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (_src + i + 8))), factor));
+		__m128i d = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (_src + i + 12))), factor));
+		__m128i bytes = _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+		_mm_storeu_si128((__m128i*) (_dst + i), bytes);
+	}
+	rescale32to8Scalar(_src + i, _dst + i, _count - i, _factor);
+}
+
+__attribute__((target("avx2")))
+static GLushort maxCount16AVX2(const GLushort* _src, size_t _count)
+{
+	__m256i max0 = _mm256_setzero_si256();
+	__m256i max1 = _mm256_setzero_si256();
+	__m256i max2 = _mm256_setzero_si256();
+	__m256i max3 = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for(; i + 64 <= _count; i+=64)
+	{
+		max0 = _mm256_max_epu16(max0, _mm256_loadu_si256((const __m256i*) (_src + i)));
+		max1 = _mm256_max_epu16(max1, _mm256_loadu_si256((const __m256i*) (_src + i + 16)));
+		max2 = _mm256_max_epu16(max2, _mm256_loadu_si256((const __m256i*) (_src + i + 32)));
+		max3 = _mm256_max_epu16(max3, _mm256_loadu_si256((const __m256i*) (_src + i + 48)));
+	}
+	__m256i max01 = _mm256_max_epu16(_mm256_max_epu16(max0, max1), _mm256_max_epu16(max2, max3));
+	GLushort vector_max = horizontalMax16(_mm_max_epu16(_mm256_castsi256_si128(max01), _mm256_extracti128_si256(max01, 1)));
+	GLushort tail_max = maxCount16SSE41(_src + i, _count - i);
+	return vector_max > tail_max ? vector_max : tail_max;
+}
+
+__attribute__((target("avx2")))
+static GLvoid rescale32to8AVX2(const GLuint* _src, GLubyte* _dst, size_t _count, GLfloat _factor)
+{
+	const __m256 factor = _mm256_set1_ps(_factor);
+	// the packs work per 128Bit lane, dwords 0 4 1 5 2 6 3 7 restore the order
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	size_t i = 0;
+	for(; i + 32 <= _count; i+=32)
+	{
+		__m256i a = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (_src + i))), factor));
+		__m256i b = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (_src + i + 8))), factor));
+		__m256i c = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (_src + i + 16))), factor));
+		__m256i d = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (_src + i + 24))), factor));
+		__m256i bytes = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+		_mm256_storeu_si256((__m256i*) (_dst + i), _mm256_permutevar8x32_epi32(bytes, order));
+	}
+	rescale32to8SSE41(_src + i, _dst + i, _count - i, _factor);
+}
+
+#endif
+
+GLMaxCount16Kernel maxCount16Kernel(const GLchar* _name)
+{
+	if(strcmp(_name, "scalar") == 0)
+		return maxCount16Scalar;
+#ifdef NORMALIZE_X86
+	if(strcmp(_name, "sse4.1") == 0 && cpuHasSSE41())
+		return maxCount16SSE41;
+	if(strcmp(_name, "avx2") == 0 && cpuHasAVX2())
+		return maxCount16AVX2;
+#endif
+	return NULL;
+}
+
+GLRescale32to8Kernel rescale32to8Kernel(const GLchar* _name)
+{
+	if(strcmp(_name, "scalar") == 0)
+		return rescale32to8Scalar;
+#ifdef NORMALIZE_X86
+	if(strcmp(_name, "sse4.1") == 0 && cpuHasSSE41())
+		return rescale32to8SSE41;
+	if(strcmp(_name, "avx2") == 0 && cpuHasAVX2())
+		return rescale32to8AVX2;
+#endif
+	return NULL;
+}
+
+GLushort maxCount16(const GLushort* _src, size_t _count)
+{
+#ifdef NORMALIZE_X86
+	static GLint level = cpuHasAVX2() ? 2 : cpuHasSSE41() ? 1 : 0;
+	if(level == 2)
+		return maxCount16AVX2(_src, _count);
+	if(level == 1)
+		return maxCount16SSE41(_src, _count);
+#endif
+	return maxCount16Scalar(_src, _count);
+}
+
+GLvoid rescale32to8(const GLuint* _src, GLubyte* _dst, size_t _count, GLfloat _factor)
+{
+#ifdef NORMALIZE_X86
+	static GLint level = cpuHasAVX2() ? 2 : cpuHasSSE41() ? 1 : 0;
+	if(level == 2)
+		return rescale32to8AVX2(_src, _dst, _count, _factor);
+	if(level == 1)
+		return rescale32to8SSE41(_src, _dst, _count, _factor);
+#endif
+	rescale32to8Scalar(_src, _dst, _count, _factor);
+}
@@ -0,0 +1,26 @@
+#ifndef GLNORMALIZE_H
+#define GLNORMALIZE_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+
+/**
+ * Max reduction and 8Bit rescaling of count rates, the two passes that normalize
+ * a volume for display. The SIMD kernels (AVX2, SSE4.1) are picked at runtime,
+ * with a scalar fallback, and all of them give bit identical results.
+ *
+ * rescale: dst = min(255, (GLubyte) (src * _factor)), with _factor = rescaleFactor8(max),
+ * the voxels equal to max always end up at 255. Sources must stay below 2^31.
+ */
+
+GLushort maxCount16(const GLushort* _src, size_t _count);
+GLfloat rescaleFactor8(GLuint _max_count_rate);
+GLvoid rescale32to8(const GLuint* _src, GLubyte* _dst, size_t _count, GLfloat _factor);
+
+// the kernels behind maxCount16()/rescale32to8(), exposed for the benchmark, NULL if not supported
+typedef GLushort (*GLMaxCount16Kernel)(const GLushort* _src, size_t _count);
+typedef GLvoid (*GLRescale32to8Kernel)(const GLuint* _src, GLubyte* _dst, size_t _count, GLfloat _factor);
+GLMaxCount16Kernel maxCount16Kernel(const GLchar* _name);		// "scalar", "sse4.1", "avx2"
+GLRescale32to8Kernel rescale32to8Kernel(const GLchar* _name);
+
+#endif
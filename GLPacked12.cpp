@@ -0,0 +1,164 @@
+#include "GLPacked12.h"
+#include "GLKernel.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PACKED12_X86
+#endif
+
+
+size_t packedSize12(size_t _count)
+{
+	return (_count + 1) / 2 * 3;
+}
+
+static GLvoid pack12Scalar(const GLushort* _src, GLubyte* _dst, size_t _count)
+{
+	for(size_t i=0; i<_count; i+=2)
+	{
+		GLuint a = _src[i] > 4095 ? 4095 : _src[i];
+		GLuint b = i + 1 < _count ? (_src[i + 1] > 4095 ? 4095 : _src[i + 1]) : 0;
+		GLubyte* pair = _dst + i / 2 * 3;
+		pair[0] = (GLubyte) a;
+		pair[1] = (GLubyte) (a >> 8 | b << 4);
+		pair[2] = (GLubyte) (b >> 4);
+	}
+}
+
+static GLvoid unpack12Scalar(const GLubyte* _src, GLushort* _dst, size_t _count)
+{
+	for(size_t i=0; i<_count; i++)
+		_dst[i] = unpackVoxel12(_src, i);
+}
+
+#ifdef PACKED12_X86
+
+/*
+ * unpack: pshufb gathers bytes (3k, 3k+1) into lane 2k and (3k+1, 3k+2) into lane 2k+1,
+ * even lanes are masked with 0x0fff, odd lanes shifted right by 4
+ * pack: every 32Bit lane becomes a | b << 12, pshufb drops the 4th byte of each lane
+ */
+
+__attribute__((target("sse4.1")))
+static GLvoid pack12SSE41(const GLushort* _src, GLubyte* _dst, size_t _count)
+{
+	const __m128i limit = _mm_set1_epi16(4095);
+	const __m128i low_mask = _mm_set1_epi32(0x0fff);
+	const __m128i compact = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	// 8 voxels -> 12 bytes, the 16 byte store spills 4 bytes the next step overwrites
+	size_t i = 0;
+	size_t packed_size = packedSize12(_count);
+	for(; i + 8 <= _count && i / 2 * 3 + 16 <= packed_size; i+=8)
+	{
+		__m128i v = _mm_min_epu16(_mm_loadu_si128((const __m128i*) (_src + i)), limit);
+		__m128i lanes = _mm_or_si128(_mm_and_si128(v, low_mask), _mm_slli_epi32(_mm_srli_epi32(v, 16), 12));
+		_mm_storeu_si128((__m128i*) (_dst + i / 2 * 3), _mm_shuffle_epi8(lanes, compact));
+	}
+	pack12Scalar(_src + i, _dst + i / 2 * 3, _count - i);
+}
+
+__attribute__((target("sse4.1")))
+static GLvoid unpack12SSE41(const GLubyte* _src, GLushort* _dst, size_t _count)
+{
+	const __m128i gather = _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+	const __m128i low_mask = _mm_set1_epi16(0x0fff);
+
+	// 12 bytes -> 8 voxels, the 16 byte load must stay inside the packed buffer
+	size_t i = 0;
+	size_t packed_size = packedSize12(_count);
+	for(; i + 8 <= _count && i / 2 * 3 + 16 <= packed_size; i+=8)
+	{
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (_src + i / 2 * 3)), gather);
+		__m128i even = _mm_and_si128(v, low_mask);
+		__m128i odd = _mm_srli_epi16(v, 4);
+		_mm_storeu_si128((__m128i*) (_dst + i), _mm_blend_epi16(even, odd, 0xaa));
+	}
+	unpack12Scalar(_src + i / 2 * 3, _dst + i, _count - i);
+}
+
+__attribute__((target("avx2")))
+static GLvoid pack12AVX2(const GLushort* _src, GLubyte* _dst, size_t _count)
+{
+	const __m256i limit = _mm256_set1_epi16(4095);
+	const __m256i low_mask = _mm256_set1_epi32(0x0fff);
+	const __m256i compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+											 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	// 16 voxels -> 24 bytes, 12 per 128Bit lane
+	size_t i = 0;
+	size_t packed_size = packedSize12(_count);
+	for(; i + 16 <= _count && i / 2 * 3 + 28 <= packed_size; i+=16)
+	{
+		__m256i v = _mm256_min_epu16(_mm256_loadu_si256((const __m256i*) (_src + i)), limit);
+		__m256i lanes = _mm256_or_si256(_mm256_and_si256(v, low_mask), _mm256_slli_epi32(_mm256_srli_epi32(v, 16), 12));
+		lanes = _mm256_shuffle_epi8(lanes, compact);
+		GLubyte* dst = _dst + i / 2 * 3;
+		_mm_storeu_si128((__m128i*) dst, _mm256_castsi256_si128(lanes));
+		_mm_storeu_si128((__m128i*) (dst + 12), _mm256_extracti128_si256(lanes, 1));
+	}
+	pack12SSE41(_src + i, _dst + i / 2 * 3, _count - i);
+}
+
+__attribute__((target("avx2")))
+static GLvoid unpack12AVX2(const GLubyte* _src, GLushort* _dst, size_t _count)
+{
+	const __m256i gather = _mm256_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11,
+											0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+	const __m256i low_mask = _mm256_set1_epi16(0x0fff);
+
+	// 24 bytes -> 16 voxels, every 128Bit lane gets its own 12 bytes
+	size_t i = 0;
+	size_t packed_size = packedSize12(_count);
+	for(; i + 16 <= _count && i / 2 * 3 + 28 <= packed_size; i+=16)
+	{
+		const GLubyte* src = _src + i / 2 * 3;
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) src)),
+											_mm_loadu_si128((const __m128i*) (src + 12)), 1);
+		v = _mm256_shuffle_epi8(v, gather);
+		__m256i even = _mm256_and_si256(v, low_mask);
+		__m256i odd = _mm256_srli_epi16(v, 4);
+		_mm256_storeu_si256((__m256i*) (_dst + i), _mm256_blend_epi16(even, odd, 0xaa));
+	}
+	unpack12SSE41(_src + i / 2 * 3, _dst + i, _count - i);
+}
+
+#endif
+
+GLUnpack12Kernel unpack12Kernel(const GLchar* _name)
+{
+	if(strcmp(_name, "scalar") == 0)
+		return unpack12Scalar;
+#ifdef PACKED12_X86
+	if(strcmp(_name, "sse4.1") == 0 && cpuHasSSE41())
+		return unpack12SSE41;
+	if(strcmp(_name, "avx2") == 0 && cpuHasAVX2())
+		return unpack12AVX2;
+#endif
+	return NULL;
+}
+
+GLvoid pack12(const GLushort* _src, GLubyte* _dst, size_t _count)
+{
+#ifdef PACKED12_X86
+	static GLint level = cpuHasAVX2() ? 2 : cpuHasSSE41() ? 1 : 0;
+	if(level == 2)
+		return pack12AVX2(_src, _dst, _count);
+	if(level == 1)
+		return pack12SSE41(_src, _dst, _count);
+#endif
+	pack12Scalar(_src, _dst, _count);
+}
+
+GLvoid unpack12(const GLubyte* _src, GLushort* _dst, size_t _count)
+{
+#ifdef PACKED12_X86
+	static GLint level = cpuHasAVX2() ? 2 : cpuHasSSE41() ? 1 : 0;
+	if(level == 2)
+		return unpack12AVX2(_src, _dst, _count);
+	if(level == 1)
+		return unpack12SSE41(_src, _dst, _count);
+#endif
+	unpack12Scalar(_src, _dst, _count);
+}
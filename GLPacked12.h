@@ -0,0 +1,32 @@
+#ifndef GLPACKED12_H
+#define GLPACKED12_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+
+/**
+ * 12Bit packed voxel storage, two voxels in three bytes:
+ *
+ *   byte 0: a[7..0]   byte 1: b[3..0] a[11..8]   byte 2: b[11..4]
+ *
+ * Counts above 4095 are saturated when packing. The SIMD kernels (AVX2, SSE4.1)
+ * are picked at runtime, with a scalar fallback.
+ */
+
+size_t packedSize12(size_t _count);
+GLvoid pack12(const GLushort* _src, GLubyte* _dst, size_t _count);
+GLvoid unpack12(const GLubyte* _src, GLushort* _dst, size_t _count);
+
+// the kernels behind pack12()/unpack12(), exposed for the benchmark, NULL if not supported
+typedef GLvoid (*GLUnpack12Kernel)(const GLubyte* _src, GLushort* _dst, size_t _count);
+GLUnpack12Kernel unpack12Kernel(const GLchar* _name);	// "scalar", "sse4.1", "avx2"
+
+inline GLushort unpackVoxel12(const GLubyte* _src, size_t _index)
+{
+	const GLubyte* pair = _src + (_index >> 1) * 3;
+	if(_index & 1)
+		return (GLushort) (pair[1] >> 4 | pair[2] << 4);
+	return (GLushort) (pair[0] | (pair[1] & 0x0f) << 8);
+}
+
+#endif
@@ -0,0 +1,207 @@
+#include "GLPathCut.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+
+GLPathCut::GLPathCut(GLWorkerPool* _pool, GLfloat _step) : engine(_pool)
+{
+	step = _step;
+	volume = NULL;
+	dims[0] = dims[1] = dims[2] = 0;
+	factor = 0;
+	stamp = 0;
+	image_width = 0;
+}
+
+GLvoid GLPathCut::setPath(const GLfloat* _vertices, GLint _no_vertices)
+{
+	vertices.assign(_vertices, _vertices + 2 * _no_vertices);
+}
+
+GLvoid GLPathCut::insertVertex(GLint _index, GLfloat _kx, GLfloat _ky)
+{
+	GLfloat vertex[2] = {_kx, _ky};
+	vertices.insert(vertices.begin() + 2 * _index, vertex, vertex + 2);
+}
+
+GLvoid GLPathCut::moveVertex(GLint _index, GLfloat _kx, GLfloat _ky)
+{
+	vertices[2 * _index] = _kx;
+	vertices[2 * _index + 1] = _ky;
+}
+
+GLvoid GLPathCut::removeVertex(GLint _index)
+{
+	vertices.erase(vertices.begin() + 2 * _index, vertices.begin() + 2 * _index + 2);
+}
+
+GLint GLPathCut::getNoVertices()
+{
+	return (GLint) vertices.size() / 2;
+}
+
+const GLfloat* GLPathCut::getVertex(GLint _index)
+{
+	return &vertices[2 * _index];
+}
+
+GLint GLPathCut::update(const GLuint* _volume, GLint _width, GLint _height, GLint _depth, GLfloat _factor, uint64_t _stamp)
+{
+	return resample(_volume, _width, _height, _depth, _factor, _stamp);
+}
+
+GLint GLPathCut::update(const GLushort* _volume, GLint _width, GLint _height, GLint _depth, GLfloat _factor, uint64_t _stamp)
+{
+	return resample(_volume, _width, _height, _depth, _factor, _stamp);
+}
+
+template <typename T>
+GLint GLPathCut::resample(const T* _volume, GLint _width, GLint _height, GLint _depth, GLfloat _factor, uint64_t _stamp)
+{
+	// different voxels, every segment is out of date
+	if(volume != _volume || dims[0] != _width || dims[1] != _height || dims[2] != _depth || factor != _factor || stamp != _stamp)
+	{
+		segments.clear();
+		volume = _volume;
+		dims[0] = _width;
+		dims[1] = _height;
+		dims[2] = _depth;
+		factor = _factor;
+		stamp = _stamp;
+	}
+
+	// segments with unchanged end points are taken over, wherever they are in the path now
+	GLint no_segments = getNoVertices() > 1 ? getNoVertices() - 1 : 0;
+	std::vector<Segment> new_segments(no_segments);
+	GLint resampled = 0;
+	for(GLint s=0; s<no_segments; s++)
+	{
+		Segment& segment = new_segments[s];
+		memcpy(segment.from, &vertices[2 * s], 2 * sizeof(GLfloat));
+		memcpy(segment.to, &vertices[2 * s + 2], 2 * sizeof(GLfloat));
+
+		GLboolean found = false;
+		for(size_t o=0; o<segments.size() && !found; o++)
+		{
+			if(memcmp(segments[o].from, segment.from, 2 * sizeof(GLfloat)) == 0
+			   && memcmp(segments[o].to, segment.to, 2 * sizeof(GLfloat)) == 0 && !segments[o].samples.empty())
+			{
+				segment.columns = segments[o].columns;
+				segment.samples.swap(segments[o].samples);
+				found = true;
+			}
+		}
+		if(found)
+			continue;
+
+		// the samples of every slice along the segment are one plane of the cut engine, energies as rows
+		GLfloat dx = (segment.to[0] - segment.from[0]) * _width;
+		GLfloat dy = (segment.to[1] - segment.from[1]) * _height;
+		GLfloat length = sqrtf(dx * dx + dy * dy);
+		segment.columns = length > step ? (GLint) ceilf(length / step) : 1;
+
+		GLCutPlane plane;
+		plane.origin[0] = segment.from[0] * _width;
+		plane.origin[1] = segment.from[1] * _height;
+		plane.origin[2] = 0;
+		plane.u[0] = length > 0 ? dx / length * step : 0;
+		plane.u[1] = length > 0 ? dy / length * step : 0;
+		plane.u[2] = 0;
+		plane.v[0] = 0;
+		plane.v[1] = 0;
+		plane.v[2] = 1;
+		plane.width = segment.columns;
+		plane.height = _depth;
+		engine.cut(_volume, _width, _height, _depth, plane, _factor, _stamp);
+
+		// samples outside the volume stay 0
+		segment.samples.assign((size_t) _depth * segment.columns, 0);
+		for(GLint t=0; t<_depth; t++)
+		{
+			GLint begin = engine.getRowBegin(t);
+			GLint end = engine.getRowEnd(t);
+			if(begin < end)
+				memcpy(&segment.samples[(size_t) t * segment.columns + begin], engine.getCut() + (size_t) t * plane.width + begin, end - begin);
+		}
+		resampled++;
+	}
+
+	GLboolean same_layout = new_segments.size() == segments.size();
+	for(size_t s=0; s<segments.size() && same_layout; s++)
+		same_layout = memcmp(segments[s].from, new_segments[s].from, 2 * sizeof(GLfloat)) == 0
+				&& memcmp(segments[s].to, new_segments[s].to, 2 * sizeof(GLfloat)) == 0;
+	segments.swap(new_segments);
+	if(resampled == 0 && same_layout && !image.empty())
+		return 0;
+
+	// the segments side by side, the last vertex ends up in the last column
+	image_width = 0;
+	vertex_columns.assign(getNoVertices(), 0);
+	for(GLint s=0; s<no_segments; s++)
+	{
+		vertex_columns[s] = image_width;
+		image_width += segments[s].columns;
+	}
+	if(no_segments > 0)
+		vertex_columns[no_segments] = image_width - 1;
+
+	image.assign((size_t) _depth * image_width, 0);
+	positions.resize(2 * image_width);
+	for(GLint s=0, column=0; s<no_segments; column+=segments[s].columns, s++)
+	{
+		const Segment& segment = segments[s];
+		for(GLint t=0; t<_depth; t++)
+			memcpy(&image[(size_t) t * image_width + column], &segment.samples[(size_t) t * segment.columns], segment.columns);
+
+		GLfloat dx = (segment.to[0] - segment.from[0]) * _width;
+		GLfloat dy = (segment.to[1] - segment.from[1]) * _height;
+		GLfloat length = sqrtf(dx * dx + dy * dy);
+		for(GLint i=0; i<segment.columns; i++)
+		{
+			positions[2 * (column + i)] = segment.from[0] * _width + (length > 0 ? dx / length * step * i : 0);
+			positions[2 * (column + i) + 1] = segment.from[1] * _height + (length > 0 ? dy / length * step * i : 0);
+		}
+	}
+	return resampled;
+}
+
+const GLubyte* GLPathCut::getImage()
+{
+	return image.data();
+}
+
+GLint GLPathCut::getWidth()
+{
+	return image_width;
+}
+
+GLint GLPathCut::getHeight()
+{
+	return dims[2];
+}
+
+const GLfloat* GLPathCut::getPosition(GLint _column)
+{
+	return &positions[2 * _column];
+}
+
+GLint GLPathCut::getColumn(GLint _vertex)
+{
+	return vertex_columns[_vertex];
+}
+
+GLboolean GLPathCut::exportPGM(const GLchar* _path)
+{
+	if(image_width == 0 || dims[2] == 0)
+		return false;
+
+	FILE* file = fopen(_path, "wb");
+	if(!file)
+		return false;
+
+	size_t size = (size_t) image_width * dims[2];
+	GLboolean complete = fprintf(file, "P5\n%d %d\n255\n", image_width, dims[2]) > 0
+			&& fwrite(image.data(), 1, size, file) == size;
+	return fclose(file) == 0 && complete;
+}
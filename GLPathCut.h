@@ -0,0 +1,75 @@
+#ifndef GLPATHCUT_H
+#define GLPATHCUT_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "GLWorkerPool.h"
+#include "GLCutEngine.h"
+
+/**
+ * Energy momentum cut along a polyline through the (kx, ky) plane (e.g. Gamma - M - K - Gamma):
+ * every segment is sampled at uniform steps of _step voxels from its start vertex, for all
+ * slices (energies), the segments side by side give a depth x getWidth() E vs k image.
+ *
+ * The vertices are normalized slice coordinates (0..1), so a path survives a pyramid level change.
+ * Every segment keeps its own samples, update() only resamples the segments whose end points
+ * changed (moving a vertex touches the two segments next to it), all of them if the volume,
+ * the factor or _stamp changed. The segments are resampled by a GLCutEngine (trilinear, in parallel).
+ */
+class GLPathCut
+{
+	public:
+		GLPathCut(GLWorkerPool* _pool, GLfloat _step = 1.0f);
+
+		GLvoid setPath(const GLfloat* _vertices, GLint _no_vertices);	// kx, ky pairs
+		GLvoid insertVertex(GLint _index, GLfloat _kx, GLfloat _ky);
+		GLvoid moveVertex(GLint _index, GLfloat _kx, GLfloat _ky);
+		GLvoid removeVertex(GLint _index);
+		GLint getNoVertices();
+		const GLfloat* getVertex(GLint _index);
+
+		// returns the number of resampled segments, the image is rebuilt whenever the path changed
+		GLint update(const GLuint* _volume, GLint _width, GLint _height, GLint _depth, GLfloat _factor, uint64_t _stamp);
+		GLint update(const GLushort* _volume, GLint _width, GLint _height, GLint _depth, GLfloat _factor, uint64_t _stamp);
+
+		const GLubyte* getImage();		// image[t * getWidth() + column], normalized like GLCutEngine
+		GLint getWidth();
+		GLint getHeight();
+		const GLfloat* getPosition(GLint _column);	// x, y of a column in voxels of the last update() volume
+		GLint getColumn(GLint _vertex);				// column of a vertex
+
+		// binary 8Bit PGM, k to the right, energy (slice 0 first) downwards
+		GLboolean exportPGM(const GLchar* _path);
+
+	private:
+		struct Segment
+		{
+			GLfloat from[2];
+			GLfloat to[2];
+			GLint columns;
+			std::vector<GLubyte> samples;	// depth x columns
+		};
+
+		GLCutEngine engine;
+		GLfloat step;
+
+		std::vector<GLfloat> vertices;
+		std::vector<Segment> segments;
+
+		const GLvoid* volume;
+		GLint dims[3];
+		GLfloat factor;
+		uint64_t stamp;
+
+		std::vector<GLubyte> image;
+		std::vector<GLfloat> positions;
+		std::vector<GLint> vertex_columns;
+		GLint image_width;
+
+		template <typename T>
+		GLint resample(const T* _volume, GLint _width, GLint _height, GLint _depth, GLfloat _factor, uint64_t _stamp);
+};
+
+#endif
@@ -0,0 +1,83 @@
+#define GL_GLEXT_PROTOTYPES
+#include "GLPointCloud.h"
+#include <GL/glext.h>
+#include <stdio.h>
+#include <string.h>
+
+
+GLPointCloud::GLPointCloud()
+{
+	count = 0;
+	buffer = 0;
+	use_buffers = -1;
+}
+
+GLPointCloud::~GLPointCloud()
+{
+	if(buffer)
+		glDeleteBuffers(1, &buffer);
+}
+
+GLboolean GLPointCloud::isOutdated(const GLuint* _key, GLint _size)
+{
+	return key.isOutdated(_key, _size);
+}
+
+GLPointVertex* GLPointCloud::getVertices(size_t _count)
+{
+	if(vertices.size() < _count)
+		vertices.resize(_count);
+	return vertices.data();
+}
+
+GLvoid GLPointCloud::upload(size_t _count)
+{
+	count = _count;
+
+	// vertex buffer objects are core since GL 1.5
+	if(use_buffers < 0)
+	{
+		GLint major = 1;
+		GLint minor = 0;
+		const GLchar* version = (const GLchar*) glGetString(GL_VERSION);
+		use_buffers = version && sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 1 || minor >= 5);
+	}
+	if(!use_buffers)
+		return;
+
+	if(!buffer)
+		glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(GLPointVertex), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GLvoid GLPointCloud::draw()
+{
+	if(count == 0)
+		return;
+
+	// with a buffer bound the pointers are offsets into it
+	const GLubyte* base = (const GLubyte*) vertices.data();
+	if(use_buffers > 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		base = NULL;
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(GLPointVertex), base + offsetof(GLPointVertex, position));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(GLPointVertex), base + offsetof(GLPointVertex, color));
+	glDrawArrays(GL_POINTS, 0, (GLsizei) count);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	if(use_buffers > 0)
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+size_t GLPointCloud::getCount()
+{
+	return count;
+}
@@ -0,0 +1,48 @@
+#ifndef GLPOINTCLOUD_H
+#define GLPOINTCLOUD_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <vector>
+#include "GLRetainedKey.h"
+
+// interleaved, 16 bytes per point
+struct GLPointVertex
+{
+	GLfloat position[3];
+	GLubyte color[4];		// r, g, b, a
+};
+
+/**
+ * Retained point cloud of one render mode: the vertices are built on the CPU only when the
+ * key (everything they depend on: level, loaded slices, contrast, color mode, alpha, ...)
+ * changes, uploaded into a vertex buffer object and drawn with a single glDrawArrays(GL_POINTS)
+ * in whatever modelview matrix is current, so a rotation costs one draw call.
+ *
+ * Without vertex buffer objects (GL < 1.5) the same interleaved array is drawn from client
+ * memory. The buffer is created on the first upload(), which needs the GL context.
+ */
+class GLPointCloud
+{
+	public:
+		GLPointCloud();
+		~GLPointCloud();
+
+		GLboolean isOutdated(const GLuint* _key, GLint _size);	// GLRetainedKey
+
+		// room for _count vertices to build into, then upload() the ones written
+		GLPointVertex* getVertices(size_t _count);
+		GLvoid upload(size_t _count);
+		GLvoid draw();
+
+		size_t getCount();
+
+	private:
+		GLRetainedKey key;
+		std::vector<GLPointVertex> vertices;
+		size_t count;
+		GLuint buffer;
+		GLint use_buffers;		// -1 until the GL version was checked
+};
+
+#endif
@@ -0,0 +1,484 @@
+#include "GLRaycaster.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RAYCAST_X86
+#endif
+
+// edge of the square tiles the threads claim, in pixels
+#define RAYCAST_TILE 32
+// rays of an AVX2 packet
+#define RAYCAST_LANES 8
+// compositing stops once a ray is this opaque, as in GLVolumeRenderer
+#define RAYCAST_OPAQUE 0.99f
+
+
+// everything a thread needs to cast the rays of a tile
+struct RaycastFrame
+{
+	const GLubyte* volume;
+	const GLfloat (*transfer)[256];
+	GLRaycastMode mode;
+	GLint kernel;
+
+	GLint size[3];
+	GLint stride[2];		// of the padded volume: row, slice
+	GLfloat last[3];		// highest sample coordinate per axis, size - 1
+
+	GLfloat origin[3];		// volume coordinates of the eye origin (the volume center)
+	GLfloat right[3];		// one eye unit to the right
+	GLfloat up[3];			// one eye unit upwards
+	GLfloat direction[3];	// one voxel along the view
+	GLfloat pixel[2];		// eye units per pixel
+	GLfloat extent[2];		// half the viewport in eye units
+
+	GLint width;
+	GLint height;
+	GLubyte* image;
+};
+
+// a ray samples origin + (k + 0.5) * direction for first <= k < end
+struct RaycastRay
+{
+	GLfloat origin[3];
+	GLint first;
+	GLint end;
+};
+
+
+/*
+ * the ray through the center of pixel (_i, _j), clipped to [0, size] on every axis
+ */
+static GLvoid setupRay(const RaycastFrame& _frame, GLint _i, GLint _j, RaycastRay& _ray)
+{
+	GLfloat ex = ((GLfloat) _i + 0.5f) * _frame.pixel[0] - _frame.extent[0];
+	GLfloat ey = _frame.extent[1] - ((GLfloat) _j + 0.5f) * _frame.pixel[1];
+
+	GLfloat enter = -INFINITY;
+	GLfloat leave = INFINITY;
+	for(GLint a=0; a<3; a++)
+	{
+		GLfloat o = _frame.origin[a] + ex * _frame.right[a] + ey * _frame.up[a];
+		_ray.origin[a] = o;
+
+		GLfloat d = _frame.direction[a];
+		if(fabsf(d) < 1e-7f)
+		{
+			if(o < 0 || o > _frame.size[a])
+				leave = -INFINITY;
+			continue;
+		}
+		GLfloat s0 = -o / d;
+		GLfloat s1 = (_frame.size[a] - o) / d;
+		enter = fmaxf(enter, fminf(s0, s1));
+		leave = fminf(leave, fmaxf(s0, s1));
+	}
+
+	if(leave <= enter)
+	{
+		_ray.first = _ray.end = 0;
+		return;
+	}
+	_ray.first = (GLint) ceilf(enter - 0.5f);
+	_ray.end = (GLint) ceilf(leave - 0.5f);
+}
+
+/*
+ * every axis: u = clamp(p - 0.5, 0, size - 1), c = floor(u), f = u - c, the corner c + 1
+ * is at most the repeated voxel of the padding
+ */
+static inline GLfloat sampleScalar(const RaycastFrame& _frame, const GLfloat* _p)
+{
+	GLint c[3];
+	GLfloat f[3];
+	for(GLint a=0; a<3; a++)
+	{
+		GLfloat u = _p[a] - 0.5f;
+		u = u > 0 ? u : 0;
+		u = u < _frame.last[a] ? u : _frame.last[a];
+		c[a] = (GLint) u;
+		f[a] = u - (GLfloat) c[a];
+	}
+
+	GLint row = _frame.stride[0];
+	GLint slice = _frame.stride[1];
+	const GLubyte* base = _frame.volume + (c[2] * slice + c[1] * row + c[0]);
+
+	GLfloat c000 = (GLfloat) base[0];
+	GLfloat c100 = (GLfloat) base[1];
+	GLfloat c010 = (GLfloat) base[row];
+	GLfloat c110 = (GLfloat) base[row + 1];
+	GLfloat c001 = (GLfloat) base[slice];
+	GLfloat c101 = (GLfloat) base[slice + 1];
+	GLfloat c011 = (GLfloat) base[slice + row];
+	GLfloat c111 = (GLfloat) base[slice + row + 1];
+
+	GLfloat c00 = c000 + (c100 - c000) * f[0];
+	GLfloat c10 = c010 + (c110 - c010) * f[0];
+	GLfloat c01 = c001 + (c101 - c001) * f[0];
+	GLfloat c11 = c011 + (c111 - c011) * f[0];
+	GLfloat c0_ = c00 + (c10 - c00) * f[1];
+	GLfloat c1_ = c01 + (c11 - c01) * f[1];
+	return c0_ + (c1_ - c0_) * f[2];
+}
+
+// linear between the entries around _value (0 .. 255)
+static inline GLvoid lookupTransfer(const GLfloat (*_transfer)[256], GLfloat _value, GLint _channels, GLfloat* _out)
+{
+	GLint i = (GLint) _value;
+	i = i < 254 ? i : 254;
+	GLfloat f = _value - (GLfloat) i;
+	for(GLint c=0; c<_channels; c++)
+		_out[c] = _transfer[c][i] + (_transfer[c][i + 1] - _transfer[c][i]) * f;
+}
+
+// _color the composited r, g, b, alpha or the max value in _color[3] (-1 if nothing was sampled)
+static GLvoid storePixel(const RaycastFrame& _frame, GLint _i, GLint _j, const GLfloat* _color)
+{
+	GLfloat color[3] = {0, 0, 0};
+	if(_frame.mode == RAYCAST_COMPOSITE)
+		memcpy(color, _color, sizeof(color));
+	else if(_color[3] >= 0)
+		lookupTransfer(_frame.transfer, _color[3], 3, color);
+
+	GLubyte* pixel = _frame.image + ((size_t) _j * _frame.width + _i) * 3;
+	for(GLint c=0; c<3; c++)
+		pixel[c] = (GLubyte) ((color[c] < 1.0f ? color[c] : 1.0f) * 255.0f + 0.5f);
+}
+
+static GLvoid castRayScalar(const RaycastFrame& _frame, const RaycastRay& _ray, GLfloat* _color)
+{
+	_color[0] = _color[1] = _color[2] = 0;
+	_color[3] = _frame.mode == RAYCAST_MIP ? -1.0f : 0.0f;
+
+	for(GLint k=_ray.first; k<_ray.end; k++)
+	{
+		if(_frame.mode == RAYCAST_COMPOSITE && _color[3] > RAYCAST_OPAQUE)
+			break;
+
+		GLfloat s = (GLfloat) k + 0.5f;
+		GLfloat p[3];
+		for(GLint a=0; a<3; a++)
+			p[a] = _ray.origin[a] + s * _frame.direction[a];
+		GLfloat value = sampleScalar(_frame, p);
+
+		if(_frame.mode == RAYCAST_MIP)
+		{
+			_color[3] = _color[3] > value ? _color[3] : value;
+			continue;
+		}
+
+		GLfloat voxel[4];
+		lookupTransfer(_frame.transfer, value, 4, voxel);
+		GLfloat weight = (1.0f - _color[3]) * voxel[3];
+		for(GLint c=0; c<3; c++)
+			_color[c] = _color[c] + weight * voxel[c];
+		_color[3] = _color[3] + weight;
+	}
+}
+
+#ifdef RAYCAST_X86
+
+/*
+ * RAYCAST_LANES neighbouring rays, the same operations as castRayScalar() per lane: a lane only
+ * accumulates while first <= k < end (and it is not opaque yet), the packet runs until no lane
+ * has samples left. The 8 corners are 32Bit gathers of which the low byte is used.
+ */
+__attribute__((target("avx2")))
+static GLvoid castPacketAVX2(const RaycastFrame& _frame, const RaycastRay* _rays, GLfloat (*_colors)[4])
+{
+	GLfloat origins[3][RAYCAST_LANES];
+	GLint first[RAYCAST_LANES];
+	GLint end[RAYCAST_LANES];
+	GLint k_begin = 0;
+	GLint k_end = 0;
+	for(GLint l=0; l<RAYCAST_LANES; l++)
+	{
+		for(GLint a=0; a<3; a++)
+			origins[a][l] = _rays[l].origin[a];
+		first[l] = _rays[l].first;
+		end[l] = _rays[l].end;
+		if(first[l] >= end[l])
+			continue;
+		k_begin = k_begin < k_end && k_begin < first[l] ? k_begin : first[l];
+		k_end = k_end > end[l] ? k_end : end[l];
+	}
+
+	__m256 origin[3];
+	__m256 direction[3];
+	__m256 last[3];
+	for(GLint a=0; a<3; a++)
+	{
+		origin[a] = _mm256_loadu_ps(origins[a]);
+		direction[a] = _mm256_set1_ps(_frame.direction[a]);
+		last[a] = _mm256_set1_ps(_frame.last[a]);
+	}
+	__m256i first_v = _mm256_loadu_si256((const __m256i*) first);
+	__m256i end_v = _mm256_loadu_si256((const __m256i*) end);
+	GLint row_stride = _frame.stride[0];
+	GLint slice_stride = _frame.stride[1];
+	__m256i row = _mm256_set1_epi32(row_stride);
+	__m256i slice = _mm256_set1_epi32(slice_stride);
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 opaque = _mm256_set1_ps(RAYCAST_OPAQUE);
+	const __m256i low_byte = _mm256_set1_epi32(0xff);
+	const __m256i last_entry = _mm256_set1_epi32(254);
+	const __m256i next = _mm256_set1_epi32(1);
+
+	__m256 color[4] = {zero, zero, zero, _frame.mode == RAYCAST_MIP ? _mm256_set1_ps(-1.0f) : zero};
+
+	for(GLint k=k_begin; k<k_end; k++)
+	{
+		__m256i k_v = _mm256_set1_epi32(k);
+		__m256i live = _mm256_cmpgt_epi32(end_v, k_v);
+		if(_frame.mode == RAYCAST_COMPOSITE)
+			live = _mm256_and_si256(live, _mm256_castps_si256(_mm256_cmp_ps(color[3], opaque, _CMP_LE_OQ)));
+		if(_mm256_testz_si256(live, live))
+			break;
+		__m256i active = _mm256_andnot_si256(_mm256_cmpgt_epi32(first_v, k_v), live);
+		if(_mm256_testz_si256(active, active))
+			continue;
+
+		__m256 s = _mm256_add_ps(_mm256_cvtepi32_ps(k_v), half);
+		__m256i c[3];
+		__m256 f[3];
+		for(GLint a=0; a<3; a++)
+		{
+			__m256 u = _mm256_sub_ps(_mm256_add_ps(origin[a], _mm256_mul_ps(s, direction[a])), half);
+			u = _mm256_max_ps(u, zero);
+			u = _mm256_min_ps(u, last[a]);
+			c[a] = _mm256_cvttps_epi32(u);
+			f[a] = _mm256_sub_ps(u, _mm256_cvtepi32_ps(c[a]));
+		}
+		__m256i index = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(c[2], slice), _mm256_mullo_epi32(c[1], row)), c[0]);
+
+#define RAYCAST_CORNER(_offset) _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_i32gather_epi32((const int*) (_frame.volume + (_offset)), index, 1), low_byte))
+		__m256 c000 = RAYCAST_CORNER(0);
+		__m256 c100 = RAYCAST_CORNER(1);
+		__m256 c010 = RAYCAST_CORNER(row_stride);
+		__m256 c110 = RAYCAST_CORNER(row_stride + 1);
+		__m256 c001 = RAYCAST_CORNER(slice_stride);
+		__m256 c101 = RAYCAST_CORNER(slice_stride + 1);
+		__m256 c011 = RAYCAST_CORNER(slice_stride + row_stride);
+		__m256 c111 = RAYCAST_CORNER(slice_stride + row_stride + 1);
+#undef RAYCAST_CORNER
+
+		__m256 c00 = _mm256_add_ps(c000, _mm256_mul_ps(_mm256_sub_ps(c100, c000), f[0]));
+		__m256 c10 = _mm256_add_ps(c010, _mm256_mul_ps(_mm256_sub_ps(c110, c010), f[0]));
+		__m256 c01 = _mm256_add_ps(c001, _mm256_mul_ps(_mm256_sub_ps(c101, c001), f[0]));
+		__m256 c11 = _mm256_add_ps(c011, _mm256_mul_ps(_mm256_sub_ps(c111, c011), f[0]));
+		__m256 c0_ = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(c10, c00), f[1]));
+		__m256 c1_ = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(c11, c01), f[1]));
+		__m256 value = _mm256_add_ps(c0_, _mm256_mul_ps(_mm256_sub_ps(c1_, c0_), f[2]));
+
+		__m256 mask = _mm256_castsi256_ps(active);
+		if(_frame.mode == RAYCAST_MIP)
+		{
+			color[3] = _mm256_blendv_ps(color[3], _mm256_max_ps(color[3], value), mask);
+			continue;
+		}
+
+		__m256i entry = _mm256_min_epi32(_mm256_cvttps_epi32(value), last_entry);
+		__m256i entry_next = _mm256_add_epi32(entry, next);
+		__m256 fraction = _mm256_sub_ps(value, _mm256_cvtepi32_ps(entry));
+		__m256 voxel[4];
+		for(GLint ch=0; ch<4; ch++)
+		{
+			__m256 t0 = _mm256_i32gather_ps(_frame.transfer[ch], entry, 4);
+			__m256 t1 = _mm256_i32gather_ps(_frame.transfer[ch], entry_next, 4);
+			voxel[ch] = _mm256_add_ps(t0, _mm256_mul_ps(_mm256_sub_ps(t1, t0), fraction));
+		}
+
+		// inactive lanes add zeros
+		__m256 weight = _mm256_and_ps(_mm256_mul_ps(_mm256_sub_ps(one, color[3]), voxel[3]), mask);
+		for(GLint ch=0; ch<3; ch++)
+			color[ch] = _mm256_add_ps(color[ch], _mm256_mul_ps(weight, voxel[ch]));
+		color[3] = _mm256_add_ps(color[3], weight);
+	}
+
+	GLfloat lanes[4][RAYCAST_LANES];
+	for(GLint ch=0; ch<4; ch++)
+		_mm256_storeu_ps(lanes[ch], color[ch]);
+	for(GLint l=0; l<RAYCAST_LANES; l++)
+	{
+		for(GLint ch=0; ch<4; ch++)
+			_colors[l][ch] = lanes[ch][l];
+	}
+}
+
+#endif
+
+static GLvoid renderTile(const RaycastFrame& _frame, GLint _tile)
+{
+	GLint tiles_x = (_frame.width + RAYCAST_TILE - 1) / RAYCAST_TILE;
+	GLint x0 = _tile % tiles_x * RAYCAST_TILE;
+	GLint y0 = _tile / tiles_x * RAYCAST_TILE;
+	GLint x1 = x0 + RAYCAST_TILE < _frame.width ? x0 + RAYCAST_TILE : _frame.width;
+	GLint y1 = y0 + RAYCAST_TILE < _frame.height ? y0 + RAYCAST_TILE : _frame.height;
+
+	for(GLint j=y0; j<y1; j++)
+	{
+		GLint i = x0;
+#ifdef RAYCAST_X86
+		if(_frame.kernel == KERNEL_AVX2)
+		{
+			for(; i + RAYCAST_LANES <= x1; i+=RAYCAST_LANES)
+			{
+				RaycastRay rays[RAYCAST_LANES];
+				GLfloat colors[RAYCAST_LANES][4];
+				for(GLint l=0; l<RAYCAST_LANES; l++)
+					setupRay(_frame, i + l, j, rays[l]);
+				castPacketAVX2(_frame, rays, colors);
+				for(GLint l=0; l<RAYCAST_LANES; l++)
+					storePixel(_frame, i + l, j, colors[l]);
+			}
+		}
+#endif
+		for(; i<x1; i++)
+		{
+			RaycastRay ray;
+			GLfloat color[4];
+			setupRay(_frame, i, j, ray);
+			castRayScalar(_frame, ray, color);
+			storePixel(_frame, i, j, color);
+		}
+	}
+}
+
+
+GLRaycaster::GLRaycaster(GLWorkerPool* _pool)
+{
+	pool = _pool;
+	size[0] = size[1] = size[2] = 0;
+	image_size[0] = image_size[1] = 0;
+	setTransfer(NULL, 255);
+	setKernel(NULL);
+}
+
+GLboolean GLRaycaster::setKernel(const GLchar* _name)
+{
+	return selectKernel(_name, &kernel);
+}
+
+GLboolean GLRaycaster::isOutdated(const GLuint* _key, GLint _size)
+{
+	return key.isOutdated(_key, _size);
+}
+
+GLvoid GLRaycaster::setVolume(const GLubyte* _volume, GLint _width, GLint _height, GLint _depth)
+{
+	size[0] = _width;
+	size[1] = _height;
+	size[2] = _depth;
+
+	size_t row = (size_t) _width + 1;
+	size_t slice = row * (_height + 1);
+	volume.resize(slice * (_depth + 1) + 4);
+	pool->parallelFor(0, _depth + 1, [&](GLint _t)
+	{
+		const GLubyte* src = _volume + (size_t) (_t < _depth ? _t : _depth - 1) * _width * _height;
+		GLubyte* dst = &volume[_t * slice];
+		for(GLint y=0; y<=_height; y++)
+		{
+			GLubyte* dst_row = dst + y * row;
+			memcpy(dst_row, src + (size_t) (y < _height ? y : _height - 1) * _width, _width);
+			dst_row[_width] = dst_row[_width - 1];
+		}
+	});
+	memset(&volume[slice * (_depth + 1)], 0, 4);
+}
+
+GLvoid GLRaycaster::setTransfer(const GLubyte* _palette, GLubyte _alpha)
+{
+	for(GLint i=0; i<256; i++)
+	{
+		for(GLint c=0; c<3; c++)
+			transfer[c][i] = (_palette ? _palette[i * 3 + c] : i) / 255.0f;
+		transfer[3][i] = (GLfloat) (i * _alpha / 255) / 255.0f;
+	}
+}
+
+GLvoid GLRaycaster::render(const GLfloat* _rotation_matrix, GLfloat _viewport_scale, GLint _width, GLint _height, GLRaycastMode _mode)
+{
+	image_size[0] = _width;
+	image_size[1] = _height;
+	image.assign((size_t) _width * _height * 3, 0);
+	if(volume.empty() || _width <= 0 || _height <= 0)
+		return;
+
+	RaycastFrame frame;
+	frame.volume = volume.data();
+	frame.transfer = transfer;
+	frame.mode = _mode;
+	frame.kernel = kernel;
+	frame.stride[0] = size[0] + 1;
+	frame.stride[1] = (size[0] + 1) * (size[1] + 1);
+	frame.width = _width;
+	frame.height = _height;
+	frame.image = image.data();
+
+	// model = R^T eye, then the 128 x 128 x depth units of the model to voxels
+	GLfloat scale[3] = {size[0] / 128.0f, size[1] / 128.0f, 1.0f};
+	GLfloat length = 0;
+	for(GLint a=0; a<3; a++)
+	{
+		frame.size[a] = size[a];
+		frame.last[a] = (GLfloat) (size[a] - 1);
+		frame.origin[a] = size[a] / 2.0f;
+		frame.right[a] = _rotation_matrix[a * 4] * scale[a];
+		frame.up[a] = _rotation_matrix[a * 4 + 1] * scale[a];
+		frame.direction[a] = -_rotation_matrix[a * 4 + 2] * scale[a];
+		length += frame.direction[a] * frame.direction[a];
+	}
+	length = sqrtf(length);
+	for(GLint a=0; a<3; a++)
+		frame.direction[a] /= length;
+	frame.extent[0] = frame.extent[1] = 128 * _viewport_scale;
+	frame.pixel[0] = 2 * frame.extent[0] / _width;
+	frame.pixel[1] = 2 * frame.extent[1] / _height;
+
+	// every thread takes the next tile until there is none left
+	GLint no_tiles = ((_width + RAYCAST_TILE - 1) / RAYCAST_TILE) * ((_height + RAYCAST_TILE - 1) / RAYCAST_TILE);
+	std::atomic<GLint> next_tile(0);
+	pool->parallelFor(0, pool->size(), [&](GLint)
+	{
+		for(GLint tile=next_tile++; tile<no_tiles; tile=next_tile++)
+			renderTile(frame, tile);
+	});
+}
+
+GLint GLRaycaster::getWidth()
+{
+	return image_size[0];
+}
+
+GLint GLRaycaster::getHeight()
+{
+	return image_size[1];
+}
+
+const GLubyte* GLRaycaster::getImage()
+{
+	return image.data();
+}
+
+GLboolean GLRaycaster::exportPPM(const GLchar* _path)
+{
+	if(image.empty())
+		return false;
+
+	FILE* file = fopen(_path, "wb");
+	if(!file)
+		return false;
+
+	GLboolean complete = fprintf(file, "P6\n%d %d\n255\n", image_size[0], image_size[1]) > 0
+			&& fwrite(image.data(), 1, image.size(), file) == image.size();
+	return fclose(file) == 0 && complete;
+}
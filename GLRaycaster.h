@@ -0,0 +1,70 @@
+#ifndef GLRAYCASTER_H
+#define GLRAYCASTER_H
+
+#include <GL/gl.h>
+#include <vector>
+#include "GLWorkerPool.h"
+#include "GLKernel.h"
+#include "GLRetainedKey.h"
+
+enum GLRaycastMode
+{
+	RAYCAST_MIP,		// max of every ray, colored by the palette
+	RAYCAST_COMPOSITE	// front to back with the opacity of the palette entries, as GLVolumeRenderer
+};
+
+/**
+ * Software raycaster of an 8Bit volume, for machines without a usable OpenGL: the view
+ * matches GLVolumeRenderer (orthographic, the volume spans 128 x 128 x depth units around
+ * the origin of the rotation, glOrtho +-128 * viewport_scale), so an image blitted into
+ * the window lines up with the frame.
+ *
+ * Every ray samples the volume trilinearly one voxel apart, at s = k + 0.5 from the plane
+ * through the volume center, so the result does not depend on the kernel: the AVX2 kernel
+ * marches packets of 8 neighbouring rays of a row (gathered corners, lanes masked outside
+ * their own range), bit-exact with the scalar one. The image is split into tiles that the
+ * threads of the pool claim one after the other until none is left.
+ */
+class GLRaycaster
+{
+	public:
+		GLRaycaster(GLWorkerPool* _pool);
+
+		// selectKernel()
+		GLboolean setKernel(const GLchar* _name);
+
+		GLboolean isOutdated(const GLuint* _key, GLint _size);	// GLRetainedKey
+
+		// _volume[(t * _height + y) * _width + x], copied
+		GLvoid setVolume(const GLubyte* _volume, GLint _width, GLint _height, GLint _depth);
+
+		// 256 RGB entries, NULL for grey, the opacity of value i is i / 255 * _alpha / 255 per voxel
+		GLvoid setTransfer(const GLubyte* _palette, GLubyte _alpha);
+
+		// _rotation_matrix column major as for glMultMatrixf, the image is _width x _height RGB
+		GLvoid render(const GLfloat* _rotation_matrix, GLfloat _viewport_scale, GLint _width, GLint _height, GLRaycastMode _mode);
+
+		GLint getWidth();
+		GLint getHeight();
+		const GLubyte* getImage();		// RGB, top row first
+
+		// binary PPM of the last image
+		GLboolean exportPPM(const GLchar* _path);
+
+	private:
+		GLWorkerPool* pool;
+		GLint kernel;		// GLKernel
+		GLRetainedKey key;
+
+		// one more voxel per axis (the last one repeated) and slack for the 32Bit gathers,
+		// so the upper corners of a sample never need a bounds check
+		GLint size[3];
+		std::vector<GLubyte> volume;
+
+		GLfloat transfer[4][256];	// r, g, b, opacity in [0, 1]
+
+		GLint image_size[2];
+		std::vector<GLubyte> image;
+};
+
+#endif
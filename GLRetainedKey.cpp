@@ -0,0 +1,17 @@
+#include "GLRetainedKey.h"
+#include <string.h>
+
+
+GLboolean GLRetainedKey::isOutdated(const GLuint* _key, GLint _size)
+{
+	if(key.size() == (size_t) _size && memcmp(key.data(), _key, _size * sizeof(GLuint)) == 0)
+		return false;
+
+	key.assign(_key, _key + _size);
+	return true;
+}
+
+GLvoid GLRetainedKey::invalidate()
+{
+	key.clear();
+}
@@ -0,0 +1,24 @@
+#ifndef GLRETAINEDKEY_H
+#define GLRETAINEDKEY_H
+
+#include <GL/gl.h>
+#include <vector>
+
+/**
+ * Key of a retained object (point cloud, texture, volume ...): everything its data on the
+ * GPU depends on (level, loaded slices, contrast, color mode, ...) as a row of GLuint.
+ * The owner rebuilds whenever isOutdated() says so.
+ */
+class GLRetainedKey
+{
+	public:
+		// true (and the key is taken over) if _key differs from the one seen last
+		GLboolean isOutdated(const GLuint* _key, GLint _size);
+		// the next isOutdated() is true, e.g. after a failed build
+		GLvoid invalidate();
+
+	private:
+		std::vector<GLuint> key;
+};
+
+#endif
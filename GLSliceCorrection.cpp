@@ -0,0 +1,170 @@
+#include "GLSliceCorrection.h"
+#include "GLStackLoader.h"
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CORRECTION_X86
+#endif
+
+#define CORRECTION_BLOCK 8
+
+
+static GLvoid applyScalar(const GLfloat* _maps, const GLushort* _src, GLushort* _dst, size_t _first, size_t _count)
+{
+	for(size_t i=_first; i<_count; i++)
+	{
+		const GLfloat* block = _maps + i / CORRECTION_BLOCK * 2 * CORRECTION_BLOCK;
+		GLfloat v = (GLfloat) _src[i] - block[i % CORRECTION_BLOCK];
+		v = v > 0.0f ? v : 0.0f;
+		v = v * block[CORRECTION_BLOCK + i % CORRECTION_BLOCK];
+		v = v + 0.5f;
+		v = v < 65535.0f ? v : 65535.0f;
+		_dst[i] = (GLushort) v;
+	}
+}
+
+#ifdef CORRECTION_X86
+__attribute__((target("avx2")))
+static GLvoid applyAVX2(const GLfloat* _maps, const GLushort* _src, GLushort* _dst, size_t _count)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 top = _mm256_set1_ps(65535.0f);
+	size_t i = 0;
+	for(; i+CORRECTION_BLOCK<=_count; i+=CORRECTION_BLOCK)
+	{
+		const GLfloat* block = _maps + i * 2;
+		__m256 raw = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (_src + i))));
+		__m256 v = _mm256_max_ps(_mm256_sub_ps(raw, _mm256_loadu_ps(block)), zero);
+		v = _mm256_add_ps(_mm256_mul_ps(v, _mm256_loadu_ps(block + CORRECTION_BLOCK)), half);
+		__m256i counts = _mm256_cvttps_epi32(_mm256_min_ps(v, top));
+		_mm_storeu_si128((__m128i*) (_dst + i), _mm_packus_epi32(_mm256_castsi256_si128(counts), _mm256_extracti128_si256(counts, 1)));
+	}
+	applyScalar(_maps, _src, _dst, i, _count);
+}
+#endif
+
+
+GLSliceCorrection::GLSliceCorrection(GLint _width, GLint _height)
+{
+	width = _width;
+	height = _height;
+	no_sources = 0;
+
+	size_t blocks = ((size_t) width * height + CORRECTION_BLOCK - 1) / CORRECTION_BLOCK;
+	maps = new GLfloat[blocks * 2 * CORRECTION_BLOCK];
+	for(size_t b=0; b<blocks; b++)
+	{
+		for(GLint i=0; i<CORRECTION_BLOCK; i++)
+		{
+			maps[b * 2 * CORRECTION_BLOCK + i] = 0.0f;
+			maps[b * 2 * CORRECTION_BLOCK + CORRECTION_BLOCK + i] = 1.0f;
+		}
+	}
+	setKernel(NULL);
+}
+
+GLSliceCorrection::~GLSliceCorrection()
+{
+	delete[] maps;
+}
+
+GLvoid GLSliceCorrection::addSource(const GLchar* _path, GLCorrectionMap _map)
+{
+	if(no_sources < 2)
+	{
+		source_maps[no_sources] = _map;
+		snprintf(sources[no_sources++], sizeof(sources[0]), "%s", _path);
+	}
+}
+
+GLboolean GLSliceCorrection::loadFlat(const GLchar* _path)
+{
+	GLushort* flat = new GLushort[(size_t) width * height];
+	GLboolean loaded = GLStackLoader::readTiff(_path, width, height, flat) && setFlat(flat);
+	delete[] flat;
+
+	if(!loaded)
+		return false;
+	addSource(_path, CORRECTION_FLAT);
+	return true;
+}
+
+GLboolean GLSliceCorrection::loadDark(const GLchar* _path)
+{
+	GLushort* dark = new GLushort[(size_t) width * height];
+	GLboolean loaded = GLStackLoader::readTiff(_path, width, height, dark);
+	if(loaded)
+		setDark(dark);
+	delete[] dark;
+
+	if(!loaded)
+		return false;
+	addSource(_path, CORRECTION_DARK);
+	return true;
+}
+
+GLboolean GLSliceCorrection::setFlat(const GLushort* _flat)
+{
+	size_t count = (size_t) width * height;
+	GLdouble sum = 0;
+	size_t lit = 0;
+	for(size_t i=0; i<count; i++)
+	{
+		sum += _flat[i];
+		lit += _flat[i] > 0;
+	}
+	if(lit == 0)
+	{
+		std::cout << "error: the flat field has no counts" << std::endl;
+		return false;
+	}
+
+	GLfloat mean = (GLfloat) (sum / lit);
+	for(size_t i=0; i<count; i++)
+		maps[i / CORRECTION_BLOCK * 2 * CORRECTION_BLOCK + CORRECTION_BLOCK + i % CORRECTION_BLOCK] = _flat[i] > 0 ? mean / _flat[i] : 0.0f;
+	return true;
+}
+
+GLvoid GLSliceCorrection::setDark(const GLushort* _dark)
+{
+	size_t count = (size_t) width * height;
+	for(size_t i=0; i<count; i++)
+		maps[i / CORRECTION_BLOCK * 2 * CORRECTION_BLOCK + i % CORRECTION_BLOCK] = _dark[i];
+}
+
+GLboolean GLSliceCorrection::setKernel(const GLchar* _name)
+{
+	return selectKernel(_name, &kernel);
+}
+
+GLvoid GLSliceCorrection::apply(const GLushort* _src, GLushort* _dst)
+{
+	size_t count = (size_t) width * height;
+#ifdef CORRECTION_X86
+	if(kernel == KERNEL_AVX2)
+	{
+		applyAVX2(maps, _src, _dst, count);
+		return;
+	}
+#endif
+	applyScalar(maps, _src, _dst, 0, count);
+}
+
+GLint GLSliceCorrection::getNoSources()
+{
+	return no_sources;
+}
+
+const GLchar* GLSliceCorrection::getSource(GLint _index)
+{
+	return sources[_index];
+}
+
+GLCorrectionMap GLSliceCorrection::getSourceMap(GLint _index)
+{
+	return source_maps[_index];
+}
@@ -0,0 +1,64 @@
+#ifndef GLSLICECORRECTION_H
+#define GLSLICECORRECTION_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include "GLKernel.h"
+
+enum GLCorrectionMap
+{
+	CORRECTION_FLAT,
+	CORRECTION_DARK
+};
+
+/**
+ * Flat field and dark correction of the raw DLD slices:
+ *
+ *   out = min(65535, (GLushort) (max(0, raw - dark) * gain + 0.5)),  gain = mean(flat) / flat
+ *
+ * with the mean over the pixels the flat field saw at all, dead pixels (flat 0) get gain 0.
+ * Both maps are 16Bit TIFFs of the slice size, loaded once, either one may be missing
+ * (dark 0, gain 1). The dark frame applies to every slice.
+ *
+ * The maps are kept as floats interleaved in blocks of 8 pixels (8 darks, then 8 gains),
+ * so applying them streams through a single array next to the slice. GLStackLoader runs
+ * apply() right after a slice was read, fused with the copy out of the mapping, so every
+ * later stage sees corrected counts.
+ */
+class GLSliceCorrection
+{
+	public:
+		GLSliceCorrection(GLint _width, GLint _height);
+		~GLSliceCorrection();
+
+		// false if the file is missing or not a 16Bit TIFF of the slice size
+		GLboolean loadFlat(const GLchar* _path);
+		GLboolean loadDark(const GLchar* _path);
+		GLboolean setFlat(const GLushort* _flat);
+		GLvoid setDark(const GLushort* _dark);
+
+		// selectKernel(), the AVX2 kernel corrects 8 pixels at a time
+		GLboolean setKernel(const GLchar* _name);
+
+		// _src and _dst may be the same slice
+		GLvoid apply(const GLushort* _src, GLushort* _dst);
+
+		// the loaded map files, part of what a GLVolumeCache is checked against
+		GLint getNoSources();
+		const GLchar* getSource(GLint _index);
+		GLCorrectionMap getSourceMap(GLint _index);
+
+	private:
+		GLint width;
+		GLint height;
+		GLint kernel;		// GLKernel
+		GLfloat* maps;		// per block of 8 pixels: 8 darks, 8 gains
+
+		GLchar sources[2][256];
+		GLCorrectionMap source_maps[2];
+		GLint no_sources;
+
+		GLvoid addSource(const GLchar* _path, GLCorrectionMap _map);
+};
+
+#endif
@@ -0,0 +1,321 @@
+#include "GLSliceProvider.h"
+#include <iostream>
+
+
+GLSliceProvider::GLSliceProvider(GLStackLoader* _loader, GLWorkerPool* _pool, size_t _memory_budget, GLboolean _packed)
+{
+	loader = _loader;
+	pool = _pool;
+	slices = loader->getSlices();
+	volume = NULL;
+
+	no_slices = loader->getNoSlices();
+	slice_size = (size_t) loader->getWidth() * loader->getHeight();
+	packed = _packed;
+	slice_bytes = packed ? packedSize12(slice_size) : slice_size * sizeof(GLushort);
+	memory_budget = _memory_budget;
+	resident_bytes = 0;
+	streaming = slice_bytes * no_slices > memory_budget;
+
+	// look further ahead than back, but never prefetch more than half the budget
+	GLint budget_slices = (GLint) (memory_budget / slice_bytes);
+	prefetch_ahead = budget_slices / 2 < 8 ? budget_slices / 2 : 8;
+	prefetch_behind = budget_slices / 8 < 2 ? budget_slices / 8 : 2;
+
+	state.assign(no_slices, SLICE_ABSENT);
+	pins.assign(no_slices, 0);
+	lru_position.resize(no_slices);
+	if(packed)
+		packed_slices.assign(no_slices, (GLubyte*) NULL);
+
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+	prefetches = 0;
+}
+
+GLSliceProvider::GLSliceProvider(GLushort** _slices, GLint _no_slices, GLint _width, GLint _height)
+{
+	loader = NULL;
+	pool = NULL;
+	slices = _slices;
+
+	no_slices = _no_slices;
+	slice_size = (size_t) _width * _height;
+	volume = no_slices > 0 ? slices[0] : NULL;
+	for(GLint t=1; t<no_slices && volume; t++)
+		volume = slices[t] == slices[0] + t * slice_size ? volume : NULL;
+	packed = false;
+	slice_bytes = slice_size * sizeof(GLushort);
+	memory_budget = slice_bytes * no_slices;
+	resident_bytes = memory_budget;
+	streaming = false;
+
+	prefetch_ahead = 0;
+	prefetch_behind = 0;
+
+	state.assign(no_slices, SLICE_RESIDENT);
+	pins.assign(no_slices, 0);
+	lru_position.resize(no_slices);
+
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+	prefetches = 0;
+}
+
+GLSliceProvider::~GLSliceProvider()
+{
+	// 16Bit slices are released by their owner (loader or cache), packed ones are ours
+	for(size_t t=0; t<packed_slices.size(); t++)
+		delete[] packed_slices[t];
+}
+
+// runs without the mutex, the slice is SLICE_LOADING
+GLvoid GLSliceProvider::loadSlice(GLint _time_slice)
+{
+	loader->loadSlice(_time_slice);
+
+	if(load_stage)
+		load_stage(_time_slice, loader->getSlice(_time_slice));
+
+	if(packed)
+	{
+		GLubyte* packed_slice = new GLubyte[slice_bytes];
+		pack12(loader->getSlice(_time_slice), packed_slice, slice_size);
+		loader->releaseSlice(_time_slice);
+		packed_slices[_time_slice] = packed_slice;
+	}
+}
+
+GLvoid GLSliceProvider::dropSlice(GLint _time_slice)
+{
+	if(packed)
+	{
+		delete[] packed_slices[_time_slice];
+		packed_slices[_time_slice] = NULL;
+	}
+	else
+		loader->releaseSlice(_time_slice);
+}
+
+GLSliceView GLSliceProvider::viewSlice(GLint _time_slice)
+{
+	GLSliceView view;
+	view.pixels = packed ? NULL : slices[_time_slice];
+	view.packed = packed ? packed_slices[_time_slice] : NULL;
+	view.count = slice_size;
+	return view;
+}
+
+GLvoid GLSliceProvider::setLoadStage(GLSliceStage _stage)
+{
+	load_stage = _stage;
+}
+
+GLint GLSliceProvider::appendSlice()
+{
+	if(!loader)
+		return -1;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// the loader's tables may move
+	drainLoads(lock);
+
+	GLint t = loader->appendSlice();
+	slices = loader->getSlices();
+	no_slices = loader->getNoSlices();
+	streaming = slice_bytes * no_slices > memory_budget;
+
+	state.push_back(SLICE_ABSENT);
+	pins.push_back(0);
+	lru_position.push_back(lru.end());
+	if(packed)
+		packed_slices.push_back(NULL);
+
+	return t;
+}
+
+GLvoid GLSliceProvider::waitForLoads()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	drainLoads(lock);
+}
+
+// expects the mutex to be held by _lock, queued prefetches are dropped (their tasks see it and return)
+GLvoid GLSliceProvider::drainLoads(std::unique_lock<std::mutex>& _lock)
+{
+	for(GLint t=0; t<no_slices; t++)
+	{
+		if(state[t] == SLICE_QUEUED)
+			state[t] = SLICE_ABSENT;
+		while(state[t] == SLICE_LOADING)
+			slice_loaded.wait(_lock);
+	}
+}
+
+GLSliceView GLSliceProvider::acquireSlice(GLint _time_slice)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// somebody else (usually a prefetch) is loading it already; a prefetch that is only queued
+	// may sit behind the task calling this, so it is loaded here instead of waited for
+	while(state[_time_slice] == SLICE_LOADING)
+		slice_loaded.wait(lock);
+
+	pins[_time_slice]++;
+
+	if(state[_time_slice] == SLICE_RESIDENT)
+	{
+		hits++;
+		if(loader)
+			lru.splice(lru.begin(), lru, lru_position[_time_slice]);
+		return viewSlice(_time_slice);
+	}
+
+	misses++;
+	state[_time_slice] = SLICE_LOADING;
+	lock.unlock();
+
+	loadSlice(_time_slice);
+
+	lock.lock();
+	insertSlice(_time_slice);
+	evictOverBudget();
+	slice_loaded.notify_all();
+
+	return viewSlice(_time_slice);
+}
+
+GLvoid GLSliceProvider::releaseSlice(GLint _time_slice)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pins[_time_slice]--;
+	evictOverBudget();
+}
+
+GLvoid GLSliceProvider::prefetch(GLint _active_slice, GLint _direction)
+{
+	if(!streaming || _direction == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for(GLint i = -prefetch_behind; i <= prefetch_ahead; i++)
+	{
+		GLint t = _active_slice + i * _direction;
+		if(t < 0 || t >= no_slices || state[t] != SLICE_ABSENT)
+			continue;
+
+		state[t] = SLICE_QUEUED;
+		prefetches++;
+
+		pool->submit([this, t]()
+		{
+			{
+				// acquired (and maybe evicted again) in the meantime
+				std::lock_guard<std::mutex> lock(mutex);
+				if(state[t] != SLICE_QUEUED)
+					return;
+				state[t] = SLICE_LOADING;
+			}
+
+			loadSlice(t);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			insertSlice(t);
+			evictOverBudget();
+			slice_loaded.notify_all();
+		});
+	}
+}
+
+// expects the mutex to be held
+GLvoid GLSliceProvider::insertSlice(GLint _time_slice)
+{
+	state[_time_slice] = SLICE_RESIDENT;
+	resident_bytes += slice_bytes;
+	lru.push_front(_time_slice);
+	lru_position[_time_slice] = lru.begin();
+}
+
+// expects the mutex to be held, drops least recently used slices that nobody holds
+GLvoid GLSliceProvider::evictOverBudget()
+{
+	if(!loader)
+		return;
+
+	std::list<GLint>::iterator candidate = lru.end();
+	while(resident_bytes > memory_budget && candidate != lru.begin())
+	{
+		--candidate;
+		GLint t = *candidate;
+		if(pins[t] > 0)
+			continue;
+
+		candidate = lru.erase(candidate);
+		dropSlice(t);
+		state[t] = SLICE_ABSENT;
+		resident_bytes -= slice_bytes;
+		evictions++;
+	}
+}
+
+GLboolean GLSliceProvider::isStreaming()
+{
+	return streaming;
+}
+
+GLboolean GLSliceProvider::isPacked()
+{
+	return packed;
+}
+
+const GLushort* GLSliceProvider::getVolume()
+{
+	return volume;
+}
+
+GLint GLSliceProvider::getNoSlices()
+{
+	return no_slices;
+}
+
+size_t GLSliceProvider::getMemoryBudget()
+{
+	return memory_budget;
+}
+
+size_t GLSliceProvider::getResidentBytes()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return resident_bytes;
+}
+
+uint64_t GLSliceProvider::getHits()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return hits;
+}
+
+uint64_t GLSliceProvider::getMisses()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return misses;
+}
+
+uint64_t GLSliceProvider::getEvictions()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return evictions;
+}
+
+GLvoid GLSliceProvider::printStatistics()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::cout << "info: slice cache " << (streaming ? "streaming" : "resident") << (packed ? " 12Bit packed" : " 16Bit")
+			  << ", " << resident_bytes / (1024 * 1024) << " of " << memory_budget / (1024 * 1024) << " MB used" << std::endl;
+	std::cout << "      hits: " << hits << ", misses: " << misses << ", evictions: " << evictions
+			  << ", prefetches: " << prefetches << std::endl;
+}
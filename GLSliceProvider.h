@@ -0,0 +1,135 @@
+#ifndef GLSLICEPROVIDER_H
+#define GLSLICEPROVIDER_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <vector>
+#include <functional>
+#include "GLStackLoader.h"
+#include "GLWorkerPool.h"
+#include "GLPacked12.h"
+
+/**
+ * A raw slice as handed out by GLSliceProvider, either 16Bit or 12Bit packed.
+ * Single voxels are decoded on the fly, unpacked() decodes the whole slice.
+ */
+struct GLSliceView
+{
+	const GLushort* pixels;		// NULL if packed
+	const GLubyte* packed;
+	size_t count;
+
+	GLushort operator[](size_t _index) const
+	{
+		return pixels ? pixels[_index] : unpackVoxel12(packed, _index);
+	}
+
+	// the 16Bit slice, decoded into _scratch (count voxels) if necessary
+	const GLushort* unpacked(GLushort* _scratch) const
+	{
+		if(pixels)
+			return pixels;
+		unpack12(packed, _scratch, count);
+		return _scratch;
+	}
+};
+
+// sees every 16Bit slice right after it was read or mapped, on the thread that loads it
+typedef std::function<GLvoid(GLint _time_slice, const GLushort* _slice)> GLSliceStage;
+
+/**
+ * Hands out the raw slices of a stack. If the stack fits into the memory budget
+ * every slice is loaded up front, otherwise slices are loaded on demand and kept
+ * in a LRU cache that never grows (much) beyond the budget.
+ *
+ * With _packed the slices are kept 12Bit packed (counts above 4095 saturate),
+ * which fits a third more slices into the same budget.
+ *
+ * A slice returned by acquireSlice() stays valid (is never evicted) until the
+ * matching releaseSlice(). All functions are thread safe.
+ */
+class GLSliceProvider
+{
+	public:
+		GLSliceProvider(GLStackLoader* _loader, GLWorkerPool* _pool, size_t _memory_budget, GLboolean _packed = false);
+		// fully resident slice table that is owned by someone else, e.g. a mapped GLVolumeCache
+		GLSliceProvider(GLushort** _slices, GLint _no_slices, GLint _width, GLint _height);
+		~GLSliceProvider();
+
+		// runs before a loaded slice is packed and handed out, set it before the first acquireSlice()
+		GLvoid setLoadStage(GLSliceStage _stage);
+		// adds the next slice of the stack on disk, see GLStackLoader::appendSlice()
+		GLint appendSlice();
+		// returns once no slice is loading (so no load stage runs) and drops queued prefetches
+		GLvoid waitForLoads();
+		GLSliceView acquireSlice(GLint _time_slice);
+		GLvoid releaseSlice(GLint _time_slice);
+
+		// loads the slices following _active_slice in scroll direction (+1/-1) in the background
+		GLvoid prefetch(GLint _active_slice, GLint _direction);
+
+		GLboolean isStreaming();
+		GLboolean isPacked();
+		// all slices as one volume (x, then y, then t) if they lie back to back, e.g. mapped from a GLVolumeCache, else NULL
+		const GLushort* getVolume();
+		GLint getNoSlices();
+		size_t getMemoryBudget();
+		size_t getResidentBytes();
+		uint64_t getHits();
+		uint64_t getMisses();
+		uint64_t getEvictions();
+		GLvoid printStatistics();
+
+	private:
+		enum SliceState
+		{
+			SLICE_ABSENT,
+			SLICE_QUEUED,		// prefetch submitted but not started, acquireSlice() takes it over
+			SLICE_LOADING,
+			SLICE_RESIDENT
+		};
+
+		GLStackLoader* loader;		// NULL for a fixed slice table
+		GLWorkerPool* pool;
+		GLushort** slices;
+		const GLushort* volume;		// only for a contiguous fixed slice table
+		std::vector<GLubyte*> packed_slices;	// only if packed
+
+		GLint no_slices;
+		size_t slice_size;			// voxels
+		size_t slice_bytes;			// as stored
+		GLboolean packed;
+		size_t memory_budget;
+		size_t resident_bytes;
+		GLboolean streaming;
+
+		GLSliceStage load_stage;	// slices of a fixed table never pass through it
+
+		GLint prefetch_ahead;
+		GLint prefetch_behind;
+
+		std::mutex mutex;
+		std::condition_variable slice_loaded;
+		std::vector<SliceState> state;
+		std::vector<GLint> pins;
+		std::list<GLint> lru;		// most recently used first
+		std::vector<std::list<GLint>::iterator> lru_position;
+
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		uint64_t prefetches;
+
+		GLvoid loadSlice(GLint _time_slice);
+		GLvoid dropSlice(GLint _time_slice);
+		GLSliceView viewSlice(GLint _time_slice);
+		GLvoid drainLoads(std::unique_lock<std::mutex>& _lock);
+		GLvoid insertSlice(GLint _time_slice);
+		GLvoid evictOverBudget();
+};
+
+#endif
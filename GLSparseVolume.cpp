@@ -0,0 +1,228 @@
+#include "GLSparseVolume.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// edge of the octree leaves in voxels, also the slices per block of the counting sort
+#define SPARSE_BRICK 8
+
+
+GLSparseVolume::GLSparseVolume()
+{
+	size[0] = size[1] = size[2] = 0;
+	volume = NULL;
+	memset(counts, 0, sizeof(counts));
+}
+
+GLvoid GLSparseVolume::build(const GLubyte* _volume, GLint _width, GLint _height, GLint _depth,
+							 const GLubyte* _luts, const GLboolean* _slices, GLWorkerPool* _pool)
+{
+	size[0] = _width;
+	size[1] = _height;
+	size[2] = _depth;
+	volume = _volume;
+	luts.assign(_luts, _luts + _depth * 256);
+	slices.assign(_slices, _slices + _depth);
+
+	GLint bricks_x = (_width + SPARSE_BRICK - 1) / SPARSE_BRICK;
+	GLint bricks_y = (_height + SPARSE_BRICK - 1) / SPARSE_BRICK;
+	GLint blocks = (_depth + SPARSE_BRICK - 1) / SPARSE_BRICK;
+	nodes.assign(1, std::vector<GLubyte>((size_t) bricks_x * bricks_y * blocks, 0));
+	node_sizes.assign({bricks_x, bricks_y, blocks});
+
+	// value histogram and brick maxima of every block of slices
+	std::vector<size_t> histograms((size_t) blocks * 256, 0);
+	_pool->parallelFor(0, blocks, [&](GLint _block)
+	{
+		size_t* histogram = &histograms[(size_t) _block * 256];
+		GLubyte* bricks = &nodes[0][(size_t) _block * bricks_x * bricks_y];
+		for(GLint t=_block * SPARSE_BRICK; t<_depth && t<(_block + 1) * SPARSE_BRICK; t++)
+		{
+			if(!_slices[t])
+				continue;
+
+			const GLubyte* lut = _luts + t * 256;
+			const GLubyte* slice = _volume + (size_t) t * _width * _height;
+			for(GLint y=0; y<_height; y++)
+			{
+				for(GLint x=0; x<_width; x++)
+				{
+					GLubyte value = lut[slice[y * _width + x]];
+					histogram[value]++;
+					GLubyte& brick = bricks[y / SPARSE_BRICK * bricks_x + x / SPARSE_BRICK];
+					brick = value > brick ? value : brick;
+				}
+			}
+		}
+	});
+
+	// values from high to low, within a value the blocks in order
+	std::vector<size_t> offsets((size_t) blocks * 256);
+	size_t offset = 0;
+	counts[256] = 0;
+	for(GLint v=255; v>=0; v--)
+	{
+		for(GLint b=0; b<blocks; b++)
+		{
+			offsets[(size_t) b * 256 + v] = offset;
+			offset += histograms[(size_t) b * 256 + v];
+		}
+		counts[v] = offset;
+	}
+
+	voxels.resize(offset);
+	_pool->parallelFor(0, blocks, [&](GLint _block)
+	{
+		size_t* cursors = &offsets[(size_t) _block * 256];
+		for(GLint t=_block * SPARSE_BRICK; t<_depth && t<(_block + 1) * SPARSE_BRICK; t++)
+		{
+			if(!_slices[t])
+				continue;
+
+			const GLubyte* lut = _luts + t * 256;
+			GLuint first = (GLuint) t * _width * _height;
+			const GLubyte* slice = _volume + first;
+			for(GLuint i=0; i<(GLuint) (_width * _height); i++)
+				voxels[cursors[lut[slice[i]]]++] = first + i;
+		}
+	});
+
+	// octree levels up to a single node
+	while(node_sizes[node_sizes.size() - 3] > 1 || node_sizes[node_sizes.size() - 2] > 1 || node_sizes[node_sizes.size() - 1] > 1)
+	{
+		GLint child_size[3] = {node_sizes[node_sizes.size() - 3], node_sizes[node_sizes.size() - 2], node_sizes[node_sizes.size() - 1]};
+		GLint parent_size[3] = {(child_size[0] + 1) / 2, (child_size[1] + 1) / 2, (child_size[2] + 1) / 2};
+		const std::vector<GLubyte>& children = nodes.back();
+		std::vector<GLubyte> parents((size_t) parent_size[0] * parent_size[1] * parent_size[2], 0);
+		for(GLint t=0; t<child_size[2]; t++)
+		{
+			for(GLint y=0; y<child_size[1]; y++)
+			{
+				for(GLint x=0; x<child_size[0]; x++)
+				{
+					GLubyte child = children[((size_t) t * child_size[1] + y) * child_size[0] + x];
+					GLubyte& parent = parents[((size_t) (t / 2) * parent_size[1] + y / 2) * parent_size[0] + x / 2];
+					parent = child > parent ? child : parent;
+				}
+			}
+		}
+		nodes.push_back(parents);
+		node_sizes.insert(node_sizes.end(), parent_size, parent_size + 3);
+	}
+}
+
+GLboolean GLSparseVolume::isOutdated(const GLuint* _key, GLint _size)
+{
+	return key.isOutdated(_key, _size);
+}
+
+size_t GLSparseVolume::getCount(GLint _threshold)
+{
+	_threshold = _threshold > -1 ? _threshold : -1;
+	return _threshold < 255 ? counts[_threshold + 1] : 0;
+}
+
+const GLuint* GLSparseVolume::getVoxels()
+{
+	return voxels.data();
+}
+
+GLint GLSparseVolume::getNoLevels()
+{
+	return (GLint) nodes.size();
+}
+
+GLubyte GLSparseVolume::getNodeMax(GLint _level, GLint _x, GLint _y, GLint _t)
+{
+	const GLint* level_size = &node_sizes[_level * 3];
+	return nodes[_level][((size_t) _t * level_size[1] + _y) * level_size[0] + _x];
+}
+
+GLubyte GLSparseVolume::getValue(GLint _x, GLint _y, GLint _t)
+{
+	return luts[_t * 256 + volume[((size_t) _t * size[1] + _y) * size[0] + _x]];
+}
+
+/**
+ * walks the ray from cell to cell, a cell is the largest empty node around the current voxel
+ * (or the voxel itself), so empty bricks and octants are crossed in one step
+ */
+GLboolean GLSparseVolume::pick(const GLfloat* _origin, const GLfloat* _direction, GLint _threshold, GLint* _voxel)
+{
+	if(nodes.empty())
+		return false;
+
+	GLfloat length = sqrtf(_direction[0] * _direction[0] + _direction[1] * _direction[1] + _direction[2] * _direction[2]);
+	if(length == 0)
+		return false;
+	GLfloat direction[3] = {_direction[0] / length, _direction[1] / length, _direction[2] / length};
+
+	// clip the ray to the volume
+	GLfloat enter = 0;
+	GLfloat leave = INFINITY;
+	for(GLint a=0; a<3; a++)
+	{
+		if(fabsf(direction[a]) < 1e-7f)
+		{
+			if(_origin[a] < 0 || _origin[a] >= size[a])
+				return false;
+			continue;
+		}
+		GLfloat s0 = -_origin[a] / direction[a];
+		GLfloat s1 = (size[a] - _origin[a]) / direction[a];
+		enter = std::max(enter, std::min(s0, s1));
+		leave = std::min(leave, std::max(s0, s1));
+	}
+	if(enter >= leave)
+		return false;
+
+	// the walk starts at the entry point, so s stays within the volume diagonal where a float
+	// still resolves the small steps, however far away the origin is
+	GLfloat entry[3];
+	for(GLint a=0; a<3; a++)
+		entry[a] = _origin[a] + enter * direction[a];
+	leave -= enter;
+
+	for(GLfloat s=0; s<leave; )
+	{
+		GLint voxel[3];
+		for(GLint a=0; a<3; a++)
+		{
+			voxel[a] = (GLint) floorf(entry[a] + s * direction[a]);
+			voxel[a] = voxel[a] > 0 ? voxel[a] : 0;
+			voxel[a] = voxel[a] < size[a] - 1 ? voxel[a] : size[a] - 1;
+		}
+
+		// the coarsest empty node around the voxel
+		GLint extent = 1;
+		for(GLint level=(GLint) nodes.size() - 1; level>=0; level--)
+		{
+			GLint node_extent = SPARSE_BRICK << level;
+			if(getNodeMax(level, voxel[0] / node_extent, voxel[1] / node_extent, voxel[2] / node_extent) <= _threshold)
+			{
+				extent = node_extent;
+				break;
+			}
+		}
+
+		if(extent == 1 && slices[voxel[2]] && getValue(voxel[0], voxel[1], voxel[2]) > _threshold)
+		{
+			memcpy(_voxel, voxel, sizeof(voxel));
+			return true;
+		}
+
+		// on to the cell behind this one
+		GLfloat exit = INFINITY;
+		for(GLint a=0; a<3; a++)
+		{
+			GLfloat low = (GLfloat) (voxel[a] / extent * extent);
+			if(direction[a] > 1e-7f)
+				exit = std::min(exit, (low + extent - entry[a]) / direction[a]);
+			else if(direction[a] < -1e-7f)
+				exit = std::min(exit, (low - entry[a]) / direction[a]);
+		}
+		// past the boundary, s grows every iteration even where 1e-4 is below its precision
+		s = nextafterf(std::max(exit, s), INFINITY) + 1e-4f;
+	}
+	return false;
+}
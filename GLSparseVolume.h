@@ -0,0 +1,63 @@
+#ifndef GLSPARSEVOLUME_H
+#define GLSPARSEVOLUME_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <vector>
+#include "GLWorkerPool.h"
+#include "GLRetainedKey.h"
+
+/**
+ * Occupied voxels of an 8Bit volume, sorted by value from high to low, so the voxels above
+ * any threshold are a prefix of one list: a new threshold is getCount(), no voxel is read.
+ * The values are mapped through a 256 entry table per slice first (the contrast), slices
+ * that are left out (not loaded, not drawn) hold no voxels.
+ *
+ * build() is a parallel counting sort over blocks of SPARSE_BRICK slices: one pass counts
+ * the values of every block, a prefix sum over (value, block) gives every block its own
+ * range per value and a second pass scatters the voxel indices into them.
+ * The first pass also records the max of every SPARSE_BRICK^3 brick, the leaves of an
+ * occupancy octree (max of 2x2x2 nodes upwards) that pick() uses to skip empty space.
+ */
+class GLSparseVolume
+{
+	public:
+		GLSparseVolume();
+
+		GLboolean isOutdated(const GLuint* _key, GLint _size);	// GLRetainedKey
+
+		// _volume[(t * _height + y) * _width + x], _luts[t * 256 + value], _slices[t] false to leave t out,
+		// _volume is read by pick() until the next build
+		GLvoid build(const GLubyte* _volume, GLint _width, GLint _height, GLint _depth,
+					 const GLubyte* _luts, const GLboolean* _slices, GLWorkerPool* _pool);
+
+		// number of voxels with a value > _threshold, -1 counts all, the ones with value v are
+		// getVoxels()[getCount(v) .. getCount(v - 1))
+		size_t getCount(GLint _threshold);
+		const GLuint* getVoxels();		// (t * height + y) * width + x
+
+		// the first voxel with a value > _threshold the ray _origin + s * _direction (s >= 0) runs
+		// into, voxel (x, y, t) spans [x, x + 1) * [y, y + 1) * [t, t + 1), false if there is none
+		GLboolean pick(const GLfloat* _origin, const GLfloat* _direction, GLint _threshold, GLint* _voxel);
+
+		// max of the node, octree level 0 are the bricks
+		GLubyte getNodeMax(GLint _level, GLint _x, GLint _y, GLint _t);
+		GLint getNoLevels();
+
+	private:
+		GLint size[3];
+		const GLubyte* volume;
+		std::vector<GLubyte> luts;
+		std::vector<GLboolean> slices;
+		GLRetainedKey key;
+
+		std::vector<GLuint> voxels;
+		size_t counts[257];		// counts[v + 1] voxels with a value > v
+
+		std::vector<std::vector<GLubyte> > nodes;	// max per node, x fastest
+		std::vector<GLint> node_sizes;				// 3 per level
+
+		GLubyte getValue(GLint _x, GLint _y, GLint _t);
+};
+
+#endif
@@ -0,0 +1,414 @@
+#include "GLStackLoader.h"
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <tiffio.h>
+
+
+GLStackLoader::GLStackLoader(const GLchar* _path_root, const GLchar* _filename_root)
+{
+	path_root = _path_root;
+	filename_root = _filename_root;
+
+	width = 0;
+	height = 0;
+	no_slices = 0;
+	capacity = 0;
+	slices = NULL;
+	slice_maps = NULL;
+	slice_map_lengths = NULL;
+	load_time = NULL;
+	correction = NULL;
+}
+
+GLStackLoader::~GLStackLoader()
+{
+	for(GLint t=0; t<no_slices; t++)
+		releaseSlice(t);
+
+	delete[] slices;
+	delete[] slice_maps;
+	delete[] slice_map_lengths;
+	delete[] load_time;
+}
+
+GLvoid GLStackLoader::slicePath(GLint _time_slice, GLchar* _path)
+{
+	sprintf(_path, "%s%s%d.tif", path_root, filename_root, _time_slice);
+}
+
+GLint GLStackLoader::probe(GLint _max_slices)
+{
+	GLchar path[256];
+	struct stat file_info;
+
+	no_slices = 0;
+	while(_max_slices <= 0 || no_slices < _max_slices)
+	{
+		slicePath(no_slices, path);
+		if(stat(path, &file_info) != 0)
+			break;
+		no_slices++;
+	}
+
+	if(no_slices == 0)
+	{
+		std::cout << "error: no slices found at " << path_root << filename_root << "0.tif" << std::endl;
+		return 0;
+	}
+
+	slicePath(0, path);
+	TIFF* tif = TIFFOpen(path, "r");
+	if(!tif)
+	{
+		no_slices = 0;
+		return 0;
+	}
+
+	uint32 image_width = 0;
+	uint32 image_height = 0;
+	TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &image_width);
+	TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &image_height);
+	TIFFClose(tif);
+
+	width = (GLint) image_width;
+	height = (GLint) image_height;
+
+	reserve(no_slices);
+
+	return no_slices;
+}
+
+GLvoid GLStackLoader::reserve(GLint _capacity)
+{
+	if(_capacity <= capacity)
+		return;
+
+	GLushort** new_slices = new GLushort*[_capacity];
+	GLvoid** new_slice_maps = new GLvoid*[_capacity];
+	size_t* new_slice_map_lengths = new size_t[_capacity];
+	GLdouble* new_load_time = new GLdouble[_capacity];
+
+	for(GLint t=0; t<_capacity; t++)
+	{
+		GLboolean used = t < capacity;
+		new_slices[t] = used ? slices[t] : NULL;
+		new_slice_maps[t] = used ? slice_maps[t] : NULL;
+		new_slice_map_lengths[t] = used ? slice_map_lengths[t] : 0;
+		new_load_time[t] = used ? load_time[t] : 0;
+	}
+
+	delete[] slices;
+	delete[] slice_maps;
+	delete[] slice_map_lengths;
+	delete[] load_time;
+	slices = new_slices;
+	slice_maps = new_slice_maps;
+	slice_map_lengths = new_slice_map_lengths;
+	load_time = new_load_time;
+	capacity = _capacity;
+}
+
+GLint GLStackLoader::appendSlice()
+{
+	// grow geometrically, appending stays O(1) amortized
+	if(no_slices == capacity)
+		reserve(capacity < 16 ? 32 : 2 * capacity);
+
+	return no_slices++;
+}
+
+/**
+ * Zero-copy fast path: the file is mapped and the pixel data is used where it
+ * lies, if it is a single plane of uncompressed little-endian 16Bit
+ * BlackIsZero samples stored in one run of contiguous strips.
+ * Anything else returns NULL and is left to libtiff.
+ */
+GLushort* GLStackLoader::mapTiff(GLint _time_slice, GLvoid** _map, size_t* _map_length)
+{
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	return NULL;
+#endif
+	GLchar path[256];
+	slicePath(_time_slice, path);
+
+	GLint fd = open(path, O_RDONLY);
+	if(fd < 0)
+		return NULL;
+
+	struct stat file_info;
+	if(fstat(fd, &file_info) != 0 || file_info.st_size < 8)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	size_t file_size = (size_t) file_info.st_size;
+	GLvoid* map = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+		return NULL;
+
+	const GLubyte* file = (const GLubyte*) map;
+
+	// bounds checked little-endian readers
+	#define READ16(offset) ((offset) + 2 <= file_size ? (GLuint) (file[(offset)] | file[(offset) + 1] << 8) : 0)
+	#define READ32(offset) ((offset) + 4 <= file_size ? (GLuint) (file[(offset)] | file[(offset) + 1] << 8 | file[(offset) + 2] << 16 | (GLuint) file[(offset) + 3] << 24) : 0)
+
+	GLuint image_width = 0, image_height = 0;
+	GLuint bits_per_sample = 1, compression = 1, photometric = 0xffff;
+	GLuint samples_per_pixel = 1, planar_config = 1, sample_format = 1;
+	GLuint rows_per_strip = 0xffffffff;
+	GLuint no_strips = 0, strip_offsets_type = 0, strip_counts_type = 0;
+	size_t strip_offsets_at = 0, strip_counts_at = 0;
+	GLboolean tiled = false;
+
+	GLboolean usable = file[0] == 'I' && file[1] == 'I' && READ16(2) == 42;
+	size_t ifd = READ32(4);
+	GLuint no_entries = READ16(ifd);
+	usable = usable && ifd != 0 && ifd + 2 + 12 * (size_t) no_entries <= file_size;
+
+	for(GLuint i=0; usable && i<no_entries; i++)
+	{
+		size_t entry = ifd + 2 + 12 * i;
+		GLuint tag = READ16(entry);
+		GLuint type = READ16(entry + 2);		// 3 = SHORT, 4 = LONG
+		GLuint count = READ32(entry + 4);
+		GLuint value = type == 3 ? READ16(entry + 8) : READ32(entry + 8);
+
+		switch(tag)
+		{
+			case 256: image_width = value; break;
+			case 257: image_height = value; break;
+			case 258: bits_per_sample = value; break;
+			case 259: compression = value; break;
+			case 262: photometric = value; break;
+			case 277: samples_per_pixel = value; break;
+			case 278: rows_per_strip = value; break;
+			case 284: planar_config = value; break;
+			case 339: sample_format = value; break;
+			case 322: case 323: case 324: case 325: tiled = true; break;
+			case 273:
+			case 279:
+			{
+				if(type != 3 && type != 4)
+				{
+					usable = false;
+					break;
+				}
+				// arrays that don't fit into the 4 value bytes are stored elsewhere
+				size_t element_size = type == 3 ? 2 : 4;
+				size_t at = count * element_size <= 4 ? entry + 8 : READ32(entry + 8);
+				usable = usable && at + count * element_size <= file_size;
+				if(tag == 273)
+				{
+					no_strips = count;
+					strip_offsets_type = type;
+					strip_offsets_at = at;
+				}
+				else
+				{
+					usable = usable && count == no_strips;
+					strip_counts_type = type;
+					strip_counts_at = at;
+				}
+				break;
+			}
+		}
+	}
+
+	usable = usable && !tiled && (GLint) image_width == width && (GLint) image_height == height
+			&& bits_per_sample == 16 && compression == 1 && photometric == 1
+			&& samples_per_pixel == 1 && planar_config == 1 && sample_format == 1
+			&& no_strips > 0 && strip_counts_type != 0 && rows_per_strip > 0;
+
+	// the strips have to follow each other without gaps to form one slice
+	size_t slice_size = (size_t) width * height * sizeof(GLushort);
+	size_t data_start = 0;
+	size_t data_end = 0;
+	for(GLuint i=0; usable && i<no_strips; i++)
+	{
+		size_t offset = strip_offsets_type == 3 ? READ16(strip_offsets_at + 2 * i) : READ32(strip_offsets_at + 4 * i);
+		size_t count = strip_counts_type == 3 ? READ16(strip_counts_at + 2 * i) : READ32(strip_counts_at + 4 * i);
+		if(i == 0)
+			data_start = data_end = offset;
+		usable = offset == data_end;
+		data_end = offset + count;
+	}
+
+	#undef READ16
+	#undef READ32
+
+	usable = usable && data_end - data_start == slice_size && data_end <= file_size
+			&& data_start % sizeof(GLushort) == 0;
+
+	if(!usable)
+	{
+		munmap(map, file_size);
+		return NULL;
+	}
+
+	// start reading the pixel pages ahead of the first access
+	madvise(map, file_size, MADV_WILLNEED);
+
+	*_map = map;
+	*_map_length = file_size;
+	return (GLushort*) (file + data_start);
+}
+
+GLboolean GLStackLoader::loadTiff(GLint _time_slice, GLushort* _slice)
+{
+	GLchar path[256];
+	slicePath(_time_slice, path);
+	return readTiff(path, width, height, _slice);
+}
+
+GLboolean GLStackLoader::readTiff(const GLchar* _path, GLint _width, GLint _height, GLushort* _pixels)
+{
+	TIFF* tif = TIFFOpen(_path, "r");
+	if(!tif)
+		return false;
+
+	uint32 image_height = 0;
+	uint32 image_width = 0;
+	uint16 config = PLANARCONFIG_CONTIG;
+	uint16 bits_per_sample = 0;
+	uint16 samples_per_pixel = 1;
+
+	TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &image_height);
+	TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &image_width);
+	TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &config);
+	TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+	TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+
+	GLboolean valid = (GLint) image_width == _width && (GLint) image_height == _height
+					&& bits_per_sample == 16 && samples_per_pixel == 1
+					&& config == PLANARCONFIG_CONTIG;
+
+	if(!valid)
+	{
+		std::cout << "error: " << _path << " is " << image_width << "x" << image_height << "x" << bits_per_sample
+				  << "Bit, expected " << _width << "x" << _height << "x16Bit" << std::endl;
+		TIFFClose(tif);
+		return false;
+	}
+
+	// a row of 16Bit samples is exactly one row of the slice, read it in place
+	GLboolean complete = true;
+	for(GLint y = 0; y < _height; y++)
+	{
+		if(TIFFReadScanline(tif, _pixels + y * _width, y, 0) < 0)
+		{
+			complete = false;
+			break;
+		}
+	}
+
+	TIFFClose(tif);
+	return complete;
+}
+
+GLvoid GLStackLoader::setCorrection(GLSliceCorrection* _correction)
+{
+	correction = _correction;
+}
+
+GLSliceCorrection* GLStackLoader::getCorrection()
+{
+	return correction;
+}
+
+GLboolean GLStackLoader::loadSlice(GLint _time_slice)
+{
+	if(slices[_time_slice])
+		return true;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	GLushort* slice = mapTiff(_time_slice, &slice_maps[_time_slice], &slice_map_lengths[_time_slice]);
+	if(slice && correction)
+	{
+		// the correction is the copy out of the read only mapping
+		GLushort* corrected = new GLushort[(size_t) width * height];
+		correction->apply(slice, corrected);
+		munmap(slice_maps[_time_slice], slice_map_lengths[_time_slice]);
+		slice_maps[_time_slice] = NULL;
+		slice_map_lengths[_time_slice] = 0;
+		slice = corrected;
+	}
+	else if(!slice)
+	{
+		slice = new GLushort[(size_t) width * height];
+		if(!loadTiff(_time_slice, slice))
+		{
+			memset(slice, 0, (size_t) width * height * sizeof(GLushort));
+			slices[_time_slice] = slice;
+			return false;
+		}
+		if(correction)
+			correction->apply(slice, slice);
+	}
+
+	slices[_time_slice] = slice;
+	load_time[_time_slice] = std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+GLvoid GLStackLoader::releaseSlice(GLint _time_slice)
+{
+	if(slice_maps[_time_slice])
+		munmap(slice_maps[_time_slice], slice_map_lengths[_time_slice]);
+	else
+		delete[] slices[_time_slice];
+
+	slices[_time_slice] = NULL;
+	slice_maps[_time_slice] = NULL;
+	slice_map_lengths[_time_slice] = 0;
+}
+
+GLvoid GLStackLoader::printLoadTimes(GLdouble _total_time, GLint _no_threads)
+{
+	GLchar path[256];
+	GLdouble sum_time = 0;
+	GLint mapped = 0;
+	for(GLint t=0; t<no_slices; t++)
+	{
+		slicePath(t, path);
+		std::cout << "info: loaded " << path << " in " << load_time[t] << " ms" << std::endl;
+		sum_time += load_time[t];
+		if(slice_maps[t])
+			mapped++;
+	}
+	std::cout << "info: loaded " << no_slices << " slices in " << _total_time << " ms ("
+			  << sum_time << " ms on " << _no_threads << " threads, "
+			  << mapped << " mapped in place)" << std::endl;
+}
+
+GLushort* GLStackLoader::getSlice(GLint _time_slice)
+{
+	return slices[_time_slice];
+}
+
+GLushort** GLStackLoader::getSlices()
+{
+	return slices;
+}
+
+GLint GLStackLoader::getWidth()
+{
+	return width;
+}
+
+GLint GLStackLoader::getHeight()
+{
+	return height;
+}
+
+GLint GLStackLoader::getNoSlices()
+{
+	return no_slices;
+}
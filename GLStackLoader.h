@@ -0,0 +1,69 @@
+#ifndef GLSTACKLOADER_H
+#define GLSTACKLOADER_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include "GLSliceCorrection.h"
+
+/**
+ * Loads a numbered stack of 16Bit TIFF images (<path_root><filename_root><n>.tif).
+ * Every slice is stored x-fastest, then y. Uncompressed little-endian 16Bit
+ * grayscale files (what the DLD writes) are mmapped and used in place,
+ * everything else is decoded by libtiff into a buffer of its own.
+ * With a GLSliceCorrection set, mapped slices are corrected into a buffer of their
+ * own on the way out of the mapping, decoded ones in place.
+ */
+class GLStackLoader
+{
+	public:
+		GLStackLoader(const GLchar* _path_root, const GLchar* _filename_root);
+		~GLStackLoader();
+
+		// counts the consecutive slices on disk (at most _max_slices, 0 = no limit)
+		// and reads the image size from the first one, returns the slice count
+		GLint probe(GLint _max_slices = 0);
+
+		// adds the next slice (<no_slices>.tif) to the stack, returns its index,
+		// must not run while slices are loaded concurrently (the tables may move)
+		GLint appendSlice();
+
+		// set before the first slice is loaded, NULL for the raw counts
+		GLvoid setCorrection(GLSliceCorrection* _correction);
+		GLSliceCorrection* getCorrection();
+
+		GLboolean loadSlice(GLint _time_slice);
+		GLvoid releaseSlice(GLint _time_slice);
+		GLvoid printLoadTimes(GLdouble _total_time, GLint _no_threads);
+
+		GLushort* getSlice(GLint _time_slice);
+		GLushort** getSlices();
+
+		GLvoid slicePath(GLint _time_slice, GLchar* _path);
+		GLint getWidth();
+		GLint getHeight();
+		GLint getNoSlices();
+
+		// any single plane 16Bit grayscale TIFF of _width x _height, via libtiff
+		static GLboolean readTiff(const GLchar* _path, GLint _width, GLint _height, GLushort* _pixels);
+
+	private:
+		const GLchar* path_root;
+		const GLchar* filename_root;
+
+		GLint width;
+		GLint height;
+		GLint no_slices;
+		GLint capacity;
+
+		GLushort** slices;			// pixel data of every slice, either inside a mapping or owned
+		GLvoid** slice_maps;		// mmap base per slice, NULL if decoded by libtiff
+		size_t* slice_map_lengths;
+		GLdouble* load_time;		// per slice, ms
+		GLSliceCorrection* correction;
+
+		GLvoid reserve(GLint _capacity);
+		GLushort* mapTiff(GLint _time_slice, GLvoid** _map, size_t* _map_length);
+		GLboolean loadTiff(GLint _time_slice, GLushort* _slice);
+};
+
+#endif
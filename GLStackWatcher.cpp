@@ -0,0 +1,68 @@
+#include "GLStackWatcher.h"
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+
+GLStackWatcher::GLStackWatcher(const GLchar* _path_root, const GLchar* _filename_root)
+{
+	filename_root = _filename_root;
+
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(inotify_fd >= 0 && inotify_add_watch(inotify_fd, _path_root, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(inotify_fd);
+		inotify_fd = -1;
+	}
+
+	if(inotify_fd < 0)
+		std::cout << "error: cannot watch " << _path_root << " for new slices" << std::endl;
+}
+
+GLStackWatcher::~GLStackWatcher()
+{
+	if(inotify_fd >= 0)
+		close(inotify_fd);
+}
+
+GLboolean GLStackWatcher::isWatching()
+{
+	return inotify_fd >= 0;
+}
+
+GLvoid GLStackWatcher::poll()
+{
+	if(inotify_fd < 0)
+		return;
+
+	alignas(struct inotify_event) GLchar buffer[4096];
+	size_t root_length = strlen(filename_root);
+
+	while(true)
+	{
+		ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+		if(length <= 0)
+			return;
+
+		for(GLchar* p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*) p)->len)
+		{
+			struct inotify_event* event = (struct inotify_event*) p;
+			if(event->len == 0 || strncmp(event->name, filename_root, root_length) != 0)
+				continue;
+
+			// <filename_root><n>.tif
+			GLchar* end;
+			const GLchar* number = event->name + root_length;
+			long time_slice = strtol(number, &end, 10);
+			if(end != number && strcmp(end, ".tif") == 0 && time_slice >= 0)
+				completed.insert((GLint) time_slice);
+		}
+	}
+}
+
+GLboolean GLStackWatcher::isComplete(GLint _time_slice)
+{
+	return completed.count(_time_slice) > 0;
+}
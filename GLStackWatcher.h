@@ -0,0 +1,27 @@
+#ifndef GLSTACKWATCHER_H
+#define GLSTACKWATCHER_H
+
+#include <GL/gl.h>
+#include <set>
+
+/**
+ * Watches <path_root> with inotify for slices (<filename_root><n>.tif) that are
+ * written completely (closed after writing or moved into place) during acquisition.
+ */
+class GLStackWatcher
+{
+	public:
+		GLStackWatcher(const GLchar* _path_root, const GLchar* _filename_root);
+		~GLStackWatcher();
+
+		GLboolean isWatching();
+		GLvoid poll();				// non blocking
+		GLboolean isComplete(GLint _time_slice);
+
+	private:
+		const GLchar* filename_root;
+		GLint inotify_fd;
+		std::set<GLint> completed;
+};
+
+#endif
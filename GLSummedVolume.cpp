@@ -0,0 +1,131 @@
+#include "GLSummedVolume.h"
+#include <string.h>
+#include <new>
+
+// rows of the xy plane accumulated per parallelFor index
+#define INTEGRATE_BLOCK_ROWS 16
+
+
+GLSummedVolume::GLSummedVolume(GLint _width, GLint _height)
+{
+	width = _width;
+	height = _height;
+	capacity = 0;
+	no_integrated = 0;
+	table = NULL;
+}
+
+GLSummedVolume::~GLSummedVolume()
+{
+	delete[] table;
+}
+
+size_t GLSummedVolume::getSize(GLint _width, GLint _height, GLint _no_slices)
+{
+	return (size_t) _width * _height * _no_slices * sizeof(uint64_t);
+}
+
+GLboolean GLSummedVolume::reserve(GLint _capacity)
+{
+	if(_capacity <= capacity)
+		return true;
+
+	size_t slice_size = (size_t) width * height;
+	uint64_t* new_table = new (std::nothrow) uint64_t[slice_size * _capacity];
+	if(!new_table)
+		return false;
+
+	if(capacity > 0)
+		memcpy(new_table, table, slice_size * capacity * sizeof(uint64_t));
+
+	delete[] table;
+	table = new_table;
+	capacity = _capacity;
+	return true;
+}
+
+GLvoid GLSummedVolume::addSlice(GLint _time_slice, const GLushort* _slice)
+{
+	uint64_t* area = table + (size_t) _time_slice * width * height;
+
+	// running sum of the row plus the summed row above
+	for(GLint y=0; y<height; y++)
+	{
+		const GLushort* row = _slice + (size_t) y * width;
+		uint64_t* out = area + (size_t) y * width;
+		const uint64_t* above = out - width;
+		uint64_t row_sum = 0;
+		for(GLint x=0; x<width; x++)
+		{
+			row_sum += row[x];
+			out[x] = y > 0 ? row_sum + above[x] : row_sum;
+		}
+	}
+}
+
+GLvoid GLSummedVolume::integrate(GLint _no_slices, GLWorkerPool* _pool)
+{
+	if(_no_slices <= no_integrated)
+		return;
+
+	size_t slice_size = (size_t) width * height;
+	GLint first = no_integrated > 0 ? no_integrated : 1;
+	GLint no_blocks = (height + INTEGRATE_BLOCK_ROWS - 1) / INTEGRATE_BLOCK_ROWS;
+
+	// every block walks along t on its own, the slices it reads stay in its rows
+	_pool->parallelFor(0, no_blocks, [&](GLint _block)
+	{
+		size_t begin = (size_t) _block * INTEGRATE_BLOCK_ROWS * width;
+		size_t end = (size_t) (_block + 1) * INTEGRATE_BLOCK_ROWS * width;
+		end = end < slice_size ? end : slice_size;
+		for(GLint t=first; t<_no_slices; t++)
+		{
+			uint64_t* current = table + t * slice_size;
+			const uint64_t* previous = current - slice_size;
+			for(size_t i=begin; i<end; i++)
+				current[i] += previous[i];
+		}
+	});
+	no_integrated = _no_slices;
+}
+
+GLint GLSummedVolume::getNoIntegrated()
+{
+	return no_integrated;
+}
+
+uint64_t GLSummedVolume::at(GLint _x, GLint _y, GLint _t)
+{
+	if(_x < 0 || _y < 0 || _t < 0)
+		return 0;
+	return table[((size_t) _t * height + _y) * width + _x];
+}
+
+uint64_t GLSummedVolume::boxSum(GLint _x0, GLint _x1, GLint _y0, GLint _y1, GLint _t0, GLint _t1)
+{
+	GLint x = _x0 - 1;
+	GLint y = _y0 - 1;
+	GLint t = _t0 - 1;
+
+	// inclusion exclusion over the 8 corners, unsigned wrap around cancels out
+	return at(_x1, _y1, _t1) - at(x, _y1, _t1) - at(_x1, y, _t1) + at(x, y, _t1)
+			- at(_x1, _y1, t) + at(x, _y1, t) + at(_x1, y, t) - at(x, y, t);
+}
+
+GLvoid GLSummedVolume::edc(GLint _x0, GLint _x1, GLint _y0, GLint _y1, GLint _t0, GLint _t1, uint64_t* _out)
+{
+	for(GLint t=_t0; t<=_t1; t++)
+		_out[t - _t0] = boxSum(_x0, _x1, _y0, _y1, t, t);
+}
+
+GLvoid GLSummedVolume::mdcX(GLint _y0, GLint _y1, GLint _t0, GLint _t1, uint64_t* _out)
+{
+	for(GLint x=0; x<width; x++)
+		_out[x] = boxSum(x, x, _y0, _y1, _t0, _t1);
+}
+
+GLvoid GLSummedVolume::mdcY(GLint _x0, GLint _x1, GLint _t0, GLint _t1, uint64_t* _out)
+{
+	for(GLint y=0; y<height; y++)
+		_out[y] = boxSum(_x0, _x1, y, y, _t0, _t1);
+}
@@ -0,0 +1,53 @@
+#ifndef GLSUMMEDVOLUME_H
+#define GLSUMMEDVOLUME_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "GLWorkerPool.h"
+
+/**
+ * Summed volume table of the raw stack in 64Bit: table(x, y, t) is the sum of all counts
+ * with x' <= x, y' <= y, t' <= t. Any (x, y, t) box sum is 8 lookups, so EDCs (box over
+ * x, y per energy) and MDCs (box over y or x and an energy window per momentum) cost O(1)
+ * per sample, whatever the size of the box.
+ *
+ * Built in two steps: addSlice() turns one slice into its 2D summed area table (any order,
+ * concurrently for different slices, e.g. in the load stage), integrate() then accumulates
+ * the slices along t in order, the xy plane spread over the pool. Appended slices only need
+ * addSlice() and integrate() of themselves. All boxes are inclusive, queries need
+ * t1 < getNoIntegrated().
+ */
+class GLSummedVolume
+{
+	public:
+		GLSummedVolume(GLint _width, GLint _height);
+		~GLSummedVolume();
+
+		// grows to _capacity slices, false if the memory is not available
+		GLboolean reserve(GLint _capacity);
+		static size_t getSize(GLint _width, GLint _height, GLint _no_slices);	// bytes
+
+		GLvoid addSlice(GLint _time_slice, const GLushort* _slice);
+		GLvoid integrate(GLint _no_slices, GLWorkerPool* _pool);
+		GLint getNoIntegrated();
+
+		uint64_t boxSum(GLint _x0, GLint _x1, GLint _y0, GLint _y1, GLint _t0, GLint _t1);
+		// _out[t - _t0] for _t0 <= t <= _t1, integrated over the x, y box
+		GLvoid edc(GLint _x0, GLint _x1, GLint _y0, GLint _y1, GLint _t0, GLint _t1, uint64_t* _out);
+		// _out[x] for all x, integrated over _y0.._y1 and _t0.._t1
+		GLvoid mdcX(GLint _y0, GLint _y1, GLint _t0, GLint _t1, uint64_t* _out);
+		// _out[y] for all y, integrated over _x0.._x1 and _t0.._t1
+		GLvoid mdcY(GLint _x0, GLint _x1, GLint _t0, GLint _t1, uint64_t* _out);
+
+	private:
+		GLint width;
+		GLint height;
+		GLint capacity;
+		GLint no_integrated;
+		uint64_t* table;
+
+		uint64_t at(GLint _x, GLint _y, GLint _t);
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "GLVolumeCache.h"
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+
+#define CACHE_MAGIC "DLDCACHE"
+#define CACHE_VERSION 7
+#define CACHE_ALIGNMENT 4096
+
+
+static uint64_t alignOffset(uint64_t _offset)
+{
+	return (_offset + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+}
+
+static uint64_t pyramidSize(GLVolumePyramid* _pyramid, GLint _no_slices)
+{
+	uint64_t size = 0;
+	for(GLint l=1; l<_pyramid->getNoLevels(); l++)
+		size += _pyramid->getLevelSize(l) * _no_slices * sizeof(GLuint);
+	return size;
+}
+
+
+GLVolumeCache::GLVolumeCache(const GLchar* _path_root, const GLchar* _filename_root)
+{
+	snprintf(path, sizeof(path), "%s%s.cache", _path_root, _filename_root);
+	map = NULL;
+	map_length = 0;
+	slices = NULL;
+}
+
+GLVolumeCache::~GLVolumeCache()
+{
+	close();
+}
+
+GLint GLVolumeCache::getNoSources(GLStackLoader* _loader)
+{
+	return _loader->getNoSlices() + (_loader->getCorrection() ? _loader->getCorrection()->getNoSources() : 0);
+}
+
+GLboolean GLVolumeCache::readSources(GLStackLoader* _loader, GLVolumeCacheSource* _sources)
+{
+	GLchar slice_path[256];
+	GLchar canonical_path[PATH_MAX];
+	struct stat file_info;
+
+	memset(_sources, 0, getNoSources(_loader) * sizeof(GLVolumeCacheSource));
+	for(GLint t=0; t<getNoSources(_loader); t++)
+	{
+		_sources[t].role = CACHE_SOURCE_SLICE;
+		if(t < _loader->getNoSlices())
+			_loader->slicePath(t, slice_path);
+		else
+		{
+			GLint map = t - _loader->getNoSlices();
+			snprintf(slice_path, sizeof(slice_path), "%s", _loader->getCorrection()->getSource(map));
+			_sources[t].role = _loader->getCorrection()->getSourceMap(map) == CORRECTION_FLAT ? CACHE_SOURCE_FLAT : CACHE_SOURCE_DARK;
+		}
+		if(stat(slice_path, &file_info) != 0 || !realpath(slice_path, canonical_path)
+		   || strlen(canonical_path) >= sizeof(_sources[t].path))
+			return false;
+
+		strcpy(_sources[t].path, canonical_path);
+		_sources[t].size = (int64_t) file_info.st_size;
+		_sources[t].mtime_sec = (int64_t) file_info.st_mtim.tv_sec;
+		_sources[t].mtime_nsec = (int64_t) file_info.st_mtim.tv_nsec;
+	}
+	return true;
+}
+
+GLboolean GLVolumeCache::open(GLStackLoader* _loader, GLVolumePyramid* _pyramid, GLSliceHistograms* _histograms, GLVolumeStats* _stats)
+{
+	close();
+
+	GLint fd = ::open(path, O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat file_info;
+	if(fstat(fd, &file_info) != 0 || (size_t) file_info.st_size < sizeof(GLVolumeCacheHeader))
+	{
+		::close(fd);
+		return false;
+	}
+
+	size_t file_size = (size_t) file_info.st_size;
+	GLvoid* file_map = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(file_map == MAP_FAILED)
+		return false;
+
+	const GLVolumeCacheHeader* header = (const GLVolumeCacheHeader*) file_map;
+	GLint no_slices = _loader->getNoSlices();
+	size_t slice_size = (size_t) _loader->getWidth() * _loader->getHeight();
+
+	GLboolean valid = memcmp(header->magic, CACHE_MAGIC, 8) == 0
+			&& header->version == CACHE_VERSION
+			&& header->file_size == file_size
+			&& (GLint) header->width == _loader->getWidth()
+			&& (GLint) header->height == _loader->getHeight()
+			&& header->bits_per_sample == 16
+			&& (GLint) header->no_slices == no_slices
+			&& header->raw_offset + slice_size * no_slices * sizeof(GLushort) <= file_size
+			&& (GLint) header->pyramid_levels == _pyramid->getNoLevels()
+			&& header->pyramid_offset + pyramidSize(_pyramid, no_slices) <= file_size
+			&& header->histogram_offset + (uint64_t) HISTOGRAM_BINS * no_slices * sizeof(GLuint) <= file_size
+			&& header->stats_offset + _stats->getTilesPerSlice() * no_slices * sizeof(GLVoxelStats) <= file_size;
+
+	// any touched, replaced or resized source TIFF or correction map invalidates the whole cache
+	GLint no_sources = getNoSources(_loader);
+	valid = valid && (GLint) header->no_corrections == no_sources - no_slices;
+	if(valid)
+	{
+		GLVolumeCacheSource* sources = new GLVolumeCacheSource[no_sources];
+		valid = readSources(_loader, sources)
+				&& sizeof(GLVolumeCacheHeader) + no_sources * sizeof(GLVolumeCacheSource) <= header->raw_offset
+				&& memcmp(sources, header + 1, no_sources * sizeof(GLVolumeCacheSource)) == 0;
+		delete[] sources;
+	}
+
+	if(!valid)
+	{
+		std::cout << "info: " << path << " is out of date" << std::endl;
+		munmap(file_map, file_size);
+		return false;
+	}
+
+	madvise(file_map, file_size, MADV_WILLNEED);
+
+	map = file_map;
+	map_length = file_size;
+	slices = new GLushort*[no_slices];
+	for(GLint t=0; t<no_slices; t++)
+		slices[t] = (GLushort*) ((GLubyte*) map + header->raw_offset) + t * slice_size;
+
+	_pyramid->reserve(no_slices);
+	const GLuint* level_sums = (const GLuint*) ((GLubyte*) map + header->pyramid_offset);
+	for(GLint l=1; l<_pyramid->getNoLevels(); l++)
+	{
+		_pyramid->loadLevel(l, level_sums, no_slices);
+		level_sums += _pyramid->getLevelSize(l) * no_slices;
+	}
+
+	_histograms->reserve(no_slices);
+	_histograms->loadSlices((const GLuint*) ((GLubyte*) map + header->histogram_offset), no_slices);
+
+	_stats->reserve(no_slices);
+	_stats->loadSlices((const GLVoxelStats*) ((GLubyte*) map + header->stats_offset), no_slices);
+
+	std::cout << "info: using " << path << std::endl;
+	return true;
+}
+
+GLboolean GLVolumeCache::write(GLStackLoader* _loader, GLSliceProvider* _slices, GLushort _raw_max, GLVolumePyramid* _pyramid,
+							   GLSliceHistograms* _histograms, GLVolumeStats* _stats)
+{
+	// packed slices saturate at 4095, the raw max, pyramid, histograms and stats are of the full counts
+	if(_slices->isPacked())
+	{
+		std::cout << "info: " << path << " is not written from 12Bit packed slices" << std::endl;
+		return false;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	GLint no_slices = _loader->getNoSlices();
+	size_t slice_size = (size_t) _loader->getWidth() * _loader->getHeight();
+
+	GLVolumeCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, 8);
+	header.version = CACHE_VERSION;
+	header.width = _loader->getWidth();
+	header.height = _loader->getHeight();
+	header.bits_per_sample = 16;
+	header.no_slices = no_slices;
+	header.pyramid_levels = _pyramid->getNoLevels();
+	header.raw_max = _raw_max;
+	GLint no_sources = getNoSources(_loader);
+	header.no_corrections = no_sources - no_slices;
+	header.raw_offset = alignOffset(sizeof(header) + no_sources * sizeof(GLVolumeCacheSource));
+	header.pyramid_offset = alignOffset(header.raw_offset + slice_size * no_slices * sizeof(GLushort));
+	header.histogram_offset = alignOffset(header.pyramid_offset + pyramidSize(_pyramid, no_slices));
+	header.stats_offset = alignOffset(header.histogram_offset + (uint64_t) HISTOGRAM_BINS * no_slices * sizeof(GLuint));
+	header.file_size = header.stats_offset + _stats->getTilesPerSlice() * no_slices * sizeof(GLVoxelStats);
+
+	GLVolumeCacheSource* sources = new GLVolumeCacheSource[no_sources];
+	if(!readSources(_loader, sources))
+	{
+		delete[] sources;
+		return false;
+	}
+
+	// write next to the final file and rename, a crash never leaves a half written cache behind
+	GLchar temp_path[268];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+	FILE* file = fopen(temp_path, "wb");
+	if(!file)
+	{
+		delete[] sources;
+		return false;
+	}
+
+	GLboolean complete = fwrite(&header, sizeof(header), 1, file) == 1
+			&& fwrite(sources, sizeof(GLVolumeCacheSource), no_sources, file) == (size_t) no_sources;
+	delete[] sources;
+
+	complete = complete && fseek(file, (long) header.raw_offset, SEEK_SET) == 0;
+	for(GLint t=0; complete && t<no_slices; t++)
+	{
+		complete = fwrite(_slices->acquireSlice(t).pixels, sizeof(GLushort), slice_size, file) == slice_size;
+		_slices->releaseSlice(t);
+	}
+
+	complete = complete && fseek(file, (long) header.pyramid_offset, SEEK_SET) == 0;
+	for(GLint l=1; complete && l<_pyramid->getNoLevels(); l++)
+	{
+		size_t level_size = _pyramid->getLevelSize(l) * no_slices;
+		complete = fwrite(_pyramid->getSums(l, 0), sizeof(GLuint), level_size, file) == level_size;
+	}
+
+	size_t histogram_size = (size_t) HISTOGRAM_BINS * no_slices;
+	complete = complete && fseek(file, (long) header.histogram_offset, SEEK_SET) == 0
+			&& fwrite(_histograms->getSlice(0), sizeof(GLuint), histogram_size, file) == histogram_size;
+
+	size_t stats_size = _stats->getTilesPerSlice() * no_slices;
+	complete = complete && fseek(file, (long) header.stats_offset, SEEK_SET) == 0
+			&& fwrite(_stats->getTiles(0), sizeof(GLVoxelStats), stats_size, file) == stats_size;
+
+	complete = fclose(file) == 0 && complete;
+	if(!complete || rename(temp_path, path) != 0)
+	{
+		std::cout << "error: could not write " << path << std::endl;
+		unlink(temp_path);
+		return false;
+	}
+
+	GLdouble time = std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "info: wrote " << path << " in " << time << " ms" << std::endl;
+	return true;
+}
+
+GLvoid GLVolumeCache::close()
+{
+	if(map)
+		munmap(map, map_length);
+
+	delete[] slices;
+	map = NULL;
+	map_length = 0;
+	slices = NULL;
+}
+
+GLboolean GLVolumeCache::isOpen()
+{
+	return map != NULL;
+}
+
+GLushort** GLVolumeCache::getSlices()
+{
+	return slices;
+}
+
+GLushort GLVolumeCache::getRawMax()
+{
+	return (GLushort) ((const GLVolumeCacheHeader*) map)->raw_max;
+}
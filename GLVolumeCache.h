@@ -0,0 +1,90 @@
+#ifndef GLVOLUMECACHE_H
+#define GLVOLUMECACHE_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "GLStackLoader.h"
+#include "GLSliceProvider.h"
+#include "GLVolumePyramid.h"
+#include "GLHistogram.h"
+#include "GLVolumeStats.h"
+
+/**
+ * Single file cache of a loaded and reduced data stack (<path_root><filename_root>.cache).
+ *
+ * layout:  header | per slice and correction map source record | raw 16Bit volume | pyramid sums level 1, 2, ...
+ *          | per slice histograms | stats index tiles
+ *
+ * The sections start on page boundaries, the raw volume is used in place from a read only
+ * mapping, pyramid, histograms and stats are copied into the objects passed to open().
+ * The cache is only accepted if role, canonical path, size and mtime of every source TIFF still
+ * match, the slices of a stack loaded with a GLSliceCorrection are stored corrected and its maps
+ * are sources too, so swapped or moved flat and dark maps are told apart.
+ * Only full 16Bit slices are cached, write() refuses a 12Bit packed GLSliceProvider.
+ */
+
+struct GLVolumeCacheHeader
+{
+	GLchar magic[8];
+	GLuint version;
+	GLuint width;
+	GLuint height;
+	GLuint bits_per_sample;
+	GLuint no_slices;
+	GLuint pyramid_levels;		// including level 0, which is the raw volume
+	GLuint no_corrections;		// correction map sources after the slice sources
+	GLuint raw_max;				// normalization max of the raw volume
+	uint64_t raw_offset;
+	uint64_t pyramid_offset;
+	uint64_t histogram_offset;
+	uint64_t stats_offset;
+	uint64_t file_size;
+};
+
+enum GLVolumeCacheRole
+{
+	CACHE_SOURCE_SLICE,
+	CACHE_SOURCE_FLAT,
+	CACHE_SOURCE_DARK
+};
+
+// zero padded, so records compare with memcmp
+struct GLVolumeCacheSource
+{
+	int64_t size;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	GLuint role;			// GLVolumeCacheRole
+	GLuint reserved;
+	GLchar path[256];		// realpath() of the file
+};
+
+class GLVolumeCache
+{
+	public:
+		GLVolumeCache(const GLchar* _path_root, const GLchar* _filename_root);
+		~GLVolumeCache();
+
+		// maps the cache if it matches the stack found by _loader->probe(), _pyramid, _histograms and _stats are filled from it
+		GLboolean open(GLStackLoader* _loader, GLVolumePyramid* _pyramid, GLSliceHistograms* _histograms, GLVolumeStats* _stats);
+		GLboolean write(GLStackLoader* _loader, GLSliceProvider* _slices, GLushort _raw_max, GLVolumePyramid* _pyramid,
+						GLSliceHistograms* _histograms, GLVolumeStats* _stats);
+		GLvoid close();
+
+		GLboolean isOpen();
+		GLushort** getSlices();
+		GLushort getRawMax();
+
+	private:
+		GLchar path[256];
+
+		GLvoid* map;
+		size_t map_length;
+		GLushort** slices;
+
+		GLint getNoSources(GLStackLoader* _loader);
+		GLboolean readSources(GLStackLoader* _loader, GLVolumeCacheSource* _sources);
+};
+
+#endif
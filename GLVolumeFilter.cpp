@@ -0,0 +1,243 @@
+#include "GLVolumeFilter.h"
+#include <string.h>
+#include <math.h>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_X86
+#endif
+
+
+/*
+ * _out[i] = sum_k _weights[k] * _lines[k][i], accumulated in k order,
+ * the AVX2 kernel does the same multiply and add per lane
+ */
+
+static GLvoid sumScalar(const GLfloat* const* _lines, const GLfloat* _weights, GLint _taps, size_t _first, size_t _count, GLfloat* _out)
+{
+	for(size_t i=_first; i<_count; i++)
+	{
+		GLfloat acc = 0.0f;
+		for(GLint k=0; k<_taps; k++)
+			acc = acc + _weights[k] * _lines[k][i];
+		_out[i] = acc;
+	}
+}
+
+// rounded and clamped to 0..65535
+static GLvoid storeScalar(const GLfloat* _src, size_t _first, size_t _count, GLushort* _dst)
+{
+	for(size_t i=_first; i<_count; i++)
+	{
+		GLfloat v = _src[i] + 0.5f;
+		v = v > 0.0f ? v : 0.0f;
+		v = v < 65535.0f ? v : 65535.0f;
+		_dst[i] = (GLushort) v;
+	}
+}
+
+#ifdef FILTER_X86
+__attribute__((target("avx2")))
+static GLvoid sumAVX2(const GLfloat* const* _lines, const GLfloat* _weights, GLint _taps, size_t _count, GLfloat* _out)
+{
+	size_t i = 0;
+	for(; i+8<=_count; i+=8)
+	{
+		__m256 acc = _mm256_setzero_ps();
+		for(GLint k=0; k<_taps; k++)
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(_weights[k]), _mm256_loadu_ps(_lines[k] + i)));
+		_mm256_storeu_ps(_out + i, acc);
+	}
+	sumScalar(_lines, _weights, _taps, i, _count, _out);
+}
+
+__attribute__((target("avx2")))
+static GLvoid storeAVX2(const GLfloat* _src, size_t _count, GLushort* _dst)
+{
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 top = _mm256_set1_ps(65535.0f);
+	size_t i = 0;
+	for(; i+16<=_count; i+=16)
+	{
+		__m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_loadu_ps(_src + i), half), zero), top);
+		__m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_loadu_ps(_src + i + 8), half), zero), top);
+		// packus works per 128Bit lane, the permute puts the 16 results back in order
+		__m256i packed = _mm256_packus_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+		_mm256_storeu_si256((__m256i*) (_dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+	}
+	storeScalar(_src, i, _count, _dst);
+}
+#endif
+
+
+GLVolumeFilter::GLVolumeFilter(GLint _width, GLint _height)
+{
+	width = _width;
+	height = _height;
+	capacity = 0;
+	planes = NULL;
+	slices = NULL;
+	setKernel(NULL);
+	setFilter(FILTER_NONE, 0);
+}
+
+GLVolumeFilter::~GLVolumeFilter()
+{
+	delete[] planes;
+	delete[] slices;
+}
+
+size_t GLVolumeFilter::getSize(GLint _width, GLint _height, GLint _no_slices)
+{
+	return (size_t) _width * _height * _no_slices * (sizeof(GLfloat) + sizeof(GLushort));
+}
+
+GLboolean GLVolumeFilter::reserve(GLint _capacity)
+{
+	if(_capacity <= capacity)
+		return true;
+
+	size_t slice_size = (size_t) width * height;
+	GLfloat* new_planes = new (std::nothrow) GLfloat[slice_size * _capacity];
+	GLushort* new_slices = new (std::nothrow) GLushort[slice_size * _capacity];
+	if(!new_planes || !new_slices)
+	{
+		delete[] new_planes;
+		delete[] new_slices;
+		return false;
+	}
+
+	if(capacity > 0)
+	{
+		memcpy(new_planes, planes, slice_size * capacity * sizeof(GLfloat));
+		memcpy(new_slices, slices, slice_size * capacity * sizeof(GLushort));
+	}
+
+	delete[] planes;
+	delete[] slices;
+	planes = new_planes;
+	slices = new_slices;
+	capacity = _capacity;
+	return true;
+}
+
+GLboolean GLVolumeFilter::setKernel(const GLchar* _name)
+{
+	return selectKernel(_name, &kernel);
+}
+
+GLvoid GLVolumeFilter::setFilter(GLFilterType _type, GLint _radius)
+{
+	type = _type;
+	radius = _type == FILTER_NONE || _radius < 0 ? 0 : _radius;
+	weights.assign(2 * radius + 1, 1.0f);
+
+	if(type == FILTER_GAUSSIAN && radius > 0)
+	{
+		GLfloat sigma = radius / 2.0f;
+		for(GLint k=-radius; k<=radius; k++)
+			weights[k + radius] = expf(-0.5f * k * k / (sigma * sigma));
+	}
+
+	GLfloat total = 0.0f;
+	for(size_t k=0; k<weights.size(); k++)
+		total += weights[k];
+	for(size_t k=0; k<weights.size(); k++)
+		weights[k] /= total;
+}
+
+GLFilterType GLVolumeFilter::getType()
+{
+	return type;
+}
+
+GLint GLVolumeFilter::getRadius()
+{
+	return radius;
+}
+
+GLvoid GLVolumeFilter::sum(const GLfloat* const* _lines, size_t _count, GLfloat* _out)
+{
+#ifdef FILTER_X86
+	if(kernel == KERNEL_AVX2)
+	{
+		sumAVX2(_lines, weights.data(), (GLint) weights.size(), _count, _out);
+		return;
+	}
+#endif
+	sumScalar(_lines, weights.data(), (GLint) weights.size(), 0, _count, _out);
+}
+
+GLvoid GLVolumeFilter::store(const GLfloat* _src, size_t _count, GLushort* _dst)
+{
+#ifdef FILTER_X86
+	if(kernel == KERNEL_AVX2)
+	{
+		storeAVX2(_src, _count, _dst);
+		return;
+	}
+#endif
+	storeScalar(_src, 0, _count, _dst);
+}
+
+GLvoid GLVolumeFilter::filterPlane(GLint _time_slice, const GLushort* _slice)
+{
+	GLint taps = 2 * radius + 1;
+	std::vector<GLfloat> padded(width + 2 * radius);
+	std::vector<GLfloat> rows((size_t) width * height);
+	std::vector<const GLfloat*> lines(taps);
+
+	// x pass: the row with its edge pixels repeated radius times, the taps are shifted views of it
+	for(GLint k=0; k<taps; k++)
+		lines[k] = padded.data() + k;
+	for(GLint y=0; y<height; y++)
+	{
+		const GLushort* row = _slice + (size_t) y * width;
+		for(GLint x=-radius; x<width+radius; x++)
+			padded[x + radius] = row[x < 0 ? 0 : x < width ? x : width - 1];
+		sum(lines.data(), width, rows.data() + (size_t) y * width);
+	}
+
+	// y pass: the taps are the clamped rows above and below
+	GLfloat* plane = planes + (size_t) _time_slice * width * height;
+	for(GLint y=0; y<height; y++)
+	{
+		for(GLint k=0; k<taps; k++)
+		{
+			GLint source = y + k - radius;
+			source = source < 0 ? 0 : source < height ? source : height - 1;
+			lines[k] = rows.data() + (size_t) source * width;
+		}
+		sum(lines.data(), width, plane + (size_t) y * width);
+	}
+}
+
+GLvoid GLVolumeFilter::filterDepth(GLint _first, GLint _end, GLint _no_slices, GLWorkerPool* _pool)
+{
+	size_t slice_size = (size_t) width * height;
+	_first = _first > 0 ? _first : 0;
+	_end = _end < _no_slices ? _end : _no_slices;
+
+	// t pass: the taps are the clamped planes before and after, whole planes at once
+	_pool->parallelFor(_first, _end, [&](GLint _t)
+	{
+		GLint taps = 2 * radius + 1;
+		std::vector<const GLfloat*> lines(taps);
+		std::vector<GLfloat> plane(slice_size);
+		for(GLint k=0; k<taps; k++)
+		{
+			GLint source = _t + k - radius;
+			source = source < 0 ? 0 : source < _no_slices ? source : _no_slices - 1;
+			lines[k] = planes + (size_t) source * slice_size;
+		}
+		sum(lines.data(), slice_size, plane.data());
+		store(plane.data(), slice_size, slices + (size_t) _t * slice_size);
+	});
+}
+
+const GLushort* GLVolumeFilter::getSlice(GLint _time_slice)
+{
+	return slices + (size_t) _time_slice * width * height;
+}
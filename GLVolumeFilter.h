@@ -0,0 +1,65 @@
+#ifndef GLVOLUMEFILTER_H
+#define GLVOLUMEFILTER_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <vector>
+#include "GLWorkerPool.h"
+#include "GLKernel.h"
+
+enum GLFilterType
+{
+	FILTER_NONE,
+	FILTER_BOX,
+	FILTER_GAUSSIAN
+};
+
+/**
+ * Separable 3D smoothing of the raw stack (box or Gaussian, 2 * radius + 1 taps per axis,
+ * sigma = radius / 2), the edges are clamped. Sits between the load stage and the pyramid:
+ * filterPlane() runs the x and y passes of one raw slice into a float plane (any order,
+ * concurrently for different slices), filterDepth() the t pass over the planes into 16Bit
+ * slices, which are then reduced like raw ones.
+ *
+ * All three passes are the same weighted sum of 2 * radius + 1 shifted lines, which the
+ * AVX2 kernel does 8 floats at a time. An appended slice t needs filterPlane(t) and filterDepth()
+ * of t - radius .. t, a new radius or type needs all planes again, from the raw slices in memory.
+ */
+class GLVolumeFilter
+{
+	public:
+		GLVolumeFilter(GLint _width, GLint _height);
+		~GLVolumeFilter();
+
+		// grows to _capacity slices, false if the memory is not available
+		GLboolean reserve(GLint _capacity);
+		static size_t getSize(GLint _width, GLint _height, GLint _no_slices);	// bytes
+
+		// selectKernel()
+		GLboolean setKernel(const GLchar* _name);
+		GLvoid setFilter(GLFilterType _type, GLint _radius);
+		GLFilterType getType();
+		GLint getRadius();
+
+		GLvoid filterPlane(GLint _time_slice, const GLushort* _slice);
+		// t pass of the slices [_first, _end) of a stack of _no_slices, the slices are spread over the pool
+		GLvoid filterDepth(GLint _first, GLint _end, GLint _no_slices, GLWorkerPool* _pool);
+		const GLushort* getSlice(GLint _time_slice);
+
+	private:
+		GLint width;
+		GLint height;
+		GLint capacity;
+		GLint kernel;		// GLKernel
+		GLFilterType type;
+		GLint radius;
+		std::vector<GLfloat> weights;
+
+		GLfloat* planes;
+		GLushort* slices;
+
+		GLvoid sum(const GLfloat* const* _lines, size_t _count, GLfloat* _out);
+		GLvoid store(const GLfloat* _src, size_t _count, GLushort* _dst);
+};
+
+#endif
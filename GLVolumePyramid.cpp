@@ -0,0 +1,281 @@
+#include "GLVolumePyramid.h"
+#include "GLNormalize.h"
+#include <string.h>
+
+// a GLuint holds the sum of 4^7 16Bit counts without overflow, and below 2^31 as rescale32to8() needs
+#define PYRAMID_MAX_LEVELS 8
+
+
+static GLvoid atomicMax(std::atomic<GLuint>& _max, GLuint _value)
+{
+	GLuint current = _max.load();
+	while(current < _value && !_max.compare_exchange_weak(current, _value))
+		;
+}
+
+// bins one or two source rows into one row of the next level, returns the row max
+template <typename T>
+static GLuint binRow(const T* _src, GLint _src_width, GLint _src_rows, GLuint* _dst)
+{
+	const T* row0 = _src;
+	const T* row1 = _src + _src_width;
+	GLint pairs = _src_width / 2;
+	GLuint row_max = 0;
+	GLuint sum;
+
+	if(_src_rows == 2)
+	{
+		for(GLint x=0; x<pairs; x++)
+		{
+			sum = (GLuint) row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1];
+			_dst[x] = sum;
+			row_max = sum > row_max ? sum : row_max;
+		}
+		if(_src_width & 1)
+		{
+			sum = (GLuint) row0[_src_width - 1] + row1[_src_width - 1];
+			_dst[pairs] = sum;
+			row_max = sum > row_max ? sum : row_max;
+		}
+	}
+	else
+	{
+		for(GLint x=0; x<pairs; x++)
+		{
+			sum = (GLuint) row0[2 * x] + row0[2 * x + 1];
+			_dst[x] = sum;
+			row_max = sum > row_max ? sum : row_max;
+		}
+		if(_src_width & 1)
+		{
+			sum = (GLuint) row0[_src_width - 1];
+			_dst[pairs] = sum;
+			row_max = sum > row_max ? sum : row_max;
+		}
+	}
+	return row_max;
+}
+
+
+GLVolumePyramid::GLVolumePyramid(GLint _width, GLint _height, GLint _min_size)
+{
+	no_levels = 1;
+	for(GLint w=_width, h=_height; (w > _min_size || h > _min_size) && no_levels < PYRAMID_MAX_LEVELS; no_levels++)
+	{
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+
+	capacity = 0;
+	widths = new GLint[no_levels];
+	heights = new GLint[no_levels];
+	sums = new GLuint*[no_levels];
+	normalized = new GLubyte*[no_levels];
+	normalized_max = new GLuint*[no_levels];
+	max = new std::atomic<GLuint>[no_levels];
+
+	for(GLint l=0; l<no_levels; l++)
+	{
+		widths[l] = l == 0 ? _width : (widths[l - 1] + 1) / 2;
+		heights[l] = l == 0 ? _height : (heights[l - 1] + 1) / 2;
+		sums[l] = NULL;
+		normalized[l] = NULL;
+		normalized_max[l] = NULL;
+		max[l] = 1;		// >= 1 because of the division
+	}
+}
+
+GLVolumePyramid::~GLVolumePyramid()
+{
+	for(GLint l=0; l<no_levels; l++)
+	{
+		delete[] sums[l];
+		delete[] normalized[l];
+		delete[] normalized_max[l];
+	}
+	delete[] widths;
+	delete[] heights;
+	delete[] sums;
+	delete[] normalized;
+	delete[] normalized_max;
+	delete[] max;
+}
+
+GLvoid GLVolumePyramid::reserve(GLint _capacity)
+{
+	if(_capacity <= capacity)
+		return;
+
+	for(GLint l=1; l<no_levels; l++)
+	{
+		size_t size = getLevelSize(l);
+		GLuint* new_sums = new GLuint[size * _capacity];
+		GLubyte* new_normalized = new GLubyte[size * _capacity];
+		GLuint* new_normalized_max = new GLuint[_capacity];
+
+		memset(new_sums, 0, size * _capacity * sizeof(GLuint));
+		memset(new_normalized, 0, size * _capacity);
+		memset(new_normalized_max, 0, _capacity * sizeof(GLuint));
+		if(capacity > 0)
+		{
+			memcpy(new_sums, sums[l], size * capacity * sizeof(GLuint));
+			memcpy(new_normalized, normalized[l], size * capacity);
+			memcpy(new_normalized_max, normalized_max[l], capacity * sizeof(GLuint));
+		}
+
+		delete[] sums[l];
+		delete[] normalized[l];
+		delete[] normalized_max[l];
+		sums[l] = new_sums;
+		normalized[l] = new_normalized;
+		normalized_max[l] = new_normalized_max;
+	}
+	capacity = _capacity;
+}
+
+GLushort GLVolumePyramid::reduceSlice(const GLushort* _slice, GLint _time_slice, GLWorkerPool* _pool)
+{
+	if(no_levels < 2)
+		return 1;
+
+	GLint no_blocks = heights[no_levels - 1];
+	if(!_pool || _pool->size() < 2)
+		return reduceBlocks(_slice, _time_slice, 0, no_blocks);
+
+	// the block maxima are combined like the slice maxima
+	std::atomic<GLuint> raw_max(1);
+	_pool->parallelFor(0, no_blocks, [&](GLint _block)
+	{
+		atomicMax(raw_max, reduceBlocks(_slice, _time_slice, _block, _block + 1));
+	});
+	return (GLushort) raw_max.load();
+}
+
+// every block covers 2^(no_levels - 1 - l) rows of level l, so it never needs a row of another block
+GLushort GLVolumePyramid::reduceBlocks(const GLushort* _slice, GLint _time_slice, GLint _first_block, GLint _end_block)
+{
+	GLushort raw_max = 1;	// >= 1 because of the division
+	GLuint slice_max[PYRAMID_MAX_LEVELS] = {0};
+	GLuint row_max;
+
+	GLint block_rows = 1 << (no_levels - 2);	// of level 1
+	GLint end_row = _end_block * block_rows < heights[1] ? _end_block * block_rows : heights[1];
+
+	// every row of level l is binned into level l+1 as soon as its partner row exists,
+	// so the coarser levels are built while the finer rows are still in the cache
+	for(GLint y1=_first_block * block_rows; y1<end_row; y1++)
+	{
+		GLint rows = heights[0] - 2 * y1 < 2 ? 1 : 2;
+		const GLushort* raw_rows = _slice + (size_t) 2 * y1 * widths[0];
+
+		GLushort raw_rows_max = maxCount16(raw_rows, (size_t) rows * widths[0]);
+		raw_max = raw_rows_max > raw_max ? raw_rows_max : raw_max;
+
+		row_max = binRow(raw_rows, widths[0], rows, getSums(1, _time_slice) + (size_t) y1 * widths[1]);
+		slice_max[1] = row_max > slice_max[1] ? row_max : slice_max[1];
+
+		for(GLint l=1, y=y1; l + 1 < no_levels && (y % 2 == 1 || y == heights[l] - 1); l++, y/=2)
+		{
+			GLint y_next = y / 2;
+			rows = heights[l] - 2 * y_next < 2 ? 1 : 2;
+			row_max = binRow(getSums(l, _time_slice) + (size_t) 2 * y_next * widths[l], widths[l], rows,
+							 getSums(l + 1, _time_slice) + (size_t) y_next * widths[l + 1]);
+			slice_max[l + 1] = row_max > slice_max[l + 1] ? row_max : slice_max[l + 1];
+		}
+	}
+
+	for(GLint l=1; l<no_levels; l++)
+		atomicMax(max[l], slice_max[l]);
+
+	return raw_max;
+}
+
+GLvoid GLVolumePyramid::loadLevel(GLint _level, const GLuint* _sums, GLint _no_slices)
+{
+	size_t count = getLevelSize(_level) * _no_slices;
+	GLuint level_max = 0;
+
+	memcpy(sums[_level], _sums, count * sizeof(GLuint));
+	for(size_t i=0; i<count; i++)
+		level_max = _sums[i] > level_max ? _sums[i] : level_max;
+
+	atomicMax(max[_level], level_max);
+}
+
+GLvoid GLVolumePyramid::normalizeSlice(GLint _level, GLint _time_slice, GLuint _max_count_rate)
+{
+	size_t size = getLevelSize(_level);
+
+	// downsample to 8Bit
+	rescale32to8(getSums(_level, _time_slice), normalized[_level] + _time_slice * size, size, rescaleFactor8(_max_count_rate));
+
+	normalized_max[_level][_time_slice] = _max_count_rate;
+}
+
+GLvoid GLVolumePyramid::rescanMax(GLint _no_slices)
+{
+	for(GLint l=1; l<no_levels; l++)
+	{
+		size_t count = getLevelSize(l) * _no_slices;
+		GLuint level_max = 1;
+		for(size_t i=0; i<count; i++)
+			level_max = sums[l][i] > level_max ? sums[l][i] : level_max;
+		max[l] = level_max;
+	}
+}
+
+GLvoid GLVolumePyramid::invalidateSlice(GLint _time_slice)
+{
+	for(GLint l=1; l<no_levels; l++)
+		normalized_max[l][_time_slice] = 0;
+}
+
+GLint GLVolumePyramid::selectLevel(GLfloat _screen_pixels)
+{
+	for(GLint l=no_levels-1; l>1; l--)
+	{
+		if((widths[l] > heights[l] ? widths[l] : heights[l]) >= _screen_pixels)
+			return l;
+	}
+	return no_levels > 1 ? 1 : 0;
+}
+
+GLint GLVolumePyramid::getNoLevels()
+{
+	return no_levels;
+}
+
+GLint GLVolumePyramid::getWidth(GLint _level)
+{
+	return widths[_level];
+}
+
+GLint GLVolumePyramid::getHeight(GLint _level)
+{
+	return heights[_level];
+}
+
+size_t GLVolumePyramid::getLevelSize(GLint _level)
+{
+	return (size_t) widths[_level] * heights[_level];
+}
+
+GLuint* GLVolumePyramid::getSums(GLint _level, GLint _time_slice)
+{
+	return sums[_level] + _time_slice * getLevelSize(_level);
+}
+
+GLubyte* GLVolumePyramid::getNormalized(GLint _level)
+{
+	return normalized[_level];
+}
+
+GLuint GLVolumePyramid::getMax(GLint _level)
+{
+	return max[_level].load();
+}
+
+GLuint GLVolumePyramid::getNormalizedMax(GLint _level, GLint _time_slice)
+{
+	return normalized_max[_level][_time_slice];
+}
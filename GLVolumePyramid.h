@@ -0,0 +1,67 @@
+#ifndef GLVOLUMEPYRAMID_H
+#define GLVOLUMEPYRAMID_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <atomic>
+#include "GLWorkerPool.h"
+
+/**
+ * Mip pyramid of the raw slices, level l bins 2^l x 2^l raw pixels
+ * (512 -> 256 -> 128 -> 64 ...). Level 0 is the raw slice itself and is not stored.
+ *
+ * Per level and slice the binned counts (sums, GLuint) and an 8Bit copy normalized
+ * to the max of that level are kept. Odd sizes round up, the last row/column of a
+ * level then bins fewer pixels. The energy axis is not reduced.
+ *
+ * reduceSlice() and normalizeSlice() may run concurrently for different slices,
+ * reserve() must not run concurrently with anything else. A single slice is split
+ * into row blocks, one row of the coarsest level each, which reduce independently.
+ */
+class GLVolumePyramid
+{
+	public:
+		// levels are added until both sides are <= _min_size
+		GLVolumePyramid(GLint _width, GLint _height, GLint _min_size = 16);
+		~GLVolumePyramid();
+
+		// grows all levels to _capacity slices, new slices are 0
+		GLvoid reserve(GLint _capacity);
+
+		// bins all levels of one slice in a single pass over the raw slice, returns its max count rate (>= 1),
+		// with a _pool the row blocks are spread over it
+		GLushort reduceSlice(const GLushort* _slice, GLint _time_slice, GLWorkerPool* _pool = NULL);
+		// copies the sums of _no_slices slices of one level, e.g. from a GLVolumeCache
+		GLvoid loadLevel(GLint _level, const GLuint* _sums, GLint _no_slices);
+		GLvoid normalizeSlice(GLint _level, GLint _time_slice, GLuint _max_count_rate);
+		// after slices were reduced again from other data: the max of every level over the first
+		// _no_slices slices from scratch, and a slice whose 8Bit copies are all out of date
+		GLvoid rescanMax(GLint _no_slices);
+		GLvoid invalidateSlice(GLint _time_slice);
+
+		// coarsest level that still has _screen_pixels voxels along its longer side
+		GLint selectLevel(GLfloat _screen_pixels);
+
+		GLint getNoLevels();		// including level 0
+		GLint getWidth(GLint _level);
+		GLint getHeight(GLint _level);
+		size_t getLevelSize(GLint _level);	// voxels per slice
+		GLuint* getSums(GLint _level, GLint _time_slice);
+		GLubyte* getNormalized(GLint _level);	// all slices, _time_slice * getLevelSize() + y * getWidth() + x
+		GLuint getMax(GLint _level);			// over all slices reduced so far, >= 1
+		GLuint getNormalizedMax(GLint _level, GLint _time_slice);	// max the 8Bit slice was normalized with, 0 if never
+
+	private:
+		GLint no_levels;
+		GLint capacity;
+		GLint* widths;
+		GLint* heights;
+		GLuint** sums;
+		GLubyte** normalized;
+		GLuint** normalized_max;
+		std::atomic<GLuint>* max;
+
+		GLushort reduceBlocks(const GLushort* _slice, GLint _time_slice, GLint _first_block, GLint _end_block);
+};
+
+#endif
@@ -0,0 +1,274 @@
+#define GL_GLEXT_PROTOTYPES
+#include "GLVolumeRenderer.h"
+#include <GL/glext.h>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+// rays are cut off after this many voxels, more than the diagonal of any volume that fits the texture limits
+#define VOLUME_MAX_STEPS 4096
+
+
+static const GLchar* vertex_source =
+	"#version 120\n"
+	"varying vec3 entry;\n"
+	"varying vec3 direction;\n"
+	"void main()\n"
+	"{\n"
+	"	entry = gl_Vertex.xyz;\n"
+	"	direction = (gl_ModelViewMatrixInverse * vec4(0.0, 0.0, -1.0, 0.0)).xyz;\n"
+	"	gl_Position = ftransform();\n"
+	"}\n";
+
+// front to back with premultiplied colors, the ray leaves the unit cube after 'steps' voxels
+static const GLchar* fragment_source =
+	"#version 120\n"
+	"uniform sampler3D volume;\n"
+	"uniform sampler1D transfer;\n"
+	"uniform vec3 size;\n"
+	"uniform int max_steps;\n"
+	"varying vec3 entry;\n"
+	"varying vec3 direction;\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 delta = direction / length(direction * size);\n"
+	"	float steps = float(max_steps);\n"
+	"	for(int a=0; a<3; a++)\n"
+	"	{\n"
+	"		if(delta[a] > 1e-7)\n"
+	"			steps = min(steps, (1.0 - entry[a]) / delta[a]);\n"
+	"		else if(delta[a] < -1e-7)\n"
+	"			steps = min(steps, -entry[a] / delta[a]);\n"
+	"	}\n"
+	"	vec3 position = entry + 0.5 * delta;\n"
+	"	vec4 color = vec4(0.0);\n"
+	"	for(int i=0; i<max_steps; i++)\n"
+	"	{\n"
+	"		if(float(i) >= steps || color.a > 0.99)\n"
+	"			break;\n"
+	"		float value = texture3D(volume, position).r;\n"
+	"		vec4 voxel = texture1D(transfer, value * (255.0 / 256.0) + 0.5 / 256.0);\n"
+	"		color += (1.0 - color.a) * vec4(voxel.rgb * voxel.a, voxel.a);\n"
+	"		position += delta;\n"
+	"	}\n"
+	"	gl_FragColor = color;\n"
+	"}\n";
+
+// the six faces of the unit cube, counter clockwise from outside
+static const GLfloat cube_faces[6][4][3] =
+{
+	{{0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}},
+	{{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}},
+	{{0, 0, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 0}},
+	{{1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}},
+	{{0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1}},
+	{{0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {1, 1, 0}}
+};
+
+
+GLVolumeRenderer::GLVolumeRenderer()
+{
+	supported = -1;
+	program = 0;
+	volume = 0;
+	transfer = 0;
+	size[0] = size[1] = size[2] = 0;
+	palette = NULL;
+	alpha = 0;
+	transfer_valid = false;
+}
+
+GLVolumeRenderer::~GLVolumeRenderer()
+{
+	if(volume)
+		glDeleteTextures(1, &volume);
+	if(transfer)
+		glDeleteTextures(1, &transfer);
+	if(program)
+		glDeleteProgram(program);
+}
+
+GLboolean GLVolumeRenderer::isSupported()
+{
+	if(supported >= 0)
+		return supported;
+
+	// GLSL 1.20 came with GL 2.1
+	GLint major = 1;
+	GLint minor = 0;
+	const GLchar* version = (const GLchar*) glGetString(GL_VERSION);
+	supported = version && sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 2 || (major == 2 && minor >= 1));
+	if(!supported)
+	{
+		std::cout << "error: the volume view needs OpenGL 2.1, this is " << (version ? version : "unknown") << std::endl;
+		return false;
+	}
+
+	supported = buildProgram();
+	return supported;
+}
+
+GLuint GLVolumeRenderer::compileShader(GLenum _type, const GLchar* _source)
+{
+	GLuint shader = glCreateShader(_type);
+	glShaderSource(shader, 1, &_source, NULL);
+	glCompileShader(shader);
+
+	GLint compiled = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if(!compiled)
+	{
+		GLchar log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cout << "error: volume shader: " << log << std::endl;
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+GLboolean GLVolumeRenderer::buildProgram()
+{
+	GLuint vertex_shader = compileShader(GL_VERTEX_SHADER, vertex_source);
+	GLuint fragment_shader = compileShader(GL_FRAGMENT_SHADER, fragment_source);
+	if(!vertex_shader || !fragment_shader)
+	{
+		glDeleteShader(vertex_shader);
+		glDeleteShader(fragment_shader);
+		return false;
+	}
+
+	program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+	glLinkProgram(program);
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	GLint linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if(!linked)
+	{
+		GLchar log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		std::cout << "error: volume shader: " << log << std::endl;
+		glDeleteProgram(program);
+		program = 0;
+		return false;
+	}
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "volume"), 0);
+	glUniform1i(glGetUniformLocation(program, "transfer"), 1);
+	glUniform1i(glGetUniformLocation(program, "max_steps"), VOLUME_MAX_STEPS);
+	glUseProgram(0);
+	return true;
+}
+
+GLboolean GLVolumeRenderer::isOutdated(const GLuint* _key, GLint _size)
+{
+	return key.isOutdated(_key, _size);
+}
+
+GLboolean GLVolumeRenderer::setVolume(const GLubyte* _volume, GLint _width, GLint _height, GLint _depth)
+{
+	GLint max_size = 0;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_size);
+	if(_width > max_size || _height > max_size || _depth > max_size)
+	{
+		std::cout << "error: the volume view takes at most " << max_size << " voxels per axis" << std::endl;
+		key.invalidate();
+		return false;
+	}
+
+	if(!volume)
+	{
+		glGenTextures(1, &volume);
+		glBindTexture(GL_TEXTURE_3D, volume);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+
+	// rows of the reduced levels are not 4 byte aligned
+	glBindTexture(GL_TEXTURE_3D, volume);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if(_width == size[0] && _height == size[1] && _depth == size[2])
+		glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, _width, _height, _depth, GL_LUMINANCE, GL_UNSIGNED_BYTE, _volume);
+	else
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_LUMINANCE8, _width, _height, _depth, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, _volume);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	size[0] = _width;
+	size[1] = _height;
+	size[2] = _depth;
+	return true;
+}
+
+GLvoid GLVolumeRenderer::setTransfer(const GLubyte* _palette, GLubyte _alpha)
+{
+	if(transfer_valid && _palette == palette && _alpha == alpha)
+		return;
+
+	palette = _palette;
+	alpha = _alpha;
+	GLubyte entries[256 * 4];
+	for(GLint i=0; i<256; i++)
+	{
+		entries[i * 4] = palette ? palette[i * 3] : i;
+		entries[i * 4 + 1] = palette ? palette[i * 3 + 1] : i;
+		entries[i * 4 + 2] = palette ? palette[i * 3 + 2] : i;
+		entries[i * 4 + 3] = (GLubyte) (i * alpha / 255);
+	}
+
+	if(!transfer)
+	{
+		glGenTextures(1, &transfer);
+		glBindTexture(GL_TEXTURE_1D, transfer);
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_1D, transfer);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, entries);
+	glBindTexture(GL_TEXTURE_1D, 0);
+	transfer_valid = true;
+}
+
+GLvoid GLVolumeRenderer::draw()
+{
+	if(!program || !volume || !transfer)
+		return;
+
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_POLYGON_BIT);
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glFrontFace(GL_CCW);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+	glUseProgram(program);
+	glUniform3f(glGetUniformLocation(program, "size"), size[0], size[1], size[2]);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_1D, transfer);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, volume);
+
+	glBegin(GL_QUADS);
+	for(GLint f=0; f<6; f++)
+	{
+		for(GLint v=0; v<4; v++)
+			glVertex3fv(cube_faces[f][v]);
+	}
+	glEnd();
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_1D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glUseProgram(0);
+	glPopAttrib();
+}
@@ -0,0 +1,54 @@
+#ifndef GLVOLUMERENDERER_H
+#define GLVOLUMERENDERER_H
+
+#include <GL/gl.h>
+#include <vector>
+#include "GLRetainedKey.h"
+
+/**
+ * Volume view of the reduced stack by raycasting in a fragment shader: the 8Bit volume is a
+ * 3D texture (one texel per voxel, all slices), the palette with the opacity per voxel a 1D
+ * texture. draw() rasterizes the front faces of the unit cube, every fragment marches its ray
+ * one voxel per step front to back and stops once it is opaque (early ray termination).
+ *
+ * Needs GLSL 1.20 (GL 2.1), which Mesa's software rasterizers provide, so it also runs
+ * headless. The projection has to be orthographic, all rays of a frame are parallel.
+ * The shader is compiled on the first isSupported(), which needs the GL context.
+ */
+class GLVolumeRenderer
+{
+	public:
+		GLVolumeRenderer();
+		~GLVolumeRenderer();
+
+		// false (with a message) if the GL has no 3D textures or shaders
+		GLboolean isSupported();
+
+		GLboolean isOutdated(const GLuint* _key, GLint _size);	// GLRetainedKey
+
+		// _volume[(t * _height + y) * _width + x], false if the texture is too large for the GL
+		GLboolean setVolume(const GLubyte* _volume, GLint _width, GLint _height, GLint _depth);
+
+		// 256 RGB entries, NULL for grey, the opacity of value i is i / 255 * _alpha / 255 per voxel
+		GLvoid setTransfer(const GLubyte* _palette, GLubyte _alpha);
+
+		// the unit cube of the current modelview matrix is the volume, x y t to texture s t r
+		GLvoid draw();
+
+	private:
+		GLRetainedKey key;
+		GLint supported;		// -1 until checked
+		GLuint program;
+		GLuint volume;
+		GLuint transfer;
+		GLint size[3];
+
+		const GLubyte* palette;
+		GLubyte alpha;
+		GLboolean transfer_valid;
+
+		GLuint compileShader(GLenum _type, const GLchar* _source);
+		GLboolean buildProgram();
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "GLVolumeStats.h"
+#include <string.h>
+#include <math.h>
+
+
+GLvoid GLVoxelStats::clear()
+{
+	sum = 0;
+	sum_squares = 0;
+	count = 0;
+	non_zero = 0;
+	min = 0xFFFF;
+	max = 0;
+}
+
+GLvoid GLVoxelStats::merge(const GLVoxelStats& _stats)
+{
+	sum += _stats.sum;
+	sum_squares += _stats.sum_squares;
+	count += _stats.count;
+	non_zero += _stats.non_zero;
+	min = _stats.min < min ? _stats.min : min;
+	max = _stats.max > max ? _stats.max : max;
+}
+
+GLdouble GLVoxelStats::mean() const
+{
+	return count > 0 ? (GLdouble) sum / count : 0.0;
+}
+
+GLdouble GLVoxelStats::standardDeviation() const
+{
+	if(count == 0)
+		return 0.0;
+
+	GLdouble m = mean();
+	GLdouble variance = (GLdouble) sum_squares / count - m * m;
+	return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+
+GLVolumeStats::GLVolumeStats(GLint _width, GLint _height, GLint _brick_size)
+{
+	width = _width;
+	height = _height;
+	brick_size = _brick_size;
+	bricks_x = (_width + _brick_size - 1) / _brick_size;
+	bricks_y = (_height + _brick_size - 1) / _brick_size;
+	capacity = 0;
+	slices = NULL;
+	tiles = NULL;
+}
+
+GLVolumeStats::~GLVolumeStats()
+{
+	delete[] slices;
+	delete[] tiles;
+}
+
+GLvoid GLVolumeStats::reserve(GLint _capacity)
+{
+	if(_capacity <= capacity)
+		return;
+
+	size_t tiles_per_slice = getTilesPerSlice();
+	GLVoxelStats* new_slices = new GLVoxelStats[_capacity];
+	GLVoxelStats* new_tiles = new GLVoxelStats[tiles_per_slice * _capacity];
+
+	for(GLint t=0; t<_capacity; t++)
+		new_slices[t].clear();
+	for(size_t i=0; i<tiles_per_slice * _capacity; i++)
+		new_tiles[i].clear();
+	if(capacity > 0)
+	{
+		memcpy(new_slices, slices, capacity * sizeof(GLVoxelStats));
+		memcpy(new_tiles, tiles, tiles_per_slice * capacity * sizeof(GLVoxelStats));
+	}
+
+	delete[] slices;
+	delete[] tiles;
+	slices = new_slices;
+	tiles = new_tiles;
+	capacity = _capacity;
+}
+
+GLvoid GLVolumeStats::addSlice(GLint _time_slice, const GLushort* _slice)
+{
+	GLVoxelStats* slice_tiles = tiles + _time_slice * getTilesPerSlice();
+
+	// one band of tiles at a time, its rows are read once, left to right
+	for(GLint by=0; by<bricks_y; by++)
+	{
+		GLVoxelStats* band = slice_tiles + by * bricks_x;
+		for(GLint bx=0; bx<bricks_x; bx++)
+			band[bx].clear();
+
+		GLint end_y = (by + 1) * brick_size < height ? (by + 1) * brick_size : height;
+		for(GLint y=by * brick_size; y<end_y; y++)
+		{
+			const GLushort* row = _slice + (size_t) y * width;
+			for(GLint bx=0; bx<bricks_x; bx++)
+			{
+				GLint end_x = (bx + 1) * brick_size < width ? (bx + 1) * brick_size : width;
+				GLuint sum = 0;
+				uint64_t sum_squares = 0;
+				GLuint non_zero = 0;
+				GLushort min = band[bx].min;
+				GLushort max = band[bx].max;
+				for(GLint x=bx * brick_size; x<end_x; x++)
+				{
+					GLuint value = row[x];
+					sum += value;
+					sum_squares += value * value;
+					non_zero += value != 0;
+					min = value < min ? value : min;
+					max = value > max ? value : max;
+				}
+				band[bx].sum += sum;
+				band[bx].sum_squares += sum_squares;
+				band[bx].count += end_x - bx * brick_size;
+				band[bx].non_zero += non_zero;
+				band[bx].min = min;
+				band[bx].max = max;
+			}
+		}
+	}
+
+	mergeTiles(_time_slice);
+}
+
+GLvoid GLVolumeStats::loadSlices(const GLVoxelStats* _tiles, GLint _no_slices)
+{
+	memcpy(tiles, _tiles, getTilesPerSlice() * _no_slices * sizeof(GLVoxelStats));
+	for(GLint t=0; t<_no_slices; t++)
+		mergeTiles(t);
+}
+
+GLvoid GLVolumeStats::mergeTiles(GLint _time_slice)
+{
+	const GLVoxelStats* slice_tiles = getTiles(_time_slice);
+	GLVoxelStats stats;
+	stats.clear();
+	for(size_t i=0; i<getTilesPerSlice(); i++)
+		stats.merge(slice_tiles[i]);
+	slices[_time_slice] = stats;
+}
+
+const GLVoxelStats& GLVolumeStats::getSlice(GLint _time_slice)
+{
+	return slices[_time_slice];
+}
+
+// bins that are whole groups of tiles are exact, the sums of smaller bins are taken as
+// _bin_size^2 voxels drawn from their tile without replacement
+GLvoid GLVolumeStats::getBinned(GLint _time_slice, GLint _bin_size, GLdouble* _mean, GLdouble* _variance)
+{
+	const GLVoxelStats* slice_tiles = getTiles(_time_slice);
+	GLint group = _bin_size > brick_size ? _bin_size / brick_size : 1;
+	GLdouble bin_voxels = (GLdouble) _bin_size * _bin_size;
+
+	GLdouble bins = 0;
+	GLdouble sum = 0;
+	GLdouble sum_squares = 0;
+	for(GLint gy=0; gy<bricks_y; gy+=group)
+	{
+		for(GLint gx=0; gx<bricks_x; gx+=group)
+		{
+			GLVoxelStats stats;
+			stats.clear();
+			for(GLint by=gy; by<gy + group && by<bricks_y; by++)
+			{
+				for(GLint bx=gx; bx<gx + group && bx<bricks_x; bx++)
+					stats.merge(slice_tiles[by * bricks_x + bx]);
+			}
+			if(stats.count == 0)
+				continue;
+
+			GLdouble n = bin_voxels < stats.count ? bin_voxels : stats.count;
+			GLdouble bin_mean = n * stats.mean();
+			GLdouble deviation = stats.standardDeviation();
+			GLdouble bin_variance = stats.count > 1 ? n * deviation * deviation * (stats.count - n) / (stats.count - 1) : 0.0;
+
+			GLdouble group_bins = stats.count / n;
+			bins += group_bins;
+			sum += group_bins * bin_mean;
+			sum_squares += group_bins * (bin_variance + bin_mean * bin_mean);
+		}
+	}
+
+	*_mean = bins > 0 ? sum / bins : 0.0;
+	GLdouble variance = bins > 0 ? sum_squares / bins - *_mean * *_mean : 0.0;
+	*_variance = variance > 0.0 ? variance : 0.0;
+}
+
+GLVoxelStats GLVolumeStats::getVolume(GLint _no_slices)
+{
+	GLVoxelStats stats;
+	stats.clear();
+	for(GLint t=0; t<_no_slices; t++)
+		stats.merge(slices[t]);
+	return stats;
+}
+
+GLint GLVolumeStats::getBricksX()
+{
+	return bricks_x;
+}
+
+GLint GLVolumeStats::getBricksY()
+{
+	return bricks_y;
+}
+
+size_t GLVolumeStats::getTilesPerSlice()
+{
+	return (size_t) bricks_x * bricks_y;
+}
+
+const GLVoxelStats* GLVolumeStats::getTiles(GLint _time_slice)
+{
+	return tiles + _time_slice * getTilesPerSlice();
+}
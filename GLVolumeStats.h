@@ -0,0 +1,73 @@
+#ifndef GLVOLUMESTATS_H
+#define GLVOLUMESTATS_H
+
+#include <GL/gl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Count rate statistics of a block of raw voxels. Blocks combine with merge(),
+ * an empty block (count 0) is the neutral element.
+ */
+struct GLVoxelStats
+{
+	uint64_t sum;
+	uint64_t sum_squares;
+	GLuint count;
+	GLuint non_zero;
+	GLushort min;
+	GLushort max;
+
+	GLvoid clear();
+	GLvoid merge(const GLVoxelStats& _stats);
+	GLdouble mean() const;
+	GLdouble standardDeviation() const;
+};
+
+/**
+ * Statistics index of the raw stack: one GLVoxelStats per slice and per tile of
+ * _brick_size x _brick_size voxels of every slice. Built once per slice while it is loaded,
+ * so appending a slice only adds its own entries. Queries never touch a voxel.
+ *
+ * addSlice() may run concurrently for different slices, reserve() must not run
+ * concurrently with anything else.
+ */
+class GLVolumeStats
+{
+	public:
+		GLVolumeStats(GLint _width, GLint _height, GLint _brick_size = 16);
+		~GLVolumeStats();
+
+		// grows to _capacity slices, new slices are empty
+		GLvoid reserve(GLint _capacity);
+
+		GLvoid addSlice(GLint _time_slice, const GLushort* _slice);
+		// copies the tiles of _no_slices slices, e.g. from a GLVolumeCache
+		GLvoid loadSlices(const GLVoxelStats* _tiles, GLint _no_slices);
+
+		const GLVoxelStats& getSlice(GLint _time_slice);
+		// mean and variance over a slice of the sums of _bin_size x _bin_size voxels (a GLVolumePyramid level),
+		// estimated from the tiles
+		GLvoid getBinned(GLint _time_slice, GLint _bin_size, GLdouble* _mean, GLdouble* _variance);
+		GLVoxelStats getVolume(GLint _no_slices);
+
+		GLint getBricksX();
+		GLint getBricksY();
+		size_t getTilesPerSlice();
+		const GLVoxelStats* getTiles(GLint _time_slice);		// getTilesPerSlice() each, row by row, slice after slice
+
+	private:
+		GLint width;
+		GLint height;
+		GLint brick_size;
+		GLint bricks_x;
+		GLint bricks_y;
+		GLint capacity;
+
+		GLVoxelStats* slices;
+		GLVoxelStats* tiles;
+
+		GLvoid mergeTiles(GLint _time_slice);
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "GLWorkerPool.h"
+#include <atomic>
+#include <memory>
+
+
+GLWorkerPool::GLWorkerPool(GLint _no_threads)
+{
+	stopping = false;
+
+	if(_no_threads <= 0)
+		_no_threads = (GLint) std::thread::hardware_concurrency();
+	if(_no_threads <= 0)
+		_no_threads = 1;
+
+	for(GLint i=0; i<_no_threads; i++)
+		threads.push_back(std::thread(&GLWorkerPool::workerLoop, this));
+}
+
+GLWorkerPool::~GLWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(tasks_mutex);
+		stopping = true;
+	}
+	task_queued.notify_all();
+
+	for(size_t i=0; i<threads.size(); i++)
+		threads[i].join();
+}
+
+GLint GLWorkerPool::size()
+{
+	return (GLint) threads.size();
+}
+
+GLvoid GLWorkerPool::submit(std::function<GLvoid()> _task)
+{
+	{
+		std::lock_guard<std::mutex> lock(tasks_mutex);
+		tasks.push_back(_task);
+	}
+	task_queued.notify_one();
+}
+
+GLvoid GLWorkerPool::parallelFor(GLint _begin, GLint _end, std::function<GLvoid(GLint)> _body)
+{
+	if(_end <= _begin)
+		return;
+
+	// shared with the helper tasks, which may only get to run after the loop is done
+	struct Loop
+	{
+		std::function<GLvoid(GLint)> body;
+		std::atomic<GLint> next;
+		GLint end;
+		std::atomic<GLint> remaining;
+	};
+	std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+	loop->body = _body;
+	loop->next = _begin;
+	loop->end = _end;
+	loop->remaining = _end - _begin;
+
+	std::function<GLvoid()> run = [loop, this]()
+	{
+		for(GLint i=loop->next++; i<loop->end; i=loop->next++)
+		{
+			loop->body(i);
+			if(--loop->remaining == 0)
+			{
+				// take the lock so the waiting thread cannot miss the wakeup
+				std::lock_guard<std::mutex> lock(tasks_mutex);
+				task_finished.notify_all();
+			}
+		}
+	};
+
+	GLint helpers = _end - _begin - 1 < size() ? _end - _begin - 1 : size();
+	for(GLint h=0; h<helpers; h++)
+		submit(run);
+
+	// the calling thread takes indices too, but never an unrelated task: that one could wait
+	// for something the caller holds (e.g. a slice it is loading), then only sleeps until the
+	// indices the workers took are done
+	run();
+	std::unique_lock<std::mutex> lock(tasks_mutex);
+	task_finished.wait(lock, [&]() { return loop->remaining == 0; });
+}
+
+GLvoid GLWorkerPool::workerLoop()
+{
+	while(true)
+	{
+		std::function<GLvoid()> task;
+		{
+			std::unique_lock<std::mutex> lock(tasks_mutex);
+			task_queued.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if(stopping && tasks.empty())
+				return;
+			task = tasks.front();
+			tasks.pop_front();
+		}
+		task();
+	}
+}
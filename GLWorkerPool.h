@@ -0,0 +1,39 @@
+#ifndef GLWORKERPOOL_H
+#define GLWORKERPOOL_H
+
+#include <GL/gl.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+/**
+ * Fixed size pool of worker threads fed from a single task queue.
+ * parallelFor() blocks until all of its indices are done; the calling
+ * thread works on the indices itself and never runs other queued tasks,
+ * so it is safe to call from inside a task as well.
+ */
+class GLWorkerPool
+{
+	public:
+		GLWorkerPool(GLint _no_threads = 0); // 0 -> one thread per core
+		~GLWorkerPool();
+
+		GLint size();
+		GLvoid submit(std::function<GLvoid()> _task);
+		GLvoid parallelFor(GLint _begin, GLint _end, std::function<GLvoid(GLint)> _body);
+
+	private:
+		std::vector<std::thread> threads;
+		std::deque<std::function<GLvoid()> > tasks;
+		std::mutex tasks_mutex;
+		std::condition_variable task_queued;
+		std::condition_variable task_finished;
+		GLboolean stopping;
+
+		GLvoid workerLoop();
+};
+
+#endif
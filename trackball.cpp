@@ -1,11 +1,40 @@
 #include <GL/gl.h>
 #include <GL/glut.h>
 #include "GLQuaternion4f.h"
+#include "GLWorkerPool.h"
+#include "GLStackLoader.h"
+#include "GLSliceProvider.h"
+#include "GLVolumeCache.h"
+#include "GLStackWatcher.h"
+#include "GLBenchmark.h"
+#include "GLBrickedVolume.h"
+#include "GLVolumePyramid.h"
+#include "GLNormalize.h"
+#include "GLHistogram.h"
+#include "GLVolumeStats.h"
+#include "GLCutEngine.h"
+#include "GLPathCut.h"
+#include "GLSummedVolume.h"
+#include "GLVolumeFilter.h"
+#include "GLColorLUT.h"
+#include "GLPointCloud.h"
+#include "GLCutTexture.h"
+#include "GLVolumeRenderer.h"
+#include "GLSparseVolume.h"
+#include "GLHeadless.h"
+#include "GLRaycaster.h"
 #include <iostream>
 #include <math.h>
 #include <fstream>
-#include <tiffio.h>
 #include <string.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <time.h>
 
 #define GL_PI 3.141592654f
 
@@ -24,7 +53,9 @@ enum ResolutionMode
 enum RenderMode
 {
 	RENDER_ALL,
-	RENDER_SINGLE
+	RENDER_SINGLE,
+	RENDER_VOLUME,		// raycast through all slices of the shown level, see GLVolumeRenderer
+	RENDER_RAYCAST		// the same on the CPU, blitted into the window, see GLRaycaster
 };
 
 enum ColorMode
@@ -37,7 +68,16 @@ enum DataMode
 {
 	DATA_XY,
 	DATA_EX,
-	DATA_EY
+	DATA_EY,
+	DATA_OBLIQUE,	// cut facing the viewer, follows the trackball
+	DATA_PATH		// energy momentum cut along the k-path of path_cut
+};
+
+enum ContrastMode
+{
+	CONTRAST_MAX,		// linear up to the max count rate of the stack
+	CONTRAST_GLOBAL,	// clipped at contrast_percentile of the whole stack
+	CONTRAST_SLICE		// clipped at contrast_percentile of every slice on its own
 };
 
 
@@ -51,6 +91,7 @@ RenderMode render_mode;
 ResolutionMode resolution_mode;
 ColorMode color_mode;
 DataMode data_mode;
+ContrastMode contrast_mode;
 
 
 // virtual trackball variables for rotation
@@ -67,15 +108,35 @@ GLfloat rotation_angle;
 GLfloat	viewport_scale = 1;
 GLint active_slice;
 GLubyte voxel_alpha = 255;
+GLfloat contrast_percentile = 99.9f;
 GLint x_linecut_y_position;
 GLint y_linecut_x_position;
 GLint y_linecut_x_position_high_res;
 GLint x_linecut_y_position_high_res;
 GLint show_x_linecut;
 GLint show_y_linecut;
+GLboolean show_stats;
 
 // color palette (MATLAB jet color)
-GLubyte* palette;
+GLubyte* palette;				// 256 RGB entries
+GLColorLUT* color_lut;			// HIGH_RES: raw counts -> packed RGBA, with contrast_clip, palette and voxel_alpha
+
+// retained point clouds, one per mode, rebuilt only when their key changes (see GLPointCloud)
+GLPointCloud* cloud_all;
+GLPointCloud* cloud_xy;
+GLPointCloud* cloud_ey;
+GLPointCloud* cloud_path;
+GLPointCloud* cloud_high_res;
+GLCutTexture* cut_texture;		// EX and oblique cuts as one textured quad
+GLuint contrast_generation;		// bumped by updateContrast()
+
+GLVolumeRenderer* volume_renderer;
+GLRaycaster* raycaster;
+GLRaycastMode raycast_mode = RAYCAST_COMPOSITE;		// 'w' in RENDER_RAYCAST
+
+// RENDER_ALL only draws the voxels above point_threshold (-1 all), from the sorted list of sparse_volume
+GLSparseVolume* sparse_volume;
+GLint point_threshold;
 
 // opengl screen setting parameters
 GLfloat viewport_height = 512;
@@ -89,23 +150,76 @@ GLfloat viewport_aspect = viewport_width / viewport_height;
 // program state variables
 GLboolean data_downsampled;
 GLboolean data_downscaled;
+std::chrono::steady_clock::time_point program_start;
+GLboolean first_frame_shown;
 
 /**
  * DATA STORAGE AND FILE HANDLING
  */
 
 // data storage
-GLushort* data_DLD_raw;		// storage with same resolution as imported TIFF images (will be downsampled from 16Bit(actually 12Bit-> DLD/Camera sampling) to 8Bit)
-GLubyte* data_DLD;			//downscaled/downsampled data storage, 128x128 px, 8Bit
+GLSliceProvider* data_DLD_raw;	// slices with same resolution as imported TIFF images, 16Bit (actually 12Bit-> DLD/Camera sampling), read only, acquire/release every slice you touch
+GLushort data_DLD_raw_max;	// global max count rate of data_DLD_raw, used to downsample to 8Bit on the fly
+GLubyte* data_DLD;			//downscaled/downsampled data storage, level data_DLD_level of volume_pyramid, 8Bit
+GLubyte* data_DLD_cut;		// EY cut extracted once per frame, data_DLD_reduced_height px per slice
+
+// the reduced volume always spans 128x128 units on screen, whatever level is shown
+GLVolumePyramid* volume_pyramid;	// binned raw counts of all levels, data_DLD is one of its normalized levels
+std::atomic<GLint> data_DLD_level(-1);	// picked from viewport_scale by updateLevel()
+GLint data_DLD_reduced_width;
+GLint data_DLD_reduced_height;
 
 GLint data_DLD_width;
 GLint data_DLD_height;
 
 const GLchar* path_root = "data/";
 GLchar* filename = (GLchar *) "DLD50.tif";
-GLchar path[80];
 GLchar* filename_root =(GLchar *) "DLD";
-GLint no_slices = 100;
+GLint no_slices = 0;			// validated against the files on disk by GLStackLoader::probe()
+size_t memory_budget = (size_t) 1024 * 1024 * 1024;	// raw slices, summed volume and filter together, see budgetBytes() (--memory-budget <MB>)
+GLboolean watch_mode = false;	// append new slices while they are acquired (--watch)
+GLboolean packed_mode = false;	// keep data_DLD_raw 12Bit packed in memory (--packed12)
+const GLchar* benchmark_name = NULL;	// run a benchmark instead of the viewer (--benchmark <name>)
+const GLchar* flat_path = NULL;		// flat field the slices are corrected with while loading (--flat <tif>)
+const GLchar* dark_path = NULL;		// dark frame subtracted from every slice while loading (--dark <tif>)
+GLint headless_rotations = -1;		// render the scripted views into an EGL pbuffer instead of a window (--headless <rotations>)
+GLint raycast_views = -1;			// raycast the scripted views on the CPU into PPM files, no GL at all (--raycast <mip|composite> <rotations>)
+
+GLWorkerPool* worker_pool;
+GLStackLoader* stack_loader;
+GLSliceCorrection* slice_correction;	// NULL without --flat/--dark, data_DLD_raw holds the corrected counts otherwise
+GLVolumeCache* volume_cache;	// data_DLD_raw and data_DLD are mapped from the cache file if it is open
+GLStackWatcher* stack_watcher;	// only in watch_mode
+
+// progressive loading: the workers reduce one slice after the other in reduceSlice(),
+// render() only draws slices whose bit is set in data_DLD_ready
+std::atomic<uint64_t>* data_DLD_ready;		// lock-free bitmap, bit t is set once data_DLD slice t is valid
+std::atomic<GLint> slices_ready;
+std::atomic<GLuint> raw_max_running;
+GLint data_DLD_capacity;				// slices allocated in volume_pyramid, data_DLD_ready and the contrast tables
+
+// contrast: a voxel's palette index is contrast_lut[t * 256 + data_DLD voxel], changing the contrast
+// only rebuilds the tables from the histograms in updateContrast()
+GLSliceHistograms* slice_histograms;	// count rates of every raw slice, filled while loading
+GLubyte* contrast_lut;					// 256 entries per slice
+GLushort* contrast_clip;				// per slice, the count rate of data_DLD_raw shown as 255
+
+GLVolumeStats* volume_stats;			// per slice and per 16x16 tile statistics of data_DLD_raw, filled while loading
+
+GLCutEngine* cut_engine;				// EX and oblique cuts, resampled from the pyramid sums of the shown level
+GLfloat cut_offset;						// DATA_OBLIQUE: distance of the cut from the volume center along the view axis
+GLPathCut* path_cut;					// DATA_PATH: E vs k along a polyline, vertices in normalized slice coordinates
+GLint path_vertex;						// the vertex moved with the arrow keys
+
+GLSummedVolume* summed_volume;			// box sums of data_DLD_raw for the EDC/MDC profiles, NULL beyond the memory budget
+
+// smoothing: the pyramid is reduced from the filtered slices instead of data_DLD_raw, the histograms,
+// statistics, profiles and HIGH_RES keep the raw counts
+GLVolumeFilter* volume_filter;			// NULL while filter_type is FILTER_NONE
+GLFilterType filter_type;
+GLint filter_radius;
+std::atomic<bool> pyramid_busy;			// the load stage or the cache write still use the pyramid sums
+GLuint data_generation;					// bumped whenever the sums of ready slices change, part of the cut stamps
 
 
 /** ======================================================================
@@ -131,22 +245,60 @@ GLvoid initOpenGL();
 GLvoid initTrackball();
 GLvoid initAdjustableParameters();
 GLvoid initStateVariables();
+GLint runHeadless();
+GLint runRaycast();
+GLboolean isWindowed();
+GLvoid waitForLoading();
 
 GLvoid renderXLineCut();
 GLvoid renderYLineCut();
 GLvoid renderFrame();
+GLvoid renderStats();
+GLubyte highlightThreshold(GLint _time_slice);
+GLvoid renderProfile(const uint64_t* _values, GLint _count, const GLfloat* _origin, const GLfloat* _step, const GLfloat* _offset);
 
 
-GLvoid loadTiff(GLchar* _path, GLint _time_slice);
 GLvoid loadDataStack();
+GLvoid reduceSlice(GLint _time_slice);
+GLvoid checkLoadingProgress(GLint _value);
+GLboolean updateLoadingProgress(GLboolean* _changed);
+GLvoid finishLoading();
+GLboolean isSliceReady(GLint _time_slice);
+GLvoid reserveSlices(GLint _capacity);
+size_t budgetBytes(GLint _capacity, GLboolean _summed, GLboolean _filter);
+GLvoid appendSlice();
+GLvoid checkNewSlices(GLint _value);
+GLvoid setActiveSlice(GLint _slice);
+GLvoid extractYLineCut(GLint _x);
+GLvoid renderCut(const GLCutPlane& _plane, GLint _level);
+GLvoid renderObliqueCut(GLint _level, GLfloat _width, GLfloat _height);
+GLvoid renderPathCut();
+GLvoid movePathVertex(GLfloat _dx, GLfloat _dy);
+GLvoid updateSparseVolume();
+GLvoid getContrastVolume(std::vector<GLubyte>& _voxels);
+GLvoid updateRaycaster();
+GLvoid renderRaycast();
+GLvoid pickVoxel(GLint _x, GLint _y);
+GLvoid updateLevel();
+GLvoid setLevel(GLint _level);
+GLboolean renormalizeSlices();
+GLvoid updateContrast();
+GLvoid setColor(GLubyte* _color, GLubyte _voxel_i);
+GLvoid setPoint(GLPointVertex& _vertex, GLfloat _x, GLfloat _y, GLfloat _z, GLubyte _voxel_i);
+GLvoid setContrast(ContrastMode _mode, GLfloat _percentile);
+GLvoid parseArguments(GLint _argc, GLchar** _argv);
 GLvoid setPalette();
 GLvoid resetRotationMatrix();
 GLvoid setSideView();
+GLvoid setRandomRotation();
 GLvoid freeMemory();
 
 // data processing
-GLvoid downsample();
-GLvoid downscale();
+GLvoid reduceLoadedSlice(GLint _time_slice, const GLushort* _slice);
+GLvoid integrateSummedVolume();
+GLvoid setFilter(GLFilterType _type, GLint _radius);
+GLvoid filterRawSlice(GLint _time_slice);
+GLvoid rereduceSlices(GLint _first, GLint _end);
 
 // debugging
 GLvoid debugMsg(GLchar* _arg_desc, GLfloat _arg_val);
@@ -155,6 +307,16 @@ GLvoid debugMsg(GLchar* _msg);
 
 GLint main(int _argc, char** _argv){
 
+	program_start = std::chrono::steady_clock::now();
+
+	parseArguments(_argc, _argv);
+	if(benchmark_name)
+		return runBenchmark(benchmark_name);
+	if(headless_rotations >= 0)
+		return runHeadless();
+	if(raycast_views >= 0)
+		return runRaycast();
+
 	glutInit(&_argc, _argv);
 	glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
 	glutInitWindowSize(viewport_width,viewport_height);
@@ -172,8 +334,186 @@ GLint main(int _argc, char** _argv){
 }
 
 
+static GLdouble cpuMilliseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// _values sorted
+static GLdouble percentile(const std::vector<GLdouble>& _values, GLdouble _fraction)
+{
+	size_t i = (size_t) (_fraction * _values.size());
+	return _values[i < _values.size() ? i : _values.size() - 1];
+}
+
+/**
+ * renders the scripted views (top, side, then headless_rotations random trackball rotations,
+ * the same ones every run) in every mode into an EGL pbuffer, glut is never initialized.
+ * The first frame of a mode builds its point cloud / texture and is listed on its own, the
+ * percentiles of wall and CPU time (all threads of the process) cover the other frames.
+ * The checksum of the last frame only changes if the rendered image does.
+ */
+GLint runHeadless()
+{
+	GLHeadlessContext context;
+	if(!context.create(viewport_width, viewport_height))
+		return EXIT_FAILURE;
+	std::cout << "info: headless rendering with " << context.getRenderer() << std::endl;
+
+	init();
+	waitForLoading();
+
+	// the data mode only applies to single slices, HIGH_RES only draws the XY slice and the oblique cut
+	struct HeadlessMode
+	{
+		ResolutionMode resolution;
+		RenderMode render;
+		DataMode data;
+	};
+	std::vector<HeadlessMode> modes = {{LOW_RES, RENDER_ALL, DATA_XY}, {LOW_RES, RENDER_VOLUME, DATA_XY}, {LOW_RES, RENDER_RAYCAST, DATA_XY},
+									   {LOW_RES, RENDER_SINGLE, DATA_XY}, {LOW_RES, RENDER_SINGLE, DATA_EY},
+									   {LOW_RES, RENDER_SINGLE, DATA_EX}, {LOW_RES, RENDER_SINGLE, DATA_OBLIQUE},
+									   {LOW_RES, RENDER_SINGLE, DATA_PATH}, {HIGH_RES, RENDER_SINGLE, DATA_XY},
+									   {HIGH_RES, RENDER_SINGLE, DATA_EY}, {HIGH_RES, RENDER_SINGLE, DATA_OBLIQUE}};
+	const GLchar* resolution_names[] = {"high", "low"};
+	const GLchar* render_names[] = {"all", "single", "volume", "raycast"};
+	const GLchar* color_names[] = {"color", "mono"};
+	const GLchar* data_names[] = {"xy", "ex", "ey", "oblique", "path"};
+
+	std::cout << "headless: " << viewport_width << "x" << viewport_height << ", top, side and " << headless_rotations
+			  << " random views per mode, ms" << std::endl;
+	std::cout << "  res  render  data     color    first   wall p50    p90    p99   cpu p50    p90    p99  checksum" << std::endl;
+	std::vector<GLubyte> pixels((size_t) viewport_width * viewport_height * 4);
+	for(size_t m=0; m<modes.size(); m++)
+	{
+		for(GLint c=0; c<2; c++)
+		{
+			resolution_mode = modes[m].resolution;
+			render_mode = modes[m].render;
+			color_mode = c == 0 ? COLOR : MONO;
+			srand(1);
+
+			GLdouble first = 0;
+			std::vector<GLdouble> wall;
+			std::vector<GLdouble> cpu;
+			for(GLint frame=0; frame<headless_rotations + 2; frame++)
+			{
+				if(frame == 0)
+					resetRotationMatrix();
+				else if(frame == 1)
+					setSideView();
+				else
+					setRandomRotation();
+				// the views pick their own data mode
+				data_mode = modes[m].data;
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				GLdouble cpu_start = cpuMilliseconds();
+				render();
+				GLdouble wall_time = std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - start).count();
+				if(frame == 0)
+				{
+					first = wall_time;
+					continue;
+				}
+				wall.push_back(wall_time);
+				cpu.push_back(cpuMilliseconds() - cpu_start);
+			}
+			std::sort(wall.begin(), wall.end());
+			std::sort(cpu.begin(), cpu.end());
+
+			// FNV-1a of the last frame
+			glReadPixels(0, 0, viewport_width, viewport_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			GLuint checksum = 2166136261u;
+			for(size_t i=0; i<pixels.size(); i++)
+				checksum = (checksum ^ pixels[i]) * 16777619u;
+
+			std::cout << "  " << std::left << std::setw(5) << resolution_names[resolution_mode] << std::setw(8) << render_names[render_mode]
+					  << std::setw(9) << (render_mode == RENDER_SINGLE ? data_names[modes[m].data] : "-") << std::setw(7) << color_names[color_mode]
+					  << std::right << std::fixed << std::setprecision(1) << std::setw(8) << first
+					  << std::setw(11) << percentile(wall, 0.5) << std::setw(7) << percentile(wall, 0.9) << std::setw(7) << percentile(wall, 0.99)
+					  << std::setw(10) << percentile(cpu, 0.5) << std::setw(7) << percentile(cpu, 0.9) << std::setw(7) << percentile(cpu, 0.99)
+					  << "  " << std::hex << std::setw(8) << std::setfill('0') << checksum << std::dec << std::setfill(' ') << std::endl;
+		}
+	}
+
+	freeMemory();
+	return EXIT_SUCCESS;
+}
+
+/**
+ * batch rendering for machines without a usable OpenGL: the scripted views of runHeadless()
+ * (top, side, then raycast_views random rotations) are raycast on the CPU at the window size
+ * and written to data/DLD_<mode><view>.ppm, neither glut nor a GL context is needed.
+ */
+GLint runRaycast()
+{
+	init();
+	waitForLoading();
+
+	resolution_mode = LOW_RES;
+	updateLevel();
+	updateRaycaster();
+
+	const GLchar* mode_name = raycast_mode == RAYCAST_MIP ? "mip" : "composite";
+	std::cout << "info: raycasting " << data_DLD_reduced_width << "x" << data_DLD_reduced_height << "x" << no_slices << " into "
+			  << viewport_width << "x" << viewport_height << " (" << mode_name << ") on " << worker_pool->size() << " threads" << std::endl;
+	srand(1);
+	for(GLint view=0; view<raycast_views + 2; view++)
+	{
+		if(view == 0)
+			resetRotationMatrix();
+		else if(view == 1)
+			setSideView();
+		else
+			setRandomRotation();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		raycaster->render(rotation_matrix, viewport_scale, viewport_width, viewport_height, raycast_mode);
+		GLdouble time = std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		GLchar path[256];
+		snprintf(path, sizeof(path), "%s%s_%s%d.ppm", path_root, filename_root, mode_name, view);
+		if(!raycaster->exportPPM(path))
+		{
+			std::cout << "error: could not write " << path << std::endl;
+			freeMemory();
+			return EXIT_FAILURE;
+		}
+		std::cout << "info: wrote " << path << ", " << std::fixed << std::setprecision(1) << time << " ms" << std::endl;
+	}
+
+	freeMemory();
+	return EXIT_SUCCESS;
+}
+
+// false for --headless and --raycast, glut is not initialized then
+GLboolean isWindowed()
+{
+	return headless_rotations < 0 && raycast_views < 0;
+}
+
+// without the glut timer of the window, polls until every slice is loaded
+GLvoid waitForLoading()
+{
+	if(data_downsampled)
+		return;
+
+	GLboolean changed;
+	while(!updateLoadingProgress(&changed))
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	finishLoading();
+}
+
+
 GLvoid freeMemory()
 {
+ // finish pending background work before anything it uses goes away
+ delete worker_pool;
+ worker_pool = NULL;
+
  delete start_vector;
  delete end_vector;
  delete rotation_vector;
@@ -182,9 +522,34 @@ GLvoid freeMemory()
  delete rotation_matrix;
  //delete data_DLD_downsampled;
 
+ delete[] palette;
+ delete color_lut;
+ delete cloud_all;
+ delete cloud_xy;
+ delete cloud_ey;
+ delete cut_texture;
+ delete cloud_path;
+ delete cloud_high_res;
+ delete volume_renderer;
+ delete raycaster;
+ delete sparse_volume;
+ delete[] data_DLD_ready;
+ delete[] data_DLD_cut;
+ delete volume_pyramid;
+ delete slice_histograms;
+ delete volume_stats;
+ delete cut_engine;
+ delete path_cut;
+ delete summed_volume;
+ delete volume_filter;
+ delete[] contrast_lut;
+ delete[] contrast_clip;
+
  delete data_DLD_raw;
- delete data_DLD;
- delete palette;
+ delete volume_cache;
+ delete stack_watcher;
+ delete stack_loader;
+ delete slice_correction;
 
 }
 
@@ -203,10 +568,10 @@ GLvoid setPalette()
 							 127, 0, 0,
 							 255, 255, 255};
 
-	palette = new GLubyte[3*255];
+	palette = new GLubyte[3*256];
 
 	// initialise with white
-	for(int i=0; i< 3*255; i++)
+	for(int i=0; i< 3*256; i++)
 	{
 		palette[i] = 255;
 	}
@@ -235,10 +600,354 @@ GLvoid setPalette()
 
 GLvoid loadDataStack()
 {
-	for(int n = 0; n <= no_slices; n+=1)
+	data_DLD_raw = new GLSliceProvider(stack_loader, worker_pool, memory_budget, packed_mode);
+	data_DLD_raw->setLoadStage(reduceLoadedSlice);
+
+	if(data_DLD_raw->isStreaming())
 	{
-		sprintf(path, "%s%s%d.tif", path_root, filename_root, n);
-		loadTiff(path, n);
+		std::cout << "info: stack exceeds the memory budget of " << memory_budget / (1024 * 1024)
+				  << " MB, slices are streamed on demand" << std::endl;
+	}
+
+	reserveSlices(no_slices);
+	updateLevel();
+
+	data_DLD_raw_max = 1;
+	raw_max_running = 1;
+
+	// slices are submitted in order, the window shows slice 0 as soon as it is done
+	for(GLint t=0; t<no_slices; t++)
+		worker_pool->submit([t]() { reduceSlice(t); });
+
+	// headless, waitForLoading() polls instead
+	if(isWindowed())
+		glutTimerFunc(20, checkLoadingProgress, 0);
+}
+
+
+static GLvoid atomicMax(std::atomic<GLuint>& _max, GLuint _value)
+{
+	GLuint current = _max.load();
+	while(current < _value && !_max.compare_exchange_weak(current, _value))
+		;
+}
+
+/**
+ * bytes of memory_budget taken at _capacity slices by the raw slices (the whole stack as
+ * data_DLD_raw keeps it, or the whole budget once it streams), plus the summed volume table
+ * and the smoothing filter if they are asked for. Everything else is not budgeted.
+ */
+size_t budgetBytes(GLint _capacity, GLboolean _summed, GLboolean _filter)
+{
+	size_t slice_size = (size_t) data_DLD_width * data_DLD_height;
+	size_t bytes = (packed_mode ? packedSize12(slice_size) : slice_size * sizeof(GLushort)) * _capacity;
+	bytes = bytes < memory_budget ? bytes : memory_budget;
+	if(_summed)
+		bytes += GLSummedVolume::getSize(data_DLD_width, data_DLD_height, _capacity);
+	if(_filter)
+		bytes += GLVolumeFilter::getSize(data_DLD_width, data_DLD_height, _capacity);
+	return bytes;
+}
+
+// grows the reduced volume, new slices are 0 and not ready
+GLvoid reserveSlices(GLint _capacity)
+{
+	if(_capacity <= data_DLD_capacity)
+		return;
+
+	volume_pyramid->reserve(_capacity);
+	slice_histograms->reserve(_capacity);
+	volume_stats->reserve(_capacity);
+
+	// over the budget the filter goes first, then the summed volume table
+	if(volume_filter && (budgetBytes(_capacity, summed_volume != NULL, true) > memory_budget
+						 || !volume_filter->reserve(_capacity)))
+	{
+		std::cout << "info: smoothing filter exceeds the memory budget, smoothing is off" << std::endl;
+		delete volume_filter;
+		volume_filter = NULL;
+		filter_type = FILTER_NONE;
+		rereduceSlices(0, no_slices);
+	}
+
+	if(summed_volume && (budgetBytes(_capacity, true, false) > memory_budget
+						 || !summed_volume->reserve(_capacity)))
+	{
+		std::cout << "info: summed volume table exceeds the memory budget, EDC/MDC profiles are off" << std::endl;
+		delete summed_volume;
+		summed_volume = NULL;
+	}
+
+	GLubyte* new_contrast_lut = new GLubyte[256 * _capacity];
+	GLushort* new_contrast_clip = new GLushort[_capacity];
+	for(GLint t=0; t<_capacity; t++)
+	{
+		for(GLint v=0; v<256; v++)
+			new_contrast_lut[t * 256 + v] = t < data_DLD_capacity ? contrast_lut[t * 256 + v] : v;
+		new_contrast_clip[t] = t < data_DLD_capacity ? contrast_clip[t] : 1;
+	}
+	delete[] contrast_lut;
+	delete[] contrast_clip;
+	contrast_lut = new_contrast_lut;
+	contrast_clip = new_contrast_clip;
+
+	GLint words = (_capacity + 63) / 64;
+	std::atomic<uint64_t>* new_data_DLD_ready = new std::atomic<uint64_t>[words];
+	for(GLint i=0; i<words; i++)
+		new_data_DLD_ready[i] = i < (data_DLD_capacity + 63) / 64 ? data_DLD_ready[i].load() : 0;
+	delete[] data_DLD_ready;
+	data_DLD_ready = new_data_DLD_ready;
+
+	// large enough for the finest level
+	delete[] data_DLD_cut;
+	data_DLD_cut = new GLubyte[volume_pyramid->getHeight(1) * _capacity];
+
+	data_DLD_capacity = _capacity;
+	if(data_DLD_level >= 0)
+		data_DLD = volume_pyramid->getNormalized(data_DLD_level);
+}
+
+// shows the coarsest pyramid level that still fills the viewport at viewport_scale
+GLvoid updateLevel()
+{
+	// the reduced volume spans 128 of the 256 * viewport_scale units of the viewport
+	setLevel(volume_pyramid->selectLevel(viewport_width / (2 * viewport_scale)));
+}
+
+GLvoid setLevel(GLint _level)
+{
+	if(_level == data_DLD_level)
+		return;
+
+	data_DLD_level = _level;
+	data_DLD = volume_pyramid->getNormalized(_level);
+	data_DLD_reduced_width = volume_pyramid->getWidth(_level);
+	data_DLD_reduced_height = volume_pyramid->getHeight(_level);
+
+	// the other levels are only normalized while they are shown
+	renormalizeSlices();
+}
+
+// normalizes the ready slices of the shown level that are out of date with its max, true if any was
+GLboolean renormalizeSlices()
+{
+	GLint level = data_DLD_level;
+	GLuint max_count_rate = volume_pyramid->getMax(level);
+	std::vector<GLint> outdated;
+
+	for(GLint t=0; t<no_slices; t++)
+	{
+		if(isSliceReady(t) && volume_pyramid->getNormalizedMax(level, t) != max_count_rate)
+			outdated.push_back(t);
+	}
+
+	worker_pool->parallelFor(0, (GLint) outdated.size(), [&](GLint _i)
+	{
+		volume_pyramid->normalizeSlice(level, outdated[_i], max_count_rate);
+	});
+
+	// the point clouds hold normalized values
+	if(!outdated.empty())
+		data_generation++;
+	return !outdated.empty();
+}
+
+/**
+ * appends slice no_slices after DLD<no_slices>.tif was written, costs O(slice):
+ * only the new slice is reduced, the shown level is renormalized only if
+ * the new slice raises its max count rate
+ */
+GLvoid appendSlice()
+{
+	GLint t = no_slices;
+
+	// a prefetch may still be reducing a slice into the tables reserveSlices() moves
+	data_DLD_raw->waitForLoads();
+	if(t == data_DLD_capacity)
+		reserveSlices(2 * data_DLD_capacity);
+
+	data_DLD_raw->appendSlice();
+	no_slices++;
+
+	reduceSlice(t);
+	data_DLD_raw_max = (GLushort) raw_max_running.load();
+
+	// the new slice ends up in the t pass of the radius slices before it
+	if(volume_filter)
+	{
+		filterRawSlice(t);
+		volume_filter->filterDepth(t - filter_radius, t + 1, no_slices, worker_pool);
+		rereduceSlices(t - filter_radius > 0 ? t - filter_radius : 0, t + 1);
+	}
+	renormalizeSlices();
+	updateContrast();
+	if(summed_volume)
+		summed_volume->integrate(no_slices, worker_pool);
+
+	std::cout << "info: appended slice " << t << std::endl;
+
+	// follow the acquisition if the newest slice was shown
+	if(active_slice == t - 1)
+		setActiveSlice(t);
+	glutPostRedisplay();
+}
+
+// glut timer, only in watch_mode and after the initial stack is loaded
+GLvoid checkNewSlices(GLint _value)
+{
+	stack_watcher->poll();
+
+	while(stack_watcher->isComplete(no_slices))
+		appendSlice();
+
+	glutTimerFunc(200, checkNewSlices, 0);
+}
+
+GLboolean isSliceReady(GLint _time_slice)
+{
+	return (data_DLD_ready[_time_slice / 64].load(std::memory_order_acquire) >> (_time_slice % 64)) & 1;
+}
+
+// runs on the worker pool
+GLvoid reduceSlice(GLint _time_slice)
+{
+	// loading the slice reduces it on the way, see reduceLoadedSlice()
+	GLSliceView slice = data_DLD_raw->acquireSlice(_time_slice);
+
+	// it was resident before (e.g. prefetched and reduced already, or a fixed slice table)
+	if(!isSliceReady(_time_slice))
+	{
+		GLushort* scratch = slice.pixels ? NULL : new GLushort[slice.count];
+		reduceLoadedSlice(_time_slice, slice.unpacked(scratch));
+		delete[] scratch;
+	}
+
+	data_DLD_raw->releaseSlice(_time_slice);
+}
+
+// glut timer, polls the workers while the stack is loading
+GLvoid checkLoadingProgress(GLint _value)
+{
+	GLboolean changed;
+	GLboolean done = updateLoadingProgress(&changed);
+	if(changed)
+		glutPostRedisplay();
+
+	if(!done)
+	{
+		glutTimerFunc(20, checkLoadingProgress, 0);
+		return;
+	}
+
+	finishLoading();
+	if(watch_mode)
+		glutTimerFunc(200, checkNewSlices, 0);
+}
+
+// takes over the slices the workers finished, true once all are in, *_changed if the view is out of date
+GLboolean updateLoadingProgress(GLboolean* _changed)
+{
+	static GLint slices_shown = 0;
+
+	GLint ready = slices_ready.load();
+	*_changed = ready != slices_shown;
+
+	// renormalize the slices that were done before a brighter one came in
+	if(renormalizeSlices())
+		*_changed = true;
+
+	data_DLD_raw_max = (GLushort) raw_max_running.load();
+	slices_shown = ready;
+	if(*_changed)
+		updateContrast();
+
+	return ready == no_slices;
+}
+
+// after the last slice: summed volume table, load times and the cache
+GLvoid finishLoading()
+{
+	data_downsampled = true;
+	data_downscaled = true;
+
+	integrateSummedVolume();
+
+	GLdouble time = std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - program_start).count();
+	stack_loader->printLoadTimes(time, worker_pool->size());
+	std::cout << "info: stack ready after " << time << " ms" << std::endl;
+
+	if(watch_mode)
+	{
+		// the cache would be out of date with the next slice anyway
+		pyramid_busy = false;
+	}
+	else
+	{
+		worker_pool->submit([]()
+		{
+			volume_cache->write(stack_loader, data_DLD_raw, data_DLD_raw_max, volume_pyramid, slice_histograms, volume_stats);
+			pyramid_busy = false;
+		});
+	}
+}
+
+
+GLvoid setActiveSlice(GLint _slice)
+{
+	if(_slice < 0 || _slice >= no_slices || _slice == active_slice)
+		return;
+
+	data_DLD_raw->prefetch(_slice, _slice > active_slice ? 1 : -1);
+	active_slice = _slice;
+	glutPostRedisplay();
+}
+
+
+GLvoid parseArguments(GLint _argc, GLchar** _argv)
+{
+	for(GLint i=1; i<_argc; i++)
+	{
+		if(strcmp(_argv[i], "--memory-budget") == 0 && i + 1 < _argc)
+		{
+			memory_budget = (size_t) atol(_argv[++i]) * 1024 * 1024;
+		}
+		else if(strcmp(_argv[i], "--watch") == 0)
+		{
+			watch_mode = true;
+		}
+		else if(strcmp(_argv[i], "--packed12") == 0)
+		{
+			packed_mode = true;
+		}
+		else if(strcmp(_argv[i], "--benchmark") == 0 && i + 1 < _argc)
+		{
+			benchmark_name = _argv[++i];
+		}
+		else if(strcmp(_argv[i], "--flat") == 0 && i + 1 < _argc)
+		{
+			flat_path = _argv[++i];
+		}
+		else if(strcmp(_argv[i], "--dark") == 0 && i + 1 < _argc)
+		{
+			dark_path = _argv[++i];
+		}
+		else if(strcmp(_argv[i], "--headless") == 0 && i + 1 < _argc)
+		{
+			headless_rotations = atoi(_argv[++i]);
+			headless_rotations = headless_rotations > 0 ? headless_rotations : 0;
+		}
+		else if(strcmp(_argv[i], "--raycast") == 0 && i + 2 < _argc)
+		{
+			raycast_mode = strcmp(_argv[++i], "mip") == 0 ? RAYCAST_MIP : RAYCAST_COMPOSITE;
+			raycast_views = atoi(_argv[++i]);
+			raycast_views = raycast_views > 0 ? raycast_views : 0;
+		}
+		else if(strncmp(_argv[i], "--", 2) == 0)
+		{
+			// single dash options are left to glutInit()
+			std::cout << "usage: " << _argv[0] << " [--memory-budget <MB>] [--watch] [--packed12] [--flat <tif>] [--dark <tif>] [--benchmark <name>] [--headless <rotations>] [--raycast <mip|composite> <rotations>]" << std::endl;
+			exit(EXIT_FAILURE);
+		}
 	}
 }
 
@@ -253,12 +962,18 @@ GLvoid render()
 		glOrtho(-128*viewport_scale, 128*viewport_scale, -128*viewport_scale , 128*viewport_scale,-viewport_far, viewport_far);
 		glMatrixMode(GL_MODELVIEW);
 
+		updateLevel();
+		GLfloat level_scale_x = 128.0f / data_DLD_reduced_width;
+		GLfloat level_scale_y = 128.0f / data_DLD_reduced_height;
+
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		GLubyte voxel_i;
-		GLubyte voxel_r;
-		GLubyte voxel_g;
-		GLubyte voxel_b;
+		GLubyte highlight_threshold = highlightThreshold(active_slice);
+
+		// without shaders the volume falls back to the point cloud
+		if(render_mode == RENDER_VOLUME && !volume_renderer->isSupported())
+			render_mode = RENDER_ALL;
 
 
 		// ----------------------------------------------------
@@ -270,40 +985,40 @@ GLvoid render()
 			glPushMatrix();
 			glMultMatrixf(rotation_matrix);
 			glTranslatef(-128/2.0, -128/2.0, 0);
-			glBegin(GL_POINTS);
-            for(int t=0; t<no_slices; t+=2)
+			glScalef(level_scale_x, level_scale_y, 1);
+
+			updateSparseVolume();
+			GLuint key[] = {(GLuint) data_DLD_level, (GLuint) slices_ready, data_generation, contrast_generation,
+							(GLuint) color_mode, voxel_alpha, (GLuint) active_slice, highlight_threshold, (GLuint) no_slices, (GLuint) point_threshold};
+			if(cloud_all->isOutdated(key, sizeof(key) / sizeof(GLuint)))
 			{
-				for(int y=0; y<128; y++)
+				// the voxels above the threshold, value by value from the top
+				const GLuint* voxels = sparse_volume->getVoxels();
+				size_t slice_size = (size_t) data_DLD_reduced_width * data_DLD_reduced_height;
+				GLPointVertex* vertices = cloud_all->getVertices(sparse_volume->getCount(point_threshold));
+				size_t count = 0;
+				for(GLint v=255; v>point_threshold; v--)
 				{
-					for(int x=0; x<128; x++)
+					voxel_i = v;
+					for(size_t i=sparse_volume->getCount(v); i<sparse_volume->getCount(v - 1); i++)
 					{
-						voxel_i = data_DLD[y * 128 + x + t * 128 * 128];
-
-						switch(color_mode)
-						{
-							case COLOR:
-								voxel_r = palette[voxel_i*3];
-								voxel_g = palette[voxel_i*3 + 1];
-								voxel_b = palette[voxel_i*3 + 2];
-								glColor4ub(voxel_r, voxel_g, voxel_b, voxel_alpha);
-								break;
-							case MONO:
-								glColor4ub(voxel_i, voxel_i, voxel_i, voxel_alpha);
-								break;
-						}
-
-						glLoadIdentity();
-						if(t == active_slice && voxel_i > 20)
+						GLint t = voxels[i] / slice_size;
+						GLint y = voxels[i] % slice_size / data_DLD_reduced_width;
+						GLint x = voxels[i] % data_DLD_reduced_width;
+						setPoint(vertices[count], x, y, -no_slices/2.0 + t, voxel_i);
+						if(t == active_slice && voxel_i > highlight_threshold)
 						{
-							voxel_r = palette[voxel_i*3];
-							voxel_g = palette[voxel_i*3 + 1];
-							glColor3ub(voxel_r,voxel_g, 0);
+							vertices[count].color[0] = palette[voxel_i*3];
+							vertices[count].color[1] = palette[voxel_i*3 + 1];
+							vertices[count].color[2] = 0;
+							vertices[count].color[3] = 255;
 						}
-						glVertex3f(x, y,  -no_slices/2.0 + t);
+						count++;
 					}
 				}
+				cloud_all->upload(count);
 			}
-			glEnd();
+			cloud_all->draw();
 			glPopMatrix();
 
 			renderFrame();
@@ -330,30 +1045,25 @@ GLvoid render()
 			glTranslatef(-128/2.0, -128/2.0, 0);
 			if(data_mode == DATA_XY)
 			{
-				glBegin(GL_POINTS);
-					for(int y=0; y<128; y++)
+				glScalef(level_scale_x, level_scale_y, 1);
+
+				GLuint key[] = {(GLuint) data_DLD_level, (GLuint) isSliceReady(active_slice), data_generation, contrast_generation,
+								(GLuint) color_mode, voxel_alpha, (GLuint) active_slice, (GLuint) no_slices};
+				if(cloud_xy->isOutdated(key, sizeof(key) / sizeof(GLuint)))
+				{
+					GLPointVertex* vertices = cloud_xy->getVertices((size_t) data_DLD_reduced_width * data_DLD_reduced_height);
+					size_t count = 0;
+					for(int y=0; y<data_DLD_reduced_height && isSliceReady(active_slice); y++)
 					{
-						for(int x=0; x<128; x++)
+						for(int x=0; x<data_DLD_reduced_width; x++)
 						{
-							voxel_i = data_DLD[y * 128 + x + active_slice * 128 * 128];
-							switch(color_mode)
-							{
-								case COLOR:
-									voxel_r = palette[voxel_i*3];
-									voxel_g = palette[voxel_i*3 + 1];
-									voxel_b = palette[voxel_i*3 + 2];
-									glColor4ub(voxel_r, voxel_g, voxel_b, voxel_alpha);
-									break;
-								case MONO:
-									glColor4ub(voxel_i, voxel_i, voxel_i, voxel_alpha);
-									break;
-							}
-
-							glLoadIdentity();
-							glVertex3f(x, y, -no_slices/2.0 + active_slice);
+							voxel_i = contrast_lut[active_slice * 256 + data_DLD[y * data_DLD_reduced_width + x + active_slice * data_DLD_reduced_width * data_DLD_reduced_height]];
+							setPoint(vertices[count++], x, y, -no_slices/2.0 + active_slice, voxel_i);
 						}
 					}
-				glEnd();
+					cloud_xy->upload(count);
+				}
+				cloud_xy->draw();
 				glPopMatrix();
 
 				renderFrame();
@@ -379,30 +1089,30 @@ GLvoid render()
 				glPushMatrix();
 				glMultMatrixf(rotation_matrix);
 				glTranslatef(-128/2.0, -128/2.0, -no_slices/2.0);
-				glBegin(GL_POINTS);
-				for(int y=0; y<128; y++)
+				glScalef(level_scale_x, level_scale_y, 1);
+				GLint level_x = y_linecut_x_position * data_DLD_reduced_width / 128;
+
+				GLuint key[] = {(GLuint) data_DLD_level, (GLuint) slices_ready, data_generation, contrast_generation,
+								(GLuint) color_mode, voxel_alpha, (GLuint) level_x, (GLuint) no_slices};
+				if(cloud_ey->isOutdated(key, sizeof(key) / sizeof(GLuint)))
 				{
-					for(int e=0; e<no_slices; e++)
+					extractYLineCut(level_x);
+					GLPointVertex* vertices = cloud_ey->getVertices((size_t) data_DLD_reduced_height * no_slices);
+					size_t count = 0;
+					for(int y=0; y<data_DLD_reduced_height; y++)
 					{
-						voxel_i = data_DLD[y * 128 + y_linecut_x_position + e * 128 * 128];
-						switch(color_mode)
+						for(int e=0; e<no_slices; e++)
 						{
-							case COLOR:
-								voxel_r = palette[voxel_i*3];
-								voxel_g = palette[voxel_i*3 + 1];
-								voxel_b = palette[voxel_i*3 + 2];
-								glColor4ub(voxel_r, voxel_g, voxel_b, voxel_alpha);
-								break;
-							case MONO:
-								glColor4ub(voxel_i, voxel_i, voxel_i, voxel_alpha);
-								break;
-						}
+							if(!isSliceReady(e))
+								continue;
 
-						glLoadIdentity();
-						glVertex3f(y_linecut_x_position, y, e);
+							voxel_i = contrast_lut[e * 256 + data_DLD_cut[e * data_DLD_reduced_height + y]];
+							setPoint(vertices[count++], y_linecut_x_position / level_scale_x, y, e, voxel_i);
+						}
 					}
+					cloud_ey->upload(count);
 				}
-				glEnd();
+				cloud_ey->draw();
 				glPopMatrix();
 
 				renderFrame();
@@ -422,18 +1132,127 @@ GLvoid render()
 				glPopMatrix();
 			} //EY
 
+			else if(data_mode == DATA_EX)
+			{
+				glLoadIdentity();
+				glPushMatrix();
+				glMultMatrixf(rotation_matrix);
+				glTranslatef(-128/2.0, -128/2.0, -no_slices/2.0);
+				glScalef(level_scale_x, level_scale_y, 1);
+				GLCutPlane plane = {{0, (GLfloat) (x_linecut_y_position * data_DLD_reduced_height / 128), 0},
+									{1, 0, 0}, {0, 0, 1}, data_DLD_reduced_width, no_slices};
+				renderCut(plane, data_DLD_level);
+				glPopMatrix();
+
+				renderFrame();
+
+				// draw rect around the cut
+				glColor4f(1.0,1.0,0.0,0.8);
+				glPushMatrix();
+				glMultMatrixf(rotation_matrix);
+				glTranslatef(-128/2.0, -128/2.0, -no_slices/2.0);
+				glBegin(GL_LINE_LOOP);
+					glVertex3f(128, x_linecut_y_position, 0);
+					glVertex3f(128, x_linecut_y_position, no_slices);
+					glVertex3f(0, x_linecut_y_position, no_slices);
+					glVertex3f(0, x_linecut_y_position, 0);
+				glEnd();
+
+				glPopMatrix();
+			} //EX
+
+			else if(data_mode == DATA_OBLIQUE)
+			{
+				glLoadIdentity();
+				glPushMatrix();
+				glMultMatrixf(rotation_matrix);
+				glTranslatef(-128/2.0, -128/2.0, -no_slices/2.0);
+				glScalef(level_scale_x, level_scale_y, 1);
+				renderObliqueCut(data_DLD_level, 128, 128);
+				glPopMatrix();
+
+				renderFrame();
+			} // OBLIQUE
+
+			else if(data_mode == DATA_PATH)
+			{
+				glLoadIdentity();
+				glPushMatrix();
+				glMultMatrixf(rotation_matrix);
+				glTranslatef(-128/2.0, -128/2.0, -no_slices/2.0);
+				glScalef(level_scale_x, level_scale_y, 1);
+				renderPathCut();
+				glPopMatrix();
+
+				renderFrame();
+
+				// draw the path in the active slice, the selected vertex larger
+				glColor4f(1.0,1.0,0.0,0.8);
+				glPushMatrix();
+				glMultMatrixf(rotation_matrix);
+				glTranslatef(-128/2.0, -128/2.0, -no_slices/2.0);
+				glBegin(GL_LINE_STRIP);
+					for(GLint v=0; v<path_cut->getNoVertices(); v++)
+						glVertex3f(path_cut->getVertex(v)[0] * 128, path_cut->getVertex(v)[1] * 128, active_slice);
+				glEnd();
+				glPointSize(5);
+				glBegin(GL_POINTS);
+					glVertex3f(path_cut->getVertex(path_vertex)[0] * 128, path_cut->getVertex(path_vertex)[1] * 128, active_slice);
+				glEnd();
+				glPointSize(1);
+
+				glPopMatrix();
+			} // PATH
+
 			if(show_y_linecut)
 				renderYLineCut();
+			if(show_x_linecut)
+				renderXLineCut();
 
 
 		}// RENDER_SINGLE
 
+		else if(render_mode == RENDER_VOLUME)
+		{
+			glLoadIdentity();
+			glPushMatrix();
+			glMultMatrixf(rotation_matrix);
+			glTranslatef(-128/2.0, -128/2.0, -no_slices/2.0);
+			glScalef(128, 128, no_slices);
+
+			// the contrast is applied on upload, slices not loaded yet stay empty
+			GLuint key[] = {(GLuint) data_DLD_level, (GLuint) slices_ready, data_generation, contrast_generation, (GLuint) no_slices};
+			if(volume_renderer->isOutdated(key, sizeof(key) / sizeof(GLuint)))
+			{
+				std::vector<GLubyte> texels;
+				getContrastVolume(texels);
+				if(!volume_renderer->setVolume(texels.data(), data_DLD_reduced_width, data_DLD_reduced_height, no_slices))
+					render_mode = RENDER_ALL;
+			}
+			volume_renderer->setTransfer(color_mode == COLOR ? palette : NULL, voxel_alpha);
+			volume_renderer->draw();
+			glPopMatrix();
+
+			renderFrame();
+		}// RENDER_VOLUME
+
+		else if(render_mode == RENDER_RAYCAST)
+		{
+			updateRaycaster();
+			raycaster->render(rotation_matrix, viewport_scale, viewport_width, viewport_height, raycast_mode);
+			renderRaycast();
+
+			renderFrame();
+		}// RENDER_RAYCAST
+
 
 	}// check render_mode
 
 	else if(resolution_mode == HIGH_RES)
 	{
-        data_mode = DATA_XY;
+		// besides the XY slice only the EY cut and the oblique cut, resampled from the raw counts if they are one mapped volume
+		if(data_mode != DATA_EY && data_mode != DATA_OBLIQUE)
+			data_mode = DATA_XY;
 
 		glViewport(0,0,viewport_width,viewport_height);
 		glMatrixMode(GL_PROJECTION);
@@ -443,10 +1262,8 @@ GLvoid render()
 
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		GLuint voxel_i;
-		GLubyte voxel_r;
-		GLubyte voxel_g;
-		GLubyte voxel_b;
+		// drops the color tables only after F5 or an alpha change
+		color_lut->setColors(color_mode == COLOR ? palette : NULL, voxel_alpha);
 
 		if(render_mode == RENDER_SINGLE)
 		{
@@ -458,32 +1275,29 @@ GLvoid render()
 			if(data_mode == DATA_XY)
 			{
 				// only RENDER_SINGLE in HIGH_RES mode (for performance)
-				glBegin(GL_POINTS);
-				for(int y=0; y<data_DLD_height; y++)
+				GLuint key[] = {(GLuint) DATA_XY, (GLuint) isSliceReady(active_slice), data_generation, contrast_generation,
+								(GLuint) color_mode, voxel_alpha, (GLuint) active_slice, (GLuint) no_slices};
+				if(cloud_high_res->isOutdated(key, sizeof(key) / sizeof(GLuint)))
 				{
-					for(int x=0; x<data_DLD_width; x++)
+					GLSliceView slice = data_DLD_raw->acquireSlice(active_slice);
+					const GLuint* lut = color_lut->getTable(contrast_clip[active_slice]);
+					GLPointVertex* vertices = cloud_high_res->getVertices((size_t) data_DLD_width * data_DLD_height);
+					size_t count = 0;
+					for(int y=0; y<data_DLD_height && isSliceReady(active_slice); y++)
 					{
-
-						voxel_i = data_DLD_raw[y * data_DLD_width + x + active_slice * data_DLD_width * data_DLD_height];
-
-						switch(color_mode)
+						for(int x=0; x<data_DLD_width; x++)
 						{
-							case COLOR:
-								voxel_r = palette[(GLint) voxel_i*3];
-								voxel_g = palette[(GLint) voxel_i*3 + 1];
-								voxel_b = palette[(GLint) voxel_i*3 + 2];
-								glColor4ub(voxel_r, voxel_g, voxel_b, voxel_alpha);
-								break;
-							case MONO:
-								glColor4ub(voxel_i, voxel_i, voxel_i, voxel_alpha);
-								break;
+							// the raw count picks the color, contrast and alpha included
+							vertices[count].position[0] = x;
+							vertices[count].position[1] = y;
+							vertices[count].position[2] = -no_slices/2.0 + active_slice;
+							memcpy(vertices[count++].color, &lut[slice[y * data_DLD_width + x]], 4);
 						}
-
-						glLoadIdentity();
-						glVertex3f(x, y, -no_slices/2.0 + active_slice);
 					}
+					data_DLD_raw->releaseSlice(active_slice);
+					cloud_high_res->upload(count);
 				}
-				glEnd();
+				cloud_high_res->draw();
 				glPopMatrix();
 
 				renderFrame();
@@ -509,30 +1323,34 @@ GLvoid render()
 				glPushMatrix();
 				glMultMatrixf(rotation_matrix);
 				glTranslatef(-data_DLD_width/2.0, -data_DLD_height/2.0, -no_slices/2.0);
-				glBegin(GL_POINTS);
-				for(int y=0; y<data_DLD_height; y++)
+				if(y_linecut_x_position_high_res >= data_DLD_width)
+					y_linecut_x_position_high_res = data_DLD_width - 1;
+				GLuint key[] = {(GLuint) DATA_EY, (GLuint) slices_ready, data_generation, contrast_generation,
+								(GLuint) color_mode, voxel_alpha, (GLuint) y_linecut_x_position_high_res, (GLuint) no_slices};
+				if(cloud_high_res->isOutdated(key, sizeof(key) / sizeof(GLuint)))
 				{
+					GLPointVertex* vertices = cloud_high_res->getVertices((size_t) data_DLD_height * no_slices);
+					size_t count = 0;
+					// energy outermost, every slice is pulled from data_DLD_raw only once
 					for(int e=0; e<no_slices; e++)
 					{
-						voxel_i = data_DLD_raw[y * data_DLD_width + y_linecut_x_position_high_res + e * data_DLD_width * data_DLD_height];
-						switch(color_mode)
+						if(!isSliceReady(e))
+							continue;
+
+						GLSliceView slice = data_DLD_raw->acquireSlice(e);
+						const GLuint* lut = color_lut->getTable(contrast_clip[e]);
+						for(int y=0; y<data_DLD_height; y++)
 						{
-							case COLOR:
-								voxel_r = palette[voxel_i*3];
-								voxel_g = palette[voxel_i*3 + 1];
-								voxel_b = palette[voxel_i*3 + 2];
-								glColor4ub(voxel_r, voxel_g, voxel_b, voxel_alpha);
-								break;
-							case MONO:
-								glColor4ub(voxel_i, voxel_i, voxel_i, voxel_alpha);
-								break;
+							vertices[count].position[0] = y_linecut_x_position_high_res;
+							vertices[count].position[1] = y;
+							vertices[count].position[2] = e;
+							memcpy(vertices[count++].color, &lut[slice[y * data_DLD_width + y_linecut_x_position_high_res]], 4);
 						}
-
-						glLoadIdentity();
-						glVertex3f(y_linecut_x_position_high_res, y, e);
+						data_DLD_raw->releaseSlice(e);
 					}
+					cloud_high_res->upload(count);
 				}
-				glEnd();
+				cloud_high_res->draw();
 				glPopMatrix();
 
 				renderFrame();
@@ -552,6 +1370,18 @@ GLvoid render()
 
 				glPopMatrix();
 			} //EY
+
+			else if(data_mode == DATA_OBLIQUE)
+			{
+				glLoadIdentity();
+				glPushMatrix();
+				glMultMatrixf(rotation_matrix);
+				glTranslatef(-data_DLD_width/2.0, -data_DLD_height/2.0, -no_slices/2.0);
+				renderObliqueCut(data_DLD_raw->getVolume() ? 0 : 1, data_DLD_width, data_DLD_height);
+				glPopMatrix();
+
+				renderFrame();
+			} // OBLIQUE
 		} // SINGLE
 		else
 		{
@@ -559,7 +1389,22 @@ GLvoid render()
 		}
 	}
 
-	glutSwapBuffers();
+	if(show_stats)
+		renderStats();
+
+	// headless there is nothing to swap, the frame is timed up to its last fragment
+	if(headless_rotations < 0)
+		glutSwapBuffers();
+	else
+		glFinish();
+
+	if(!first_frame_shown && slices_ready > 0)
+	{
+		first_frame_shown = true;
+		std::cout << "info: first frame after "
+				  << std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - program_start).count()
+				  << " ms" << std::endl;
+	}
 }
 
 GLvoid renderYLineCut()
@@ -582,13 +1427,68 @@ GLvoid renderYLineCut()
 	    glVertex3f(y_linecut_x_position, 0, active_slice);
         glVertex3f(y_linecut_x_position, 128,  active_slice);
 	glEnd();
+
+	// MDC along the line, in the EY cut also the EDC of the whole cut above it
+	if(summed_volume && summed_volume->getNoIntegrated() == no_slices)
+	{
+		std::vector<uint64_t> profile(data_DLD_height > no_slices ? data_DLD_height : no_slices);
+		GLint x0 = y_linecut_x_position * data_DLD_width / 128;
+		GLint x1 = (y_linecut_x_position + 1) * data_DLD_width / 128 - 1;
+
+		summed_volume->mdcY(x0, x1, active_slice, active_slice, profile.data());
+		GLfloat mdc_origin[3] = {(GLfloat) y_linecut_x_position, 0, (GLfloat) active_slice};
+		GLfloat mdc_step[3] = {0, 128.0f / data_DLD_height, 0};
+		GLfloat mdc_offset[3] = {1, 0, 0};
+		renderProfile(profile.data(), data_DLD_height, mdc_origin, mdc_step, mdc_offset);
+
+		if(data_mode == DATA_EY)
+		{
+			summed_volume->edc(x0, x1, 0, data_DLD_height - 1, 0, no_slices - 1, profile.data());
+			GLfloat edc_origin[3] = {(GLfloat) y_linecut_x_position, 128, 0};
+			GLfloat edc_step[3] = {0, 0, 1};
+			GLfloat edc_offset[3] = {0, 1, 0};
+			renderProfile(profile.data(), no_slices, edc_origin, edc_step, edc_offset);
+		}
+	}
 	glPopMatrix();
 
 }
 
 GLvoid renderXLineCut()
 {
+	glLoadIdentity();
+	glPushMatrix();
+	glMultMatrixf(rotation_matrix);
+	glTranslatef(-128/2.0, -128/2.0, -no_slices/2.0);
+	glColor4f(1,1,0,1);
+	glBegin(GL_LINES);
+	    glVertex3f(0, x_linecut_y_position, active_slice);
+        glVertex3f(128, x_linecut_y_position, active_slice);
+	glEnd();
 
+	// MDC along the line, in the EX cut also the EDC of the whole cut next to it
+	if(summed_volume && summed_volume->getNoIntegrated() == no_slices)
+	{
+		std::vector<uint64_t> profile(data_DLD_width > no_slices ? data_DLD_width : no_slices);
+		GLint y0 = x_linecut_y_position * data_DLD_height / 128;
+		GLint y1 = (x_linecut_y_position + 1) * data_DLD_height / 128 - 1;
+
+		summed_volume->mdcX(y0, y1, active_slice, active_slice, profile.data());
+		GLfloat mdc_origin[3] = {0, (GLfloat) x_linecut_y_position, (GLfloat) active_slice};
+		GLfloat mdc_step[3] = {128.0f / data_DLD_width, 0, 0};
+		GLfloat mdc_offset[3] = {0, 1, 0};
+		renderProfile(profile.data(), data_DLD_width, mdc_origin, mdc_step, mdc_offset);
+
+		if(data_mode == DATA_EX)
+		{
+			summed_volume->edc(0, data_DLD_width - 1, y0, y1, 0, no_slices - 1, profile.data());
+			GLfloat edc_origin[3] = {128, (GLfloat) x_linecut_y_position, 0};
+			GLfloat edc_step[3] = {0, 0, 1};
+			GLfloat edc_offset[3] = {1, 0, 0};
+			renderProfile(profile.data(), no_slices, edc_origin, edc_step, edc_offset);
+		}
+	}
+	glPopMatrix();
 }
 
 GLvoid resetRotationMatrix()
@@ -607,7 +1507,8 @@ GLvoid resetRotationMatrix()
 	current_quaternion->reset();
 	previous_quaternion->reset();
 
-	glutPostRedisplay();
+	if(isWindowed())
+		glutPostRedisplay();
 
 }
 
@@ -648,10 +1549,19 @@ GLvoid initAdjustableParameters()
 	render_mode = RENDER_SINGLE;
 	color_mode = COLOR;
 	data_mode = DATA_XY;
+	contrast_mode = CONTRAST_MAX;
 
 	active_slice = 0;
 	show_x_linecut = false;
 	show_y_linecut = false;
+	show_stats = false;
+	filter_type = FILTER_NONE;
+	filter_radius = 2;
+	data_generation = 0;
+	contrast_generation = 0;
+	point_threshold = 0;
+	cut_offset = 0;
+	path_vertex = 0;
 	y_linecut_x_position = 64;
 	x_linecut_y_position = 64;
 
@@ -663,22 +1573,129 @@ GLvoid initStateVariables()
 {
 	data_downsampled = false;
 	data_downscaled = false;
+	first_frame_shown = false;
 }
 
 GLvoid init(){
 
-	initOpenGL();
+	// the batch raycaster has no GL context
+	if(raycast_views < 0)
+		initOpenGL();
 	initTrackball();
 	initStateVariables();
 	initAdjustableParameters();
 
-	data_DLD_raw = new GLushort[512*512*no_slices];
+	worker_pool = new GLWorkerPool();
+	stack_loader = new GLStackLoader(path_root, filename_root);
+
+	// watch before probing, no slice finished in between is missed
+	if(watch_mode)
+		stack_watcher = new GLStackWatcher(path_root, filename_root);
+
+	no_slices = stack_loader->probe();
+	if(no_slices == 0)
+	{
+		freeMemory();
+		exit(EXIT_FAILURE);
+	}
+	data_DLD_width = stack_loader->getWidth();
+	data_DLD_height = stack_loader->getHeight();
+
+	// before the first slice is read, everything downstream sees the corrected counts
+	if(flat_path || dark_path)
+	{
+		slice_correction = new GLSliceCorrection(data_DLD_width, data_DLD_height);
+		if((flat_path && !slice_correction->loadFlat(flat_path)) || (dark_path && !slice_correction->loadDark(dark_path)))
+		{
+			std::cout << "error: cannot load the correction maps" << std::endl;
+			freeMemory();
+			exit(EXIT_FAILURE);
+		}
+		stack_loader->setCorrection(slice_correction);
+	}
+
+	slices_ready = 0;
+	pyramid_busy = true;
+
+	volume_pyramid = new GLVolumePyramid(data_DLD_width, data_DLD_height);
+	if(volume_pyramid->getNoLevels() < 2)
+	{
+		std::cout << "error: slices of " << data_DLD_width << "x" << data_DLD_height << " px are too small to be reduced" << std::endl;
+		freeMemory();
+		exit(EXIT_FAILURE);
+	}
 
+	slice_histograms = new GLSliceHistograms();
+	volume_stats = new GLVolumeStats(data_DLD_width, data_DLD_height);
+	cut_engine = new GLCutEngine(worker_pool);
+	if(budgetBytes(no_slices, true, false) <= memory_budget)
+		summed_volume = new GLSummedVolume(data_DLD_width, data_DLD_height);
+	else
+		std::cout << "info: summed volume table exceeds the memory budget, EDC/MDC profiles are off" << std::endl;
+
+	// Gamma - X - M - Gamma of a square lattice centered in the slice
+	const GLfloat path[] = {0.5f, 0.5f, 0.9f, 0.5f, 0.9f, 0.9f, 0.5f, 0.5f};
+	path_cut = new GLPathCut(worker_pool);
+	path_cut->setPath(path, 4);
+
+	volume_cache = new GLVolumeCache(path_root, filename_root);
+	if(!watch_mode && volume_cache->open(stack_loader, volume_pyramid, slice_histograms, volume_stats))
+	{
+		data_DLD_raw_max = volume_cache->getRawMax();
 
-	loadDataStack();
-	downsample();
-	downscale();
+		// the mapped raw volume is neither packed nor bounded, with those flags only pyramid, histograms and
+		// statistics come from the cache and the raw slices are read from the TIFFs on demand, as without it
+		size_t raw_bytes = (size_t) data_DLD_width * data_DLD_height * no_slices * sizeof(GLushort);
+		if(packed_mode || raw_bytes > memory_budget)
+		{
+			volume_cache->close();
+			data_DLD_raw = new GLSliceProvider(stack_loader, worker_pool, memory_budget, packed_mode);
+			std::cout << "info: raw slices " << (packed_mode ? "12Bit packed" : "streamed") << " from the TIFF files within "
+					  << memory_budget / (1024 * 1024) << " MB, not mapped from the cache" << std::endl;
+		}
+		else
+			data_DLD_raw = new GLSliceProvider(volume_cache->getSlices(), no_slices, data_DLD_width, data_DLD_height);
+		data_downsampled = true;
+		data_downscaled = true;
+
+		reserveSlices(no_slices);
+		for(GLint i=0; i<(no_slices + 63) / 64; i++)
+			data_DLD_ready[i] = ~(uint64_t) 0;
+		slices_ready = no_slices;
+		pyramid_busy = false;
+		updateLevel();
+		updateContrast();
+
+		// the load stage does not run for the mapped slices
+		if(summed_volume)
+		{
+			worker_pool->parallelFor(0, no_slices, [](GLint _t)
+			{
+				GLSliceView slice = data_DLD_raw->acquireSlice(_t);
+				GLushort* scratch = slice.pixels ? NULL : new GLushort[slice.count];
+				summed_volume->addSlice(_t, slice.unpacked(scratch));
+				delete[] scratch;
+				data_DLD_raw->releaseSlice(_t);
+			});
+			integrateSummedVolume();
+		}
+	}
+	else
+	{
+		// returns right away, the slices fill in while the window is already up
+		loadDataStack();
+	}
 	setPalette();
+	color_lut = new GLColorLUT();
+	cloud_all = new GLPointCloud();
+	cloud_xy = new GLPointCloud();
+	cloud_ey = new GLPointCloud();
+	cloud_path = new GLPointCloud();
+	cloud_high_res = new GLPointCloud();
+	cut_texture = new GLCutTexture();
+	volume_renderer = new GLVolumeRenderer();
+	raycaster = new GLRaycaster(worker_pool);
+	sparse_volume = new GLSparseVolume();
 
 }
 
@@ -718,11 +1735,23 @@ GLvoid specialKeyHandler(GLint _key, GLint _x, GLint _y)
 				color_mode = COLOR;
 			glutPostRedisplay();
 			break;
+		case GLUT_KEY_F7:
+			data_mode = DATA_OBLIQUE;
+			glutPostRedisplay();
+			break;
+		case GLUT_KEY_F8:
+			data_mode = DATA_PATH;
+			glutPostRedisplay();
+			break;
 		case GLUT_KEY_F6:
 			if(render_mode == RENDER_ALL)
 			{
 				render_mode = RENDER_SINGLE;
 			}
+			else if(render_mode == RENDER_SINGLE)
+				render_mode = RENDER_VOLUME;
+			else if(render_mode == RENDER_VOLUME)
+				render_mode = RENDER_RAYCAST;
 			else
 				render_mode = RENDER_ALL;
 			glutPostRedisplay();
@@ -734,12 +1763,20 @@ GLvoid specialKeyHandler(GLint _key, GLint _x, GLint _y)
 		case GLUT_KEY_INSERT:
 			break;
 		case GLUT_KEY_RIGHT:
+			if(data_mode == DATA_PATH)
+				movePathVertex(1 / 128.0f, 0);
 			break;
 		case GLUT_KEY_LEFT:
+			if(data_mode == DATA_PATH)
+				movePathVertex(-1 / 128.0f, 0);
 			break;
 		case GLUT_KEY_UP:
+			if(data_mode == DATA_PATH)
+				movePathVertex(0, 1 / 128.0f);
 			break;
 		case GLUT_KEY_DOWN:
+			if(data_mode == DATA_PATH)
+				movePathVertex(0, -1 / 128.0f);
 			break;
 		case GLUT_KEY_PAGE_UP:
 			break;
@@ -793,6 +1830,107 @@ GLvoid keyHandler(GLubyte _key, GLint _x, GLint _y)
 		case 't':
 			setSideView();
 			break;
+		case 'x':
+			show_x_linecut = !show_x_linecut;
+			glutPostRedisplay();
+			break;
+		case '[':
+			path_vertex = path_vertex > 0 ? path_vertex - 1 : path_cut->getNoVertices() - 1;
+			glutPostRedisplay();
+			break;
+		case ']':
+			path_vertex = path_vertex + 1 < path_cut->getNoVertices() ? path_vertex + 1 : 0;
+			glutPostRedisplay();
+			break;
+		case 'k':
+		{
+			// new vertex halfway to the next one (or next to the last one)
+			const GLfloat* vertex = path_cut->getVertex(path_vertex);
+			GLboolean last = path_vertex + 1 == path_cut->getNoVertices();
+			const GLfloat* next = last ? vertex : path_cut->getVertex(path_vertex + 1);
+			GLfloat kx = last ? vertex[0] + 8 / 128.0f : (vertex[0] + next[0]) / 2;
+			GLfloat ky = last ? vertex[1] : (vertex[1] + next[1]) / 2;
+			path_cut->insertVertex(++path_vertex, kx < 1 ? kx : 1, ky);
+			glutPostRedisplay();
+			break;
+		}
+		case 'j':
+			if(path_cut->getNoVertices() > 2)
+			{
+				path_cut->removeVertex(path_vertex);
+				path_vertex = path_vertex < path_cut->getNoVertices() ? path_vertex : path_vertex - 1;
+				glutPostRedisplay();
+			}
+			break;
+		case 'e':
+			if(resolution_mode == LOW_RES && render_mode == RENDER_RAYCAST)
+			{
+				GLchar path[256];
+				snprintf(path, sizeof(path), "%s%s_raycast.ppm", path_root, filename_root);
+				if(raycaster->exportPPM(path))
+					std::cout << "info: wrote " << path << ", " << raycaster->getWidth() << "x" << raycaster->getHeight() << " px" << std::endl;
+				else
+					std::cout << "error: could not write " << path << std::endl;
+			}
+			else if(data_mode == DATA_PATH)
+			{
+				GLchar path[256];
+				snprintf(path, sizeof(path), "%s%s_path.pgm", path_root, filename_root);
+				if(path_cut->exportPGM(path))
+					std::cout << "info: wrote " << path << ", " << path_cut->getWidth() << " k x " << path_cut->getHeight() << " E" << std::endl;
+				else
+					std::cout << "error: could not write " << path << std::endl;
+			}
+			break;
+		case 'c':
+			setContrast((ContrastMode) ((contrast_mode + 1) % 3), contrast_percentile);
+			glutPostRedisplay();
+			break;
+		case 'p':
+			// 99.99 -> 99.9 -> 99 -> 95 -> 99.99
+			setContrast(contrast_mode, contrast_percentile > 99.95f ? 99.9f : contrast_percentile > 99.5f ? 99.0f
+						: contrast_percentile > 97.0f ? 95.0f : 99.99f);
+			glutPostRedisplay();
+			break;
+		case 's':
+			show_stats = !show_stats;
+			glutPostRedisplay();
+			break;
+		case 'f':
+			// off -> box -> gaussian -> off
+			setFilter((GLFilterType) ((filter_type + 1) % 3), filter_radius);
+			break;
+		case 'g':
+			// radius 1 .. 8
+			if(filter_type == FILTER_NONE)
+				filter_radius = filter_radius % 8 + 1;
+			else
+				setFilter(filter_type, filter_radius % 8 + 1);
+			std::cout << "info: smoothing radius " << filter_radius << std::endl;
+			break;
+		case 'w':
+			raycast_mode = raycast_mode == RAYCAST_MIP ? RAYCAST_COMPOSITE : RAYCAST_MIP;
+			std::cout << "info: raycast " << (raycast_mode == RAYCAST_MIP ? "maximum intensity projection" : "compositing") << std::endl;
+			glutPostRedisplay();
+			break;
+		case 'o':
+		{
+			// all points, then only the ones above the threshold
+			const GLint thresholds[] = {-1, 0, 20, 50, 100};
+			GLint next = 0;
+			while(next < 5 && thresholds[next] <= point_threshold)
+				next++;
+			point_threshold = thresholds[next % 5];
+			updateSparseVolume();
+			std::cout << "info: point cloud threshold " << point_threshold << ", " << sparse_volume->getCount(point_threshold) << " points" << std::endl;
+			glutPostRedisplay();
+			break;
+		}
+		case 'i':
+			data_DLD_raw->printStatistics();
+			std::cout << "info: showing pyramid level " << data_DLD_level << " of " << volume_pyramid->getNoLevels() - 1
+					  << ", " << data_DLD_reduced_width << "x" << data_DLD_reduced_height << " px" << std::endl;
+			break;
 
 			if(glutGetModifiers() == GLUT_ACTIVE_SHIFT)
 			{}
@@ -829,26 +1967,23 @@ GLvoid processMouse(GLint button, GLint state, GLint x, GLint y)
 
 		start_vector->normalize();
 		}
+		else if(button == GLUT_RIGHT_BUTTON && render_mode == RENDER_ALL && resolution_mode == LOW_RES)
+		{
+			pickVoxel(x, y);
+		}
 		else if(button == 3 && data_mode == DATA_XY && !show_y_linecut)
 		{
-			if(active_slice < no_slices){
-				active_slice++;
-				glutPostRedisplay();
-			}
+			setActiveSlice(active_slice + 1);
 		}
 		else if (button == 4 && data_mode == DATA_XY && !show_y_linecut)
 		{
-			if(active_slice > 0)
-			{
-				active_slice--;
-				glutPostRedisplay();
-			}
+			setActiveSlice(active_slice - 1);
 		}
 
 
 		else if(button == 3 && data_mode == DATA_XY && show_y_linecut)
 		{
-			if(y_linecut_x_position < 128){
+			if(y_linecut_x_position < 127){
 				//debugMsg("x_pos = ",(GLfloat) y_linecut_x_position);
 				y_linecut_x_position++;
 				glutPostRedisplay();
@@ -866,7 +2001,7 @@ GLvoid processMouse(GLint button, GLint state, GLint x, GLint y)
 
 		else if(button == 3 && data_mode == DATA_EY && resolution_mode == LOW_RES && !show_y_linecut)
 		{
-			if(y_linecut_x_position < 128){
+			if(y_linecut_x_position < 127){
 				y_linecut_x_position++;
 				glutPostRedisplay();
 			}
@@ -884,26 +2019,54 @@ GLvoid processMouse(GLint button, GLint state, GLint x, GLint y)
 		else if(button == 3 && data_mode == DATA_EY && resolution_mode == LOW_RES && show_y_linecut)
 		{
 			//debugMsg("x_pos = ",(GLfloat) y_linecut_x_position);
-			if(active_slice < no_slices){
-				//debugMsg("x_pos = ",(GLfloat) y_linecut_x_position);
-				active_slice++;
+			setActiveSlice(active_slice + 1);
+		}
+		else if (button == 4 && data_mode == DATA_EY && resolution_mode == LOW_RES && show_y_linecut)
+		{
+			setActiveSlice(active_slice - 1);
+		}
+
+
+
+		else if(button == 3 && data_mode == DATA_EX && !show_x_linecut)
+		{
+			if(x_linecut_y_position < 127){
+				x_linecut_y_position++;
 				glutPostRedisplay();
 			}
 		}
-		else if (button == 4 && data_mode == DATA_EY && resolution_mode == LOW_RES && show_y_linecut)
+		else if (button == 4 && data_mode == DATA_EX && !show_x_linecut)
 		{
-			if(active_slice > 0)
+			if(x_linecut_y_position > 0)
 			{
-				active_slice--;
+				x_linecut_y_position--;
 				glutPostRedisplay();
 			}
 		}
+		else if(button == 3 && data_mode == DATA_EX && show_x_linecut)
+		{
+			setActiveSlice(active_slice + 1);
+		}
+		else if (button == 4 && data_mode == DATA_EX && show_x_linecut)
+		{
+			setActiveSlice(active_slice - 1);
+		}
 
+		else if(button == 3 && data_mode == DATA_OBLIQUE)
+		{
+			cut_offset += 1;
+			glutPostRedisplay();
+		}
+		else if (button == 4 && data_mode == DATA_OBLIQUE)
+		{
+			cut_offset -= 1;
+			glutPostRedisplay();
+		}
 
 
 		else if(button == 3 && data_mode == DATA_EY && resolution_mode == HIGH_RES)
 		{
-			if(y_linecut_x_position_high_res < data_DLD_width){
+			if(y_linecut_x_position_high_res < data_DLD_width - 1){
 				y_linecut_x_position_high_res++;
 				glutPostRedisplay();
 			}
@@ -996,7 +2159,20 @@ GLvoid setSideView()
 	previous_quaternion->imag->z = current_quaternion->imag->z;
 	previous_quaternion->real = current_quaternion->real;
 
-	glutPostRedisplay();
+	if(isWindowed())
+		glutPostRedisplay();
+}
+
+// a random trackball rotation from rand(), the scripted views seed it for the same ones every run
+GLvoid setRandomRotation()
+{
+	GLVector3f axis(rand() / (GLfloat) RAND_MAX - 0.5f, rand() / (GLfloat) RAND_MAX - 0.5f, rand() / (GLfloat) RAND_MAX - 0.5f);
+	axis.normalize();
+	current_quaternion->polar(rand() / (GLfloat) RAND_MAX * 2 * GL_PI, &axis);
+	current_quaternion->normalize();
+	GLfloat* matrix = current_quaternion->getRotationMatrix();
+	memcpy(rotation_matrix, matrix, 16 * sizeof(GLfloat));
+	free(matrix);
 }
 
 GLvoid processMouseActiveMotion(GLint x, GLint y)
@@ -1041,6 +2217,103 @@ GLvoid debugMsg(GLchar* _msg)
 	std::cout << _msg << std::endl;
 }
 
+/**
+ * palette index above which the voxels of the active slice are highlighted: two standard
+ * deviations above the mean of the slice binned like the current level, taken from the
+ * statistics index of the raw counts and normalized like the level, then stretched by
+ * contrast_lut as the voxels it is compared with. Kept until the slice, the level or the data change.
+ */
+GLubyte highlightThreshold(GLint _time_slice)
+{
+	if(!isSliceReady(_time_slice))
+		return 255;
+
+	static GLuint key[4];
+	static GLdouble threshold = 255;
+	GLuint normalized_max = volume_pyramid->getNormalizedMax(data_DLD_level, _time_slice);
+	GLuint slice_key[] = {(GLuint) data_DLD_level, (GLuint) _time_slice, data_generation, normalized_max};
+	if(memcmp(key, slice_key, sizeof(key)) != 0)
+	{
+		GLdouble mean;
+		GLdouble variance;
+		volume_stats->getBinned(_time_slice, 1 << data_DLD_level, &mean, &variance);
+		threshold = normalized_max > 0 ? (mean + 2 * sqrt(variance)) * rescaleFactor8(normalized_max) : 255;
+		memcpy(key, slice_key, sizeof(key));
+	}
+
+	GLdouble stretched = threshold * data_DLD_raw_max / contrast_clip[_time_slice];
+	return stretched < 255 ? (GLubyte) stretched : 255;
+}
+
+// count rate statistics of the active slice and of the loaded stack, top left in window coordinates
+GLvoid renderStats()
+{
+	GLVoxelStats stack;
+	stack.clear();
+	for(GLint t=0; t<no_slices; t++)
+	{
+		if(isSliceReady(t))
+			stack.merge(volume_stats->getSlice(t));
+	}
+
+	std::ostringstream lines[2];
+	lines[0] << "slice " << active_slice << ": ";
+	lines[1] << "stack (" << slices_ready << "/" << no_slices << "): ";
+	for(GLint i=0; i<2; i++)
+	{
+		if(i == 0 && !isSliceReady(active_slice))
+		{
+			lines[i] << "loading";
+			continue;
+		}
+		const GLVoxelStats& stats = i == 0 ? volume_stats->getSlice(active_slice) : stack;
+		lines[i].precision(3);
+		lines[i] << "min " << stats.min << "  max " << stats.max << "  mean " << stats.mean()
+				 << "  sd " << stats.standardDeviation() << "  non-zero "
+				 << (stats.count > 0 ? 100.0 * stats.non_zero / stats.count : 0.0) << " %";
+	}
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, viewport_width, 0, viewport_height, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glColor4f(1.0, 1.0, 1.0, 1.0);
+	for(GLint i=0; i<2; i++)
+	{
+		glRasterPos2f(8, viewport_height - 18 * (i + 1));
+		std::string line = lines[i].str();
+		for(size_t c=0; c<line.size(); c++)
+			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, line[c]);
+	}
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+// _values as a line strip, value i at _origin + i * _step + value / max * 32 * _offset (display units)
+GLvoid renderProfile(const uint64_t* _values, GLint _count, const GLfloat* _origin, const GLfloat* _step, const GLfloat* _offset)
+{
+	uint64_t max = 1;
+	for(GLint i=0; i<_count; i++)
+		max = _values[i] > max ? _values[i] : max;
+
+	glColor4f(0,1,1,1);
+	glBegin(GL_LINE_STRIP);
+	for(GLint i=0; i<_count; i++)
+	{
+		GLfloat height = 32.0f * _values[i] / max;
+		glVertex3f(_origin[0] + i * _step[0] + height * _offset[0], _origin[1] + i * _step[1] + height * _offset[1],
+				   _origin[2] + i * _step[2] + height * _offset[2]);
+	}
+	glEnd();
+}
+
 GLvoid renderFrame()
 {
 	if(resolution_mode == HIGH_RES)
@@ -1121,189 +2394,452 @@ GLvoid renderFrame()
 	}
 }
 
-GLvoid downsample()
+/**
+ * load stage of data_DLD_raw: reduces a slice right after it was decoded (or mapped),
+ * before it is packed and while it is still in the cache. One pass over the raw slice
+ * gives its max count rate and all pyramid levels, the per slice maxima are combined
+ * with atomicMax(), so slices can be reduced in any order and on any thread.
+ */
+GLvoid reduceLoadedSlice(GLint _time_slice, const GLushort* _slice)
 {
+	// reloaded after an eviction
+	if(isSliceReady(_time_slice))
+		return;
 
 	/**
 	 *  TO DO: maybe downsampling should be adjusted to an max_average rather than using a single max
 	 *  -> false color scale will be much more efficient in resolution in HIGH_RES mode
 	 */
 
-	GLushort max_count_rate = 1; //>= 1 because of the devision
-	GLushort count_rate;
+	// only the max count rate of the raw slice is determined here, data_DLD_raw may be mapped read only
+	// from the TIFF files, so it is scaled to 8Bit on the fly (raw * 255 / data_DLD_raw_max).
+	// Once fewer slices are left than workers (end of loading, --watch) the slice itself is split.
+	GLWorkerPool* pool = no_slices - slices_ready < worker_pool->size() ? worker_pool : NULL;
+	atomicMax(raw_max_running, volume_pyramid->reduceSlice(_slice, _time_slice, pool));
+
+	// normalized with the max known so far, checkLoadingProgress() catches up later,
+	// as well as with a level change in between
+	GLint level = data_DLD_level;
+	volume_pyramid->normalizeSlice(level, _time_slice, volume_pyramid->getMax(level));
+
+	slice_histograms->addSlice(_time_slice, _slice, (size_t) data_DLD_width * data_DLD_height);
+	volume_stats->addSlice(_time_slice, _slice);
+	if(summed_volume)
+		summed_volume->addSlice(_time_slice, _slice);
+
+	// publish the slice, everything written above is visible to whoever sees the bit
+	data_DLD_ready[_time_slice / 64].fetch_or((uint64_t) 1 << (_time_slice % 64), std::memory_order_release);
+	slices_ready++;
+}
+
+// accumulates the summed area tables of the load stage along t, once all slices are in
+GLvoid integrateSummedVolume()
+{
+	if(!summed_volume)
+		return;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	summed_volume->integrate(no_slices, worker_pool);
+	std::cout << "info: summed volume table ("
+			  << GLSummedVolume::getSize(data_DLD_width, data_DLD_height, no_slices) / (1024 * 1024) << " MB) integrated in "
+			  << std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+}
+
+/**
+ * switches the smoothing between data_DLD_raw and the pyramid: all planes are filtered again
+ * from the raw slices in memory (nothing is read from the files) and the pyramid is reduced
+ * from the result, FILTER_NONE reduces it from data_DLD_raw again and frees the filter
+ */
+GLvoid setFilter(GLFilterType _type, GLint _radius)
+{
+	if(pyramid_busy)
+	{
+		std::cout << "info: smoothing can be set once the stack is loaded and cached" << std::endl;
+		return;
+	}
 
-	//two runs through data_DLD_raw are necessary, 1. to get the global max count rate, 2. to downsample the data
-	for(int t = 0; t < no_slices; t++)
+	if(_type != FILTER_NONE && !volume_filter)
 	{
-		for (int y = 0; y < data_DLD_height; y++)
+		if(budgetBytes(data_DLD_capacity, summed_volume != NULL, true) > memory_budget)
 		{
-			for(int x = 0; x < data_DLD_width; x++)
-			{
-				count_rate = data_DLD_raw[y * data_DLD_width + x + t * data_DLD_width * data_DLD_height];
-				if(count_rate > max_count_rate)
-				{
-					max_count_rate = count_rate;
-				}
-
-			}
+			std::cout << "info: smoothing filter exceeds the memory budget next to the raw slices"
+					  << (summed_volume ? " and the summed volume table" : "") << std::endl;
+			return;
+		}
+		volume_filter = new GLVolumeFilter(data_DLD_width, data_DLD_height);
+		if(!volume_filter->reserve(data_DLD_capacity))
+		{
+			std::cout << "error: no memory for the smoothing filter" << std::endl;
+			delete volume_filter;
+			volume_filter = NULL;
+			return;
 		}
 	}
 
-
-	for(GLint i=0; i< data_DLD_width * data_DLD_height * no_slices; i++)
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	filter_type = _type;
+	filter_radius = _radius;
+	if(_type == FILTER_NONE)
 	{
-		data_DLD_raw[i] = (GLushort) (255 * (data_DLD_raw[i]/((GLfloat) max_count_rate)));
+		delete volume_filter;
+		volume_filter = NULL;
 	}
-
-	data_downsampled = true;
+	else
+	{
+		volume_filter->setFilter(_type, _radius);
+		worker_pool->parallelFor(0, no_slices, filterRawSlice);
+		volume_filter->filterDepth(0, no_slices, no_slices, worker_pool);
+	}
+	rereduceSlices(0, no_slices);
+
+	const GLchar* names[] = {"off", "box", "gaussian"};
+	std::cout << "info: smoothing " << names[_type];
+	if(_type != FILTER_NONE)
+		std::cout << " radius " << _radius;
+	std::cout << ", " << std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - start).count()
+			  << " ms" << std::endl;
+	glutPostRedisplay();
 }
 
-GLvoid downscale()
+// x and y passes of one raw slice into the filter, runs on the worker pool
+GLvoid filterRawSlice(GLint _time_slice)
 {
+	GLSliceView slice = data_DLD_raw->acquireSlice(_time_slice);
+	GLushort* scratch = slice.pixels ? NULL : new GLushort[slice.count];
+	volume_filter->filterPlane(_time_slice, slice.unpacked(scratch));
+	delete[] scratch;
+	data_DLD_raw->releaseSlice(_time_slice);
+}
 
-	if(data_downsampled)
+// reduces the ready slices [_first, _end) into the pyramid again, from the filter if it is on, and renormalizes
+GLvoid rereduceSlices(GLint _first, GLint _end)
+{
+	worker_pool->parallelFor(_first, _end, [](GLint _t)
 	{
-		if(data_DLD_width != data_DLD_height)
+		if(volume_filter)
 		{
-			std::cout << "info: data_DLD_width != data_DLD_height" << std::endl;
-			std::cout << "downscaling not possilbe!" << std::endl;
-			return;
+			volume_pyramid->reduceSlice(volume_filter->getSlice(_t), _t);
 		}
-		// downscaled and downsampled final data array
-		//data_DLD = (GLubyte*) malloc(128 * 128 * no_slices * sizeof(GLubyte));
-		data_DLD = new GLubyte[128*128*no_slices];
-
-		//initialise with 0
-		for(GLint i=0; i<128 * 128 * no_slices; i++)
-			data_DLD[i] = 0;
-
-		if(data_DLD_width == 512)
+		else
 		{
+			GLSliceView slice = data_DLD_raw->acquireSlice(_t);
+			GLushort* scratch = slice.pixels ? NULL : new GLushort[slice.count];
+			volume_pyramid->reduceSlice(slice.unpacked(scratch), _t);
+			delete[] scratch;
+			data_DLD_raw->releaseSlice(_t);
+		}
+		volume_pyramid->invalidateSlice(_t);
+	});
+
+	// smoothing lowers the peaks, the running max would only ever grow
+	volume_pyramid->rescanMax(no_slices);
+	renormalizeSlices();
+	updateContrast();
+	data_generation++;
+}
 
-			// write the averaged data in a downscaled buffer of type GLushort,
-			// because averaging will produce values bigger than 255 while summing up
-			// if averaging is done, copy the buffer to data_DLD
-			GLushort* data_buffer = new GLushort[128*128*no_slices];
-
-			// init with 0
-			for(GLint i=0; i<128*128*no_slices; i++)
-			{
-				data_buffer[i] = 0;
-			}
-
-			GLint sampling_counter_x = 0;
-			GLint sampling_counter_y = 0;
-			GLushort count_rate = 0;
-			GLint data_DLD_index_x = 0;
-			GLint data_DLD_index_y = 0;
-
-			for(int t = 0; t < no_slices; t++)
-			{
-
-			sampling_counter_x = 0;
-			sampling_counter_y = 0;
-			count_rate = 0;
-			data_DLD_index_y = 0;
-			data_DLD_index_x = 0;
-
-				for (int y = 0; y < data_DLD_height; y++)
-				{
-
-					for(int x = 0; x < data_DLD_width; x++)
-					{
-						count_rate += data_DLD_raw[y * data_DLD_width + x + t * data_DLD_width * data_DLD_height];
-						sampling_counter_x++;
-
-						// sum up 4 pixels over 4 rows
-						if((sampling_counter_x % 4 == 0) && (sampling_counter_x != 0))
-						{
-							data_buffer[data_DLD_index_x + data_DLD_index_y * 128 + t * 128 * 128] += count_rate;
-							count_rate = 0;
-							data_DLD_index_x++;
-						}
-
-					}
-					data_DLD_index_x = 0;
-					sampling_counter_x = 0;
-					sampling_counter_y++;
-					if(sampling_counter_y % 4 == 0 && sampling_counter_y != 0)
-					{
-
-						data_DLD_index_y++;
-					}
+/**
+ * rebuilds contrast_lut and contrast_clip from the histograms, no voxel is touched.
+ * data_DLD is normalized to the max of its level and is clipped at the same fraction
+ * of that max as the raw counts are clipped at of data_DLD_raw_max.
+ */
+GLvoid updateContrast()
+{
+	GLushort global_clip = data_DLD_raw_max;
+	if(contrast_mode == CONTRAST_GLOBAL)
+	{
+		slice_histograms->merge(no_slices, worker_pool);
+		global_clip = slice_histograms->percentile(-1, contrast_percentile);
+	}
 
-				}
-			}
+	for(GLint t=0; t<no_slices; t++)
+	{
+		GLushort clip = global_clip;
+		if(contrast_mode == CONTRAST_SLICE && isSliceReady(t))
+			clip = slice_histograms->percentile(t, contrast_percentile);
+		clip = clip < data_DLD_raw_max ? clip : data_DLD_raw_max;
+		contrast_clip[t] = clip;
+
+		GLfloat stretch = data_DLD_raw_max / (GLfloat) clip;
+		for(GLint v=0; v<256; v++)
+			contrast_lut[t * 256 + v] = v * stretch < 255 ? (GLubyte) (v * stretch) : 255;
+	}
+	contrast_generation++;
+}
 
-			/*
-			 *  DOWNSAMPLE AGAIN
-			 */
+// the color of a contrast index as the point clouds and cut textures draw it, with the palette or grey and voxel_alpha
+GLvoid setColor(GLubyte* _color, GLubyte _voxel_i)
+{
+	switch(color_mode)
+	{
+		case COLOR:
+			_color[0] = palette[_voxel_i*3];
+			_color[1] = palette[_voxel_i*3 + 1];
+			_color[2] = palette[_voxel_i*3 + 2];
+			break;
+		case MONO:
+			_color[0] = _voxel_i;
+			_color[1] = _voxel_i;
+			_color[2] = _voxel_i;
+			break;
+	}
+	_color[3] = voxel_alpha;
+}
 
-			GLushort max_count_rate = 1; //>= 1 because of the devision
+GLvoid setPoint(GLPointVertex& _vertex, GLfloat _x, GLfloat _y, GLfloat _z, GLubyte _voxel_i)
+{
+	_vertex.position[0] = _x;
+	_vertex.position[1] = _y;
+	_vertex.position[2] = _z;
+	setColor(_vertex.color, _voxel_i);
+}
 
-			// get the max count rate
-			for(GLint i=0; i< 128 * 128 * no_slices; i++)
-			{
-				count_rate = data_buffer[i];
-				if(count_rate > max_count_rate)
-				{
-					max_count_rate = count_rate;
-				}
-			}
+GLvoid setContrast(ContrastMode _mode, GLfloat _percentile)
+{
+	contrast_mode = _mode;
+	contrast_percentile = _percentile;
+	updateContrast();
+
+	const GLchar* modes[] = {"max", "global percentile", "slice percentile"};
+	std::cout << "info: contrast " << modes[contrast_mode];
+	if(contrast_mode != CONTRAST_MAX)
+		std::cout << " " << contrast_percentile << " %, clipped at " << contrast_clip[active_slice] << " counts";
+	std::cout << std::endl;
+}
 
-			// downsample to 8Bit
-			for(GLint i=0; i< 128 * 128 * no_slices; i++)
+/**
+ * resamples pyramid level _level on _plane (voxel coordinates of the level) and draws the
+ * samples as a texture on the plane, the cut engine keeps the result until the plane or the
+ * loaded data change and the texture until the samples or their colors change.
+ * Level 0 are the raw counts, only available as long as data_DLD_raw->getVolume() is.
+ */
+GLvoid renderCut(const GLCutPlane& _plane, GLint _level)
+{
+	GLboolean resampled;
+	uint64_t stamp = (uint64_t) data_generation << 32 | slices_ready;
+	if(_level == 0)
+		resampled = cut_engine->cut(data_DLD_raw->getVolume(), data_DLD_width, data_DLD_height, no_slices, _plane, rescaleFactor8(data_DLD_raw_max), stamp);
+	else
+		resampled = cut_engine->cut(volume_pyramid->getSums(_level, 0), volume_pyramid->getWidth(_level), volume_pyramid->getHeight(_level), no_slices,
+									_plane, rescaleFactor8(volume_pyramid->getMax(_level)), stamp);
+
+	// the samples only depend on the cut stamp and plane, the colors on the rest of the key
+	GLuint key[] = {contrast_generation, (GLuint) color_mode, voxel_alpha};
+	if(cut_texture->isOutdated(key, sizeof(key) / sizeof(GLuint)) || resampled)
+	{
+		const GLubyte* samples = cut_engine->getCut();
+		GLubyte* texels = cut_texture->getTexels(_plane.width, _plane.height);
+		worker_pool->parallelFor(0, _plane.height, [&](GLint _j)
+		{
+			for(GLint i=cut_engine->getRowBegin(_j); i<cut_engine->getRowEnd(_j); i++)
 			{
-				//data_buffer[i] = (GLushort) (255 * (data_buffer[i]/((GLfloat) max_count_rate)));
-				data_DLD[i] = (GLubyte) (255 * (data_buffer[i]/((GLfloat) max_count_rate)));
+				GLfloat z = _plane.origin[2] + i * _plane.u[2] + _j * _plane.v[2];
+				GLint t = (GLint) (z + 0.5f);
+				t = t < no_slices ? t : no_slices - 1;
+				if(!isSliceReady(t))
+					continue;
+
+				// the contrast of the nearest slice
+				size_t sample = (size_t) _j * _plane.width + i;
+				setColor(texels + sample * 4, contrast_lut[t * 256 + samples[sample]]);
 			}
+		});
+		cut_texture->upload(_plane);
+	}
+	cut_texture->draw();
+}
 
+/**
+ * the cut plane faces the viewer: u and v are the screen axes and the normal the view axis
+ * in volume coordinates (rows of rotation_matrix), it runs through the volume center shifted
+ * by cut_offset, one sample per voxel of level _level. The volume spans _width x _height
+ * units (128 x 128 in LOW_RES, the raw size in HIGH_RES) and one unit per slice.
+ */
+GLvoid renderObliqueCut(GLint _level, GLfloat _width, GLfloat _height)
+{
+	GLfloat level_scale[3] = {_width / volume_pyramid->getWidth(_level), _height / volume_pyramid->getHeight(_level), 1.0f};
+	GLfloat center[3] = {_width / 2.0f, _height / 2.0f, no_slices / 2.0f};
+	GLfloat diagonal = sqrtf(_width * _width + _height * _height + (GLfloat) no_slices * no_slices);
+	GLfloat step = level_scale[0];
+	GLint size = (GLint) ceilf(diagonal / step) + 1;
+
+	cut_offset = cut_offset < diagonal / 2 ? cut_offset : diagonal / 2;
+	cut_offset = cut_offset > -diagonal / 2 ? cut_offset : -diagonal / 2;
+
+	GLCutPlane plane;
+	plane.width = size;
+	plane.height = size;
+	for(GLint a=0; a<3; a++)
+	{
+		GLfloat u = rotation_matrix[a * 4];
+		GLfloat v = rotation_matrix[a * 4 + 1];
+		GLfloat normal = rotation_matrix[a * 4 + 2];
+		GLfloat origin = center[a] + cut_offset * normal - (size - 1) / 2.0f * step * (u + v);
+		plane.origin[a] = origin / level_scale[a];
+		plane.u[a] = step * u / level_scale[a];
+		plane.v[a] = step * v / level_scale[a];
+	}
+	renderCut(plane, _level);
+}
 
-			// release memory
-			delete data_buffer;
+/**
+ * the E vs k image of the path as a curtain through the volume, every column stands at its
+ * (kx, ky) position, only the segments changed since the last frame are resampled
+ */
+GLvoid renderPathCut()
+{
+	GLint level = data_DLD_level;
+	GLint resampled = path_cut->update(volume_pyramid->getSums(level, 0), data_DLD_reduced_width, data_DLD_reduced_height, no_slices,
+					 rescaleFactor8(volume_pyramid->getMax(level)), ((uint64_t) data_generation << 32 | slices_ready));
+	GLint width = path_cut->getWidth();
+
+	// the vertices are part of the key, removing one resamples no segment but moves the columns
+	std::vector<GLuint> key = {contrast_generation, (GLuint) color_mode, voxel_alpha, (GLuint) width};
+	for(GLint v=0; v<path_cut->getNoVertices(); v++)
+	{
+		GLuint kx, ky;
+		memcpy(&kx, &path_cut->getVertex(v)[0], sizeof(GLuint));
+		memcpy(&ky, &path_cut->getVertex(v)[1], sizeof(GLuint));
+		key.push_back(kx);
+		key.push_back(ky);
+	}
+	if(cloud_path->isOutdated(key.data(), (GLint) key.size()) || resampled > 0)
+	{
+		const GLubyte* image = path_cut->getImage();
+		GLPointVertex* vertices = cloud_path->getVertices((size_t) no_slices * width);
+		size_t count = 0;
+		for(GLint t=0; t<no_slices; t++)
+		{
+			if(!isSliceReady(t))
+				continue;
 
+			for(GLint k=0; k<width; k++)
+				setPoint(vertices[count++], path_cut->getPosition(k)[0], path_cut->getPosition(k)[1], t, contrast_lut[t * 256 + image[t * width + k]]);
 		}
-
+		cloud_path->upload(count);
 	}
+	cloud_path->draw();
+}
 
-	data_downscaled = true;
+/**
+ * sorts the voxels of every second loaded slice of the shown level by their contrast value,
+ * only if the level, the data or the contrast changed, point_threshold is not part of it
+ */
+GLvoid updateSparseVolume()
+{
+	GLuint key[] = {(GLuint) data_DLD_level, (GLuint) slices_ready, data_generation, contrast_generation, (GLuint) no_slices};
+	if(!sparse_volume->isOutdated(key, sizeof(key) / sizeof(GLuint)))
+		return;
+
+	std::vector<GLboolean> slices(no_slices);
+	for(GLint t=0; t<no_slices; t++)
+		slices[t] = t % 2 == 0 && isSliceReady(t);
+	sparse_volume->build(data_DLD, data_DLD_reduced_width, data_DLD_reduced_height, no_slices, contrast_lut, slices.data(), worker_pool);
 }
 
+// the ready slices of the shown level with the contrast applied, the others empty
+GLvoid getContrastVolume(std::vector<GLubyte>& _voxels)
+{
+	size_t slice_size = (size_t) data_DLD_reduced_width * data_DLD_reduced_height;
+	_voxels.assign(slice_size * no_slices, 0);
+	worker_pool->parallelFor(0, no_slices, [&](GLint _t)
+	{
+		if(!isSliceReady(_t))
+			return;
+		const GLubyte* src = data_DLD + _t * slice_size;
+		for(size_t i=0; i<slice_size; i++)
+			_voxels[_t * slice_size + i] = contrast_lut[_t * 256 + src[i]];
+	});
+}
 
-GLvoid loadTiff(GLchar* _path, GLint _time_slice)
+// the CPU raycaster gets the shown level like the volume view, only if the level, the data or the contrast changed
+GLvoid updateRaycaster()
 {
-    TIFF* tif = TIFFOpen(_path, "r");
-    if (tif) {
+	GLuint key[] = {(GLuint) data_DLD_level, (GLuint) slices_ready, data_generation, contrast_generation, (GLuint) no_slices};
+	if(raycaster->isOutdated(key, sizeof(key) / sizeof(GLuint)))
+	{
+		std::vector<GLubyte> voxels;
+		getContrastVolume(voxels);
+		raycaster->setVolume(voxels.data(), data_DLD_reduced_width, data_DLD_reduced_height, no_slices);
+	}
+	raycaster->setTransfer(color_mode == COLOR ? palette : NULL, voxel_alpha);
+}
 
-    uint32 image_height;
-	uint32 image_width;
-	uint16 config;
-	uint16* data_buffer;
-	GLint intensity;
+// blits the last raycast image over the whole viewport, its top row first
+GLvoid renderRaycast()
+{
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
 
-    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &image_height);
-	TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &image_width);
-    TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &config);
+	glRasterPos2f(-1, 1);
+	glPixelZoom(1, -1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glDrawPixels(raycaster->getWidth(), raycaster->getHeight(), GL_RGB, GL_UNSIGNED_BYTE, raycaster->getImage());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glPixelZoom(1, 1);
 
-	data_DLD_height = (GLint) image_height;
-	data_DLD_width = (GLint) image_width;
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
 
-	data_buffer = (uint16*)_TIFFmalloc(image_width * sizeof(uint16));
+/**
+ * the first point above point_threshold under the mouse in RENDER_ALL becomes the active slice,
+ * the view ray runs from the viewer (+viewport_far in eye coordinates) along -z, back through
+ * rotation_matrix and the level scale into voxels of the shown level
+ */
+GLvoid pickVoxel(GLint _x, GLint _y)
+{
+	updateSparseVolume();
+	GLfloat eye[3] = {(2.0f * _x / viewport_width - 1) * 128 * viewport_scale, (1 - 2.0f * _y / viewport_height) * 128 * viewport_scale, viewport_far};
+	GLfloat view[3] = {0, 0, -1};
+	GLfloat scale[3] = {128.0f / data_DLD_reduced_width, 128.0f / data_DLD_reduced_height, 1};
+	GLfloat shift[3] = {128 / 2.0f, 128 / 2.0f, no_slices / 2.0f};
+
+	// points sit on the voxel centers
+	GLfloat origin[3];
+	GLfloat direction[3];
+	for(GLint a=0; a<3; a++)
+	{
+		GLfloat o = 0;
+		GLfloat d = 0;
+		for(GLint r=0; r<3; r++)
+		{
+			o += rotation_matrix[a * 4 + r] * eye[r];
+			d += rotation_matrix[a * 4 + r] * view[r];
+		}
+		origin[a] = (o + shift[a]) / scale[a] + 0.5f;
+		direction[a] = d / scale[a];
+	}
 
-    if (config == PLANARCONFIG_CONTIG)
+	GLint voxel[3];
+	if(!sparse_volume->pick(origin, direction, point_threshold, voxel))
 	{
+		std::cout << "info: no point under the mouse" << std::endl;
+		return;
+	}
+	std::cout << "info: picked x " << voxel[0] * data_DLD_width / data_DLD_reduced_width << " y " << voxel[1] * data_DLD_height / data_DLD_reduced_height
+			  << " slice " << voxel[2] << std::endl;
+	setActiveSlice(voxel[2]);
+}
 
-		for (GLint y = 0; y < image_height; y++)
-		{
-		    TIFFReadScanline(tif, data_buffer, y,0);
+GLvoid movePathVertex(GLfloat _dx, GLfloat _dy)
+{
+	const GLfloat* vertex = path_cut->getVertex(path_vertex);
+	GLfloat kx = vertex[0] + _dx;
+	GLfloat ky = vertex[1] + _dy;
+	path_cut->moveVertex(path_vertex, kx < 0 ? 0 : kx > 1 ? 1 : kx, ky < 0 ? 0 : ky > 1 ? 1 : ky);
+	glutPostRedisplay();
+}
 
-			for(GLint x = 0; x < image_width; x++)
-			{
-			  data_DLD_raw[y * image_width + x + _time_slice * image_width * image_height] = (GLushort) data_buffer[x];
-			}
-		}
-    }
-    _TIFFfree(data_buffer);
-    TIFFClose(tif);
-    }
+// data_DLD_cut[e * data_DLD_reduced_height + y] = data_DLD(x = _x, y, e),
+// the voxels are gathered once per frame instead of once per vertex
+GLvoid extractYLineCut(GLint _x)
+{
+	GLLinearVolume<GLubyte> volume(data_DLD, data_DLD_reduced_width, data_DLD_reduced_height, no_slices);
+	volume.extractEY(_x, data_DLD_cut);
 }
+